@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#ifndef LOVR_DISABLE_DATA
+#include "data/blob.h"
+#endif
 #ifndef LOVR_DISABLE_GRAPHICS
 #include "graphics/model.h"
 #endif
@@ -456,6 +459,25 @@ int luax_readmesh(lua_State* L, int index, float** vertices, uint32_t* vertexCou
     return index + 2;
   }
 
+#ifndef LOVR_DISABLE_DATA
+  Blob* blob = luax_totype(L, index, Blob);
+  if (blob) {
+    Blob* indexBlob = luax_checktype(L, index + 1, Blob);
+    *vertices = blob->data;
+    *indices = indexBlob->data;
+    *vertexCount = blob->size / (3 * sizeof(float));
+    *indexCount = indexBlob->size / sizeof(uint32_t);
+    lovrAssert(*vertexCount > 0, "Invalid mesh data: vertex count is zero");
+    lovrAssert(*indexCount > 0, "Invalid mesh data: index count is zero");
+    lovrAssert(*indexCount % 3 == 0, "Index count must be a multiple of 3");
+    for (uint32_t i = 0; i < *indexCount; i++) {
+      lovrAssert((*indices)[i] < *vertexCount, "Invalid vertex index %d (expected [%d, %d])", (*indices)[i] + 1, 1, *vertexCount);
+    }
+    *shouldFree = false;
+    return index + 2;
+  }
+#endif
+
 #ifndef LOVR_DISABLE_GRAPHICS
   Model* model = luax_totype(L, index, Model);
   if (model) {
@@ -465,5 +487,5 @@ int luax_readmesh(lua_State* L, int index, float** vertices, uint32_t* vertexCou
   }
 #endif
 
-  return luaL_argerror(L, index, "table or Model");
+  return luaL_argerror(L, index, "table, Blob, or Model");
 }
@@ -40,6 +40,7 @@ extern StringEntry lovrFilterMode[];
 extern StringEntry lovrHeadsetDriver[];
 extern StringEntry lovrHeadsetOrigin[];
 extern StringEntry lovrHorizontalAlign[];
+extern StringEntry lovrImageFileFormat[];
 extern StringEntry lovrJointType[];
 extern StringEntry lovrKeyboardKey[];
 extern StringEntry lovrMaterialColor[];
@@ -117,6 +118,7 @@ int luax_readmesh(struct lua_State* L, int index, float** vertices, uint32_t* ve
 #ifndef LOVR_DISABLE_DATA
 struct Blob;
 struct Blob* luax_readblob(struct lua_State* L, int index, const char* debug);
+struct Blob* luax_mapblob(struct lua_State* L, int index, const char* debug);
 #endif
 
 #ifndef LOVR_DISABLE_EVENT
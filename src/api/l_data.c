@@ -6,9 +6,16 @@
 #include "data/image.h"
 #include <lua.h>
 #include <lauxlib.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+StringEntry lovrImageFileFormat[] = {
+  [IMAGE_PNG] = ENTRY("png"),
+  [IMAGE_TGA] = ENTRY("tga"),
+  { 0 }
+};
+
 static int l_lovrDataNewBlob(lua_State* L) {
   size_t size;
   uint8_t* data = NULL;
@@ -40,7 +47,7 @@ static int l_lovrDataNewBlob(lua_State* L) {
 }
 
 static int l_lovrDataNewModelData(lua_State* L) {
-  Blob* blob = luax_readblob(L, 1, "Model");
+  Blob* blob = luax_mapblob(L, 1, "Model");
   ModelData* modelData = lovrModelDataCreate(blob, luax_readfile);
   luax_pushtype(L, ModelData, modelData);
   lovrRelease(blob, lovrBlobDestroy);
@@ -120,9 +127,74 @@ static int l_lovrDataNewImage(lua_State* L) {
   return 1;
 }
 
+// Files are read on this thread, the decoding happens on workers
+static int l_lovrDataNewImages(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  bool flip = true;
+  bool async = false;
+
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "flip");
+    flip = lua_isnil(L, -1) ? flip : lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 2, "async");
+    async = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+  }
+
+  uint32_t count = luax_len(L, 1);
+  Blob** blobs = malloc(count * sizeof(Blob*));
+  lovrAssert(blobs || count == 0, "Out of memory");
+  for (uint32_t i = 0; i < count; i++) {
+    lua_rawgeti(L, 1, i + 1);
+    blobs[i] = luax_readblob(L, -1, "Image");
+    lua_pop(L, 1);
+  }
+
+  if (async) {
+    ImageBatch* batch = lovrImageBatchCreate(blobs, count, flip);
+    for (uint32_t i = 0; i < count; i++) {
+      lovrRelease(blobs[i], lovrBlobDestroy);
+    }
+    free(blobs);
+    luax_pushtype(L, ImageBatch, batch);
+    lovrRelease(batch, lovrImageBatchDestroy);
+    return 1;
+  }
+
+  Image** images = malloc(count * sizeof(Image*));
+  lovrAssert(images || count == 0, "Out of memory");
+  uint32_t failed = lovrImageCreateMany(blobs, count, flip, images);
+
+  if (failed != ~0u) {
+    char name[256];
+    snprintf(name, sizeof(name), "%s", blobs[failed]->name ? blobs[failed]->name : "");
+    for (uint32_t i = 0; i < count; i++) {
+      lovrRelease(blobs[i], lovrBlobDestroy);
+    }
+    free(images);
+    free(blobs);
+    lovrThrow("Could not load image from '%s'", name);
+  }
+
+  lua_createtable(L, count, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    luax_pushtype(L, Image, images[i]);
+    lua_rawseti(L, -2, i + 1);
+    lovrRelease(images[i], lovrImageDestroy);
+    lovrRelease(blobs[i], lovrBlobDestroy);
+  }
+
+  free(images);
+  free(blobs);
+  return 1;
+}
+
 static const luaL_Reg lovrData[] = {
   { "newBlob", l_lovrDataNewBlob },
   { "newImage", l_lovrDataNewImage },
+  { "newImages", l_lovrDataNewImages },
   { "newModelData", l_lovrDataNewModelData },
   { "newRasterizer", l_lovrDataNewRasterizer },
   { "newSound", l_lovrDataNewSound },
@@ -131,6 +203,7 @@ static const luaL_Reg lovrData[] = {
 
 extern const luaL_Reg lovrBlob[];
 extern const luaL_Reg lovrImage[];
+extern const luaL_Reg lovrImageBatch[];
 extern const luaL_Reg lovrModelData[];
 extern const luaL_Reg lovrRasterizer[];
 extern const luaL_Reg lovrSound[];
@@ -140,6 +213,7 @@ int luaopen_lovr_data(lua_State* L) {
   luax_register(L, lovrData);
   luax_registertype(L, Blob);
   luax_registertype(L, Image);
+  luax_registertype(L, ImageBatch);
   luax_registertype(L, ModelData);
   luax_registertype(L, Rasterizer);
   luax_registertype(L, Sound);
@@ -6,8 +6,10 @@
 
 static int l_lovrImageEncode(lua_State* L) {
   Image* image = luax_checktype(L, 1, Image);
-  Blob* blob = lovrImageEncode(image);
+  ImageFileFormat format = luax_checkenum(L, 2, ImageFileFormat, "png");
+  Blob* blob = lovrImageEncode(image, format);
   luax_pushtype(L, Blob, blob);
+  lovrRelease(blob, lovrBlobDestroy);
   return 1;
 }
 
@@ -75,6 +77,28 @@ static int l_lovrImageSetPixel(lua_State* L) {
   return 0;
 }
 
+static int l_lovrImageGetMipmapCount(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  lua_pushinteger(L, MAX(image->mipmapCount, 1));
+  return 1;
+}
+
+static int l_lovrImageGenerateMipmaps(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  lovrImageGenerateMipmaps(image);
+  return 0;
+}
+
+static int l_lovrImageResize(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  uint32_t width = luaL_checkinteger(L, 2);
+  uint32_t height = luaL_checkinteger(L, 3);
+  Image* resized = lovrImageResize(image, width, height);
+  luax_pushtype(L, Image, resized);
+  lovrRelease(resized, lovrImageDestroy);
+  return 1;
+}
+
 static int l_lovrImageGetBlob(lua_State* L) {
   Image* image = luax_checktype(L, 1, Image);
   Blob* blob = image->blob;
@@ -88,6 +112,9 @@ const luaL_Reg lovrImage[] = {
   { "getHeight", l_lovrImageGetHeight },
   { "getDimensions", l_lovrImageGetDimensions },
   { "getFormat", l_lovrImageGetFormat },
+  { "getMipmapCount", l_lovrImageGetMipmapCount },
+  { "generateMipmaps", l_lovrImageGenerateMipmaps },
+  { "resize", l_lovrImageResize },
   { "paste", l_lovrImagePaste },
   { "getPixel", l_lovrImageGetPixel },
   { "setPixel", l_lovrImageSetPixel },
@@ -0,0 +1,28 @@
+#include "api.h"
+#include "data/image.h"
+#include <lua.h>
+#include <lauxlib.h>
+
+static int l_lovrImageBatchIsReady(lua_State* L) {
+  ImageBatch* batch = luax_checktype(L, 1, ImageBatch);
+  lua_pushboolean(L, lovrImageBatchIsReady(batch));
+  return 1;
+}
+
+static int l_lovrImageBatchGetImages(lua_State* L) {
+  ImageBatch* batch = luax_checktype(L, 1, ImageBatch);
+  uint32_t count;
+  Image** images = lovrImageBatchGetImages(batch, &count);
+  lua_createtable(L, count, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    luax_pushtype(L, Image, images[i]);
+    lua_rawseti(L, -2, i + 1);
+  }
+  return 1;
+}
+
+const luaL_Reg lovrImageBatch[] = {
+  { "isReady", l_lovrImageBatchIsReady },
+  { "getImages", l_lovrImageBatchGetImages },
+  { NULL, NULL }
+};
@@ -3,6 +3,15 @@
 #include <lua.h>
 #include <lauxlib.h>
 
+static int l_lovrModelDataCompressAnimations(lua_State* L) {
+  ModelData* modelData = luax_checktype(L, 1, ModelData);
+  float sampleRate = luax_optfloat(L, 2, 30.f);
+  float tolerance = luax_optfloat(L, 3, .001f);
+  lovrModelDataCompressAnimations(modelData, sampleRate, tolerance);
+  return 0;
+}
+
 const luaL_Reg lovrModelData[] = {
+  { "compressAnimations", l_lovrModelDataCompressAnimations },
   { NULL, NULL }
 };
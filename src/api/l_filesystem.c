@@ -32,6 +32,22 @@ Blob* luax_readblob(lua_State* L, int index, const char* debug) {
   }
 }
 
+// Like luax_readblob, but files on disk are memory mapped instead of copied.  The Blob is read only,
+// so it shouldn't be given to Lua.
+Blob* luax_mapblob(lua_State* L, int index, const char* debug) {
+  if (lua_type(L, index) == LUA_TSTRING) {
+    const char* path = lua_tostring(L, index);
+
+    size_t size;
+    void* data = lovrFilesystemMap(path, &size);
+    if (data) {
+      return lovrBlobCreateMapped(data, size, path);
+    }
+  }
+
+  return luax_readblob(L, index, debug);
+}
+
 static void pushDirectoryItem(void* context, const char* path) {
   lua_State* L = context;
 
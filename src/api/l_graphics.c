@@ -2,6 +2,7 @@
 #include "graphics/graphics.h"
 #include "graphics/buffer.h"
 #include "graphics/canvas.h"
+#include "graphics/drawList.h"
 #include "graphics/material.h"
 #include "graphics/mesh.h"
 #include "graphics/model.h"
@@ -10,12 +11,14 @@
 #include "data/modelData.h"
 #include "data/rasterizer.h"
 #include "data/image.h"
+#include "filesystem/filesystem.h"
 #include "core/os.h"
 #include "core/util.h"
 #include <lua.h>
 #include <lauxlib.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 StringEntry lovrArcMode[] = {
@@ -320,6 +323,83 @@ static Image* luax_checkimage(lua_State* L, int index, bool flip) {
   return image;
 }
 
+// Cache files can be truncated, corrupted, or left over from other settings, so they're only used if
+// they decode to what would have been written: the right format with a full mipmap chain
+static bool isValidCachedImage(Image* image, TextureFormat format) {
+  bool either = format == FORMAT_RGBA;
+  if (either ? (image->format != FORMAT_DXT1 && image->format != FORMAT_DXT5) : image->format != format) {
+    return false;
+  }
+
+  if (image->width == 0 || image->height == 0) {
+    return false;
+  }
+
+  uint32_t levels = 1;
+  while ((MAX(image->width, image->height) >> levels) > 0) levels++;
+  return image->mipmapCount == levels;
+}
+
+// Like luax_checkimage, but the Image is compressed.  A format of rgba picks dxt1 for opaque images
+// and dxt5 otherwise.  Images loaded from files are cached in the save directory, keyed by the
+// contents of the file and the compression settings.
+static Image* luax_checkcompressedimage(lua_State* L, int index, bool flip, TextureFormat format) {
+  Image* image = luax_totype(L, index, Image);
+  Blob* blob = NULL;
+  char path[64];
+
+  if (image) {
+    lovrRetain(image);
+  } else {
+    blob = luax_readblob(L, index, "Texture");
+    uint64_t key[3] = { hash64(blob->data, blob->size), format, flip };
+    snprintf(path, sizeof(path), ".cache/textures/%016llx.dds", (unsigned long long) hash64(key, sizeof(key)));
+
+    // A bad cache file is replaced with a freshly compressed one
+    size_t size;
+    void* data = luax_readfile(path, &size);
+    if (data) {
+      Blob* cached = lovrBlobCreate(data, size, path);
+      bool valid = lovrImageCreateMany(&cached, 1, false, &image) == ~0u && isValidCachedImage(image, format);
+      lovrRelease(cached, lovrBlobDestroy);
+      if (valid) {
+        lovrRelease(blob, lovrBlobDestroy);
+        return image;
+      }
+      lovrRelease(image, lovrImageDestroy);
+    }
+
+    image = lovrImageCreateFromBlob(blob, flip);
+  }
+
+  if (image->format != FORMAT_RGBA) {
+    lovrRelease(blob, lovrBlobDestroy);
+    return image;
+  }
+
+  if (format == FORMAT_RGBA) {
+    format = FORMAT_DXT1;
+    uint8_t* pixels = image->blob->data;
+    for (size_t i = 3; i < image->blob->size; i += 4) {
+      if (pixels[i] < 255) {
+        format = FORMAT_DXT5;
+        break;
+      }
+    }
+  }
+
+  Image* compressed = lovrImageCompress(image, format);
+  lovrRelease(image, lovrImageDestroy);
+
+  if (blob && *lovrFilesystemGetSaveDirectory()) {
+    lovrFilesystemCreateDirectory(".cache/textures");
+    lovrFilesystemWrite(path, compressed->source->data, compressed->source->size, false);
+  }
+
+  lovrRelease(blob, lovrBlobDestroy);
+  return compressed;
+}
+
 // Base
 
 static int l_lovrGraphicsPresent(lua_State* L) {
@@ -526,6 +606,8 @@ static int l_lovrGraphicsGetFeatures(lua_State* L) {
   lua_setfield(L, -2, "multiview");
   lua_pushboolean(L, features->timers);
   lua_setfield(L, -2, "timers");
+  lua_pushboolean(L, features->wideDraws);
+  lua_setfield(L, -2, "widedraws");
   return 1;
 }
 
@@ -558,7 +640,7 @@ static int l_lovrGraphicsGetStats(lua_State* L) {
     luaL_checktype(L, 1, LUA_TTABLE);
     lua_settop(L, 1);
   } else {
-    lua_createtable(L, 0, 7);
+    lua_createtable(L, 0, 8);
   }
 
   lovrGraphicsFlush();
@@ -569,6 +651,8 @@ static int l_lovrGraphicsGetStats(lua_State* L) {
   lua_setfield(L, 1, "renderpasses");
   lua_pushinteger(L, stats->drawCalls);
   lua_setfield(L, 1, "drawcalls");
+  lua_pushinteger(L, stats->culled);
+  lua_setfield(L, 1, "culled");
   lua_pushinteger(L, stats->bufferCount);
   lua_setfield(L, 1, "buffers");
   lua_pushinteger(L, stats->textureCount);
@@ -690,6 +774,16 @@ static int l_lovrGraphicsSetCullingEnabled(lua_State* L) {
   return 0;
 }
 
+static int l_lovrGraphicsIsFrustumCullingEnabled(lua_State* L) {
+  lua_pushboolean(L, lovrGraphicsIsFrustumCullingEnabled());
+  return 1;
+}
+
+static int l_lovrGraphicsSetFrustumCullingEnabled(lua_State* L) {
+  lovrGraphicsSetFrustumCullingEnabled(lua_toboolean(L, 1));
+  return 0;
+}
+
 static int l_lovrGraphicsGetDefaultFilter(lua_State* L) {
   TextureFilter filter = lovrGraphicsGetDefaultFilter();
   luax_pushenum(L, FilterMode, filter.mode);
@@ -916,6 +1010,49 @@ static int l_lovrGraphicsFlush(lua_State* L) {
   return 0;
 }
 
+static int compareModels(const void* a, const void* b) {
+  uintptr_t x = (uintptr_t) *(Model**) a;
+  uintptr_t y = (uintptr_t) *(Model**) b;
+  return (x > y) - (x < y);
+}
+
+static int l_lovrGraphicsUpdateModels(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  int length = luax_len(L, 1);
+
+  for (int i = 1; i <= length; i++) {
+    lua_rawgeti(L, 1, i);
+    luax_checktype(L, -1, Model);
+    lua_pop(L, 1);
+  }
+
+  if (length == 0) {
+    return 0;
+  }
+
+  Model** models = malloc(length * sizeof(Model*));
+  lovrAssert(models, "Out of memory");
+
+  for (int i = 0; i < length; i++) {
+    lua_rawgeti(L, 1, i + 1);
+    models[i] = luax_totype(L, -1, Model);
+    lua_pop(L, 1);
+  }
+
+  // A Model can't be updated by two workers at once
+  qsort(models, length, sizeof(Model*), compareModels);
+  uint32_t count = 1;
+  for (int i = 1; i < length; i++) {
+    if (models[i] != models[count - 1]) {
+      models[count++] = models[i];
+    }
+  }
+
+  lovrModelUpdateMany(models, count);
+  free(models);
+  return 0;
+}
+
 static int l_lovrGraphicsPoints(lua_State* L) {
   float* vertices;
   uint32_t count = luax_getvertexcount(L, 1);
@@ -1220,6 +1357,13 @@ static int l_lovrGraphicsNewCanvas(lua_State* L) {
   return 1;
 }
 
+static int l_lovrGraphicsNewDrawList(lua_State* L) {
+  DrawList* list = lovrDrawListCreate();
+  luax_pushtype(L, DrawList, list);
+  lovrRelease(list, lovrDrawListDestroy);
+  return 1;
+}
+
 static int l_lovrGraphicsNewFont(lua_State* L) {
   Rasterizer* rasterizer = luax_totype(L, 1, Rasterizer);
   uint32_t padding = 2;
@@ -1379,7 +1523,7 @@ static int l_lovrGraphicsNewMesh(lua_State* L) {
 
   lovrMeshAttachAttribute(mesh, "lovrDrawID", &(MeshAttribute) {
     .buffer = lovrGraphicsGetIdentityBuffer(),
-    .type = U8,
+    .type = U16,
     .components = 1,
     .divisor = 1
   });
@@ -1389,7 +1533,12 @@ static int l_lovrGraphicsNewMesh(lua_State* L) {
 
     if (blob) {
       memcpy(data.raw, blob->data, count * stride);
+      lovrMeshUpdateBounds(mesh, blob->data, 0, count);
     } else {
+      // Decoded into a userdata so the bounds can read it back, and so it gets collected on errors
+      void* mapped = data.raw;
+      void* vertices = data.raw = lua_newuserdata(L, count * stride);
+
       for (uint32_t i = 0; i < count; i++) {
         lua_rawgeti(L, dataIndex, i + 1);
         lovrAssert(lua_istable(L, -1), "Vertices should be specified as a table of tables");
@@ -1414,6 +1563,10 @@ static int l_lovrGraphicsNewMesh(lua_State* L) {
 
         lua_pop(L, 1);
       }
+
+      memcpy(mapped, vertices, count * stride);
+      lovrMeshUpdateBounds(mesh, vertices, 0, count);
+      lua_pop(L, 1);
     }
 
     lovrBufferFlush(vertexBuffer, 0, count * stride);
@@ -1430,8 +1583,36 @@ static int l_lovrGraphicsNewMesh(lua_State* L) {
 static int l_lovrGraphicsNewModel(lua_State* L) {
   ModelData* modelData = luax_totype(L, 1, ModelData);
 
+  bool async = false;
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "async");
+    async = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+  }
+
+  // Async Models parse on a worker and create their GPU objects over the next few frames
+  if (async && !modelData) {
+    Blob* blob = luax_totype(L, 1, Blob);
+    const char* path = blob ? NULL : luaL_checkstring(L, 1);
+
+    // Mapping is cheap, and lets the worker skip reading the file
+    if (path) {
+      size_t size;
+      void* data = lovrFilesystemMap(path, &size);
+      blob = data ? lovrBlobCreateMapped(data, size, path) : NULL;
+    } else {
+      lovrRetain(blob);
+    }
+
+    Model* model = lovrModelCreateAsync(blob, path, luax_readfile);
+    luax_pushtype(L, Model, model);
+    lovrRelease(model, lovrModelDestroy);
+    lovrRelease(blob, lovrBlobDestroy);
+    return 1;
+  }
+
   if (!modelData) {
-    Blob* blob = luax_readblob(L, 1, "Model");
+    Blob* blob = luax_mapblob(L, 1, "Model");
     modelData = lovrModelDataCreate(blob, luax_readfile);
     lovrRelease(blob, lovrBlobDestroy);
   } else {
@@ -1667,6 +1848,8 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
   bool srgb = !blank;
   bool mipmaps = true;
   TextureFormat format = FORMAT_RGBA;
+  TextureFormat compression = FORMAT_RGBA;
+  bool compress = false;
   int msaa = 0;
 
   if (hasFlags) {
@@ -1689,8 +1872,21 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
     lua_getfield(L, index, "msaa");
     msaa = lua_isnil(L, -1) ? msaa : luaL_checkinteger(L, -1);
     lua_pop(L, 1);
+
+    lua_getfield(L, index, "compress");
+    if (lua_type(L, -1) == LUA_TSTRING) {
+      compression = (TextureFormat) luax_checkenum(L, -1, TextureFormat, NULL);
+      lovrAssert(compression == FORMAT_DXT1 || compression == FORMAT_DXT5, "Texture compression format must be 'dxt1' or 'dxt5'");
+      compress = true;
+    } else {
+      compress = lua_toboolean(L, -1);
+    }
+    lua_pop(L, 1);
   }
 
+  // Compression is skipped when the GPU can't use it
+  compress = compress && lovrGraphicsGetFeatures()->dxt && (type == TEXTURE_2D || type == TEXTURE_CUBE);
+
   Texture* texture = lovrTextureCreate(type, NULL, 0, srgb, mipmaps, msaa);
   lovrTextureSetFilter(texture, lovrGraphicsGetDefaultFilter());
 
@@ -1711,11 +1907,16 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
 
     for (int i = 0; i < depth; i++) {
       lua_rawgeti(L, 1, i + 1);
-      Image* image = luax_checkimage(L, -1, type != TEXTURE_CUBE);
+      bool flip = type != TEXTURE_CUBE;
+      Image* image = compress ? luax_checkcompressedimage(L, -1, flip, compression) : luax_checkimage(L, -1, flip);
       if (i == 0) {
+        // Every face of a cubemap needs to end up with the same format
+        if (image->format == FORMAT_DXT1 || image->format == FORMAT_DXT5) {
+          compression = image->format;
+        }
         lovrTextureAllocate(texture, image->width, image->height, depth, image->format);
       }
-      lovrTextureReplacePixels(texture, image, 0, 0, i, 0);
+      lovrTextureReplacePixels(texture, image, 0, 0, i, 0, false);
       lovrRelease(image, lovrImageDestroy);
       lua_pop(L, 1);
     }
@@ -1768,6 +1969,8 @@ static const luaL_Reg lovrGraphics[] = {
   { "setDepthTest", l_lovrGraphicsSetDepthTest },
   { "getFont", l_lovrGraphicsGetFont },
   { "setFont", l_lovrGraphicsSetFont },
+  { "isFrustumCullingEnabled", l_lovrGraphicsIsFrustumCullingEnabled },
+  { "setFrustumCullingEnabled", l_lovrGraphicsSetFrustumCullingEnabled },
   { "getLineWidth", l_lovrGraphicsGetLineWidth },
   { "setLineWidth", l_lovrGraphicsSetLineWidth },
   { "getPointSize", l_lovrGraphicsGetPointSize },
@@ -1794,6 +1997,7 @@ static const luaL_Reg lovrGraphics[] = {
   { "clear", l_lovrGraphicsClear },
   { "discard", l_lovrGraphicsDiscard },
   { "flush", l_lovrGraphicsFlush },
+  { "updateModels", l_lovrGraphicsUpdateModels },
   { "points", l_lovrGraphicsPoints },
   { "line", l_lovrGraphicsLine },
   { "plane", l_lovrGraphicsPlane },
@@ -1811,6 +2015,7 @@ static const luaL_Reg lovrGraphics[] = {
 
   // Types
   { "newCanvas", l_lovrGraphicsNewCanvas },
+  { "newDrawList", l_lovrGraphicsNewDrawList },
   { "newFont", l_lovrGraphicsNewFont },
   { "newMaterial", l_lovrGraphicsNewMaterial },
   { "newMesh", l_lovrGraphicsNewMesh },
@@ -1824,6 +2029,7 @@ static const luaL_Reg lovrGraphics[] = {
 };
 
 extern const luaL_Reg lovrCanvas[];
+extern const luaL_Reg lovrDrawList[];
 extern const luaL_Reg lovrFont[];
 extern const luaL_Reg lovrMaterial[];
 extern const luaL_Reg lovrMesh[];
@@ -1836,6 +2042,7 @@ int luaopen_lovr_graphics(lua_State* L) {
   lua_newtable(L);
   luax_register(L, lovrGraphics);
   luax_registertype(L, Canvas);
+  luax_registertype(L, DrawList);
   luax_registertype(L, Font);
   luax_registertype(L, Material);
   luax_registertype(L, Mesh);
@@ -1844,18 +2051,43 @@ int luaopen_lovr_graphics(lua_State* L) {
   luax_registertype(L, ShaderBlock);
   luax_registertype(L, Texture);
 
-  luax_pushconf(L);
-
   bool debug = false;
-  lua_getfield(L, -1, "graphics");
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  luax_pushconf(L);
   if (lua_istable(L, -1)) {
-    lua_getfield(L, -1, "debug");
-    debug = lua_toboolean(L, -1);
+    lua_getfield(L, -1, "graphics");
+    if (lua_istable(L, -1)) {
+      lua_getfield(L, -1, "debug");
+      debug = lua_toboolean(L, -1);
+      lua_pop(L, 1);
+
+      lua_getfield(L, -1, "streams");
+      if (lua_istable(L, -1)) {
+        lua_getfield(L, -1, "vertices");
+        lua_Integer vertices = luaL_optinteger(L, -1, 0);
+        lovrAssert(vertices >= 0 && vertices <= MAX_STREAM_VERTICES, "graphics.streams.vertices must be between 0 and %d", MAX_STREAM_VERTICES);
+        vertexCount = (uint32_t) vertices;
+        lua_pop(L, 1);
+
+        lua_getfield(L, -1, "indices");
+        lua_Integer indices = luaL_optinteger(L, -1, 0);
+        lovrAssert(indices >= 0 && indices <= MAX_STREAM_INDICES, "graphics.streams.indices must be between 0 and %d", MAX_STREAM_INDICES);
+        indexCount = (uint32_t) indices;
+        lua_pop(L, 1);
+      }
+      lua_pop(L, 1);
+    }
     lua_pop(L, 1);
   }
-  lua_pop(L, 1);
 
-  lovrGraphicsInit(debug);
+  // Threads don't have a conf, they only load the module to record DrawLists
+  if (lua_isnil(L, -1) || os_window_is_open()) {
+    lua_pop(L, 1);
+    return 1;
+  }
+
+  lovrGraphicsInit(debug, vertexCount, indexCount);
 
   lua_pushcfunction(L, l_lovrGraphicsCreateWindow);
   lua_getfield(L, -2, "window");
@@ -0,0 +1,131 @@
+#include "api.h"
+#include "graphics/graphics.h"
+#include "graphics/drawList.h"
+#include "graphics/material.h"
+#include "graphics/mesh.h"
+#include "graphics/shader.h"
+#include "core/util.h"
+#include <lua.h>
+#include <lauxlib.h>
+#include <math.h>
+
+static int l_lovrDrawListRecord(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  luaL_checktype(L, 2, LUA_TFUNCTION);
+  int argumentCount = lua_gettop(L) - 2;
+  lovrGraphicsBeginRecording(list);
+  int status = lua_pcall(L, argumentCount, 0, 0);
+  lovrGraphicsEndRecording();
+  if (status) {
+    lua_error(L);
+  }
+  return 0;
+}
+
+static int l_lovrDrawListSubmit(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  float transform[16];
+  luax_readmat4(L, 2, transform, 1);
+  lovrGraphicsSubmit(list, transform);
+  return 0;
+}
+
+static int l_lovrDrawListGetDrawCount(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  lua_pushinteger(L, lovrDrawListGetDrawCount(list));
+  return 1;
+}
+
+static int l_lovrDrawListClear(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  lovrDrawListClear(list);
+  return 0;
+}
+
+static int l_lovrDrawListSetColor(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  Color color;
+  luax_readcolor(L, 2, &color);
+  lovrDrawListSetColor(list, color);
+  return 0;
+}
+
+static int l_lovrDrawListSetShader(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  Shader* shader = lua_isnoneornil(L, 2) ? NULL : luax_checktype(L, 2, Shader);
+  lovrDrawListSetShader(list, shader);
+  return 0;
+}
+
+static int luax_rectangularprism(lua_State* L, int scaleComponents) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  DrawStyle style = STYLE_FILL;
+  Material* material = NULL;
+  if (lua_isuserdata(L, 2)) {
+    material = luax_checktype(L, 2, Material);
+  } else {
+    style = luax_checkenum(L, 2, DrawStyle, NULL);
+  }
+  float transform[16];
+  luax_readmat4(L, 3, transform, scaleComponents);
+  lovrDrawListBox(list, style, material, transform);
+  return 0;
+}
+
+static int l_lovrDrawListCube(lua_State* L) {
+  return luax_rectangularprism(L, 1);
+}
+
+static int l_lovrDrawListBox(lua_State* L) {
+  return luax_rectangularprism(L, 3);
+}
+
+static int l_lovrDrawListCylinder(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  float transform[16];
+  Material* material = luax_totype(L, 2, Material);
+  int index = material ? 3 : 2;
+  index = luax_readmat4(L, index, transform, 1);
+  float r1 = luax_optfloat(L, index++, 1.f);
+  float r2 = luax_optfloat(L, index++, 1.f);
+  bool capped = lua_isnoneornil(L, index) ? true : lua_toboolean(L, index++);
+  int segments = luaL_optinteger(L, index, (lua_Integer) floorf(16 + 16 * MAX(r1, r2)));
+  lovrDrawListCylinder(list, material, transform, r1, r2, capped, segments);
+  return 0;
+}
+
+static int l_lovrDrawListSphere(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  float transform[16];
+  Material* material = luax_totype(L, 2, Material);
+  int index = material ? 3 : 2;
+  index = luax_readmat4(L, index, transform, 1);
+  int segments = luaL_optinteger(L, index, 30);
+  lovrDrawListSphere(list, material, transform, segments);
+  return 0;
+}
+
+static int l_lovrDrawListDraw(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  Mesh* mesh = luax_checktype(L, 2, Mesh);
+  float transform[16];
+  int index = luax_readmat4(L, 3, transform, 1);
+  int instances = luaL_optinteger(L, index, 1);
+  lovrDrawListDrawMesh(list, mesh, transform, instances, NULL, 0);
+  return 0;
+}
+
+const luaL_Reg lovrDrawList[] = {
+  { "record", l_lovrDrawListRecord },
+  { "submit", l_lovrDrawListSubmit },
+  { "getDrawCount", l_lovrDrawListGetDrawCount },
+  { "clear", l_lovrDrawListClear },
+  { "setColor", l_lovrDrawListSetColor },
+  { "setShader", l_lovrDrawListSetShader },
+  { "cube", l_lovrDrawListCube },
+  { "box", l_lovrDrawListBox },
+  { "cylinder", l_lovrDrawListCylinder },
+  { "sphere", l_lovrDrawListSphere },
+  { "draw", l_lovrDrawListDraw },
+  { NULL, NULL }
+};
@@ -84,7 +84,7 @@ static int l_lovrMeshDraw(lua_State* L) {
   float transform[16];
   int index = luax_readmat4(L, 2, transform, 1);
   int instances = luaL_optinteger(L, index, 1);
-  lovrGraphicsDrawMesh(mesh, transform, instances, NULL);
+  lovrGraphicsDrawMesh(mesh, transform, instances, NULL, 0);
   return 0;
 }
 
@@ -177,7 +177,8 @@ static int l_lovrMeshSetVertex(lua_State* L) {
   }
 
   size_t stride = firstAttribute->stride;
-  AttributeData data = { .raw = lovrBufferMap(buffer, index * stride, false) };
+  uint8_t vertex[256] = { 0 };
+  AttributeData data = { .raw = vertex };
   int component = 0;
   for (uint32_t i = 0; i < attributeCount; i++) {
     const MeshAttribute* attribute = lovrMeshGetAttribute(mesh, i);
@@ -207,7 +208,9 @@ static int l_lovrMeshSetVertex(lua_State* L) {
       }
     }
   }
+  memcpy(lovrBufferMap(buffer, index * stride, false), vertex, stride);
   lovrBufferFlush(buffer, index * stride, stride);
+  lovrMeshUpdateBounds(mesh, vertex, index, 1);
   return 0;
 }
 
@@ -244,7 +247,8 @@ static int l_lovrMeshSetVertexAttribute(lua_State* L) {
   lovrAssert(vertexIndex < lovrMeshGetVertexCount(mesh), "Invalid mesh vertex: %d", vertexIndex + 1);
   const MeshAttribute* attribute = lovrMeshGetAttribute(mesh, attributeIndex);
   lovrAssert(attribute && attribute->buffer == buffer, "Invalid mesh attribute: %d", attributeIndex + 1);
-  AttributeData data = { .raw = lovrBufferMap(buffer, vertexIndex * attribute->stride + attribute->offset, false) };
+  uint8_t vertex[256] = { 0 };
+  AttributeData data = { .raw = vertex + attribute->offset };
   for (unsigned i = 0; i < attribute->components; i++) {
     int index = 4 + i;
     if (table) {
@@ -276,7 +280,12 @@ static int l_lovrMeshSetVertexAttribute(lua_State* L) {
     case U32: attributeSize = attribute->components * sizeof(uint32_t); break;
     case F32: attributeSize = attribute->components * sizeof(float); break;
   }
+  void* dst = lovrBufferMap(buffer, vertexIndex * attribute->stride + attribute->offset, false);
+  memcpy(dst, vertex + attribute->offset, attributeSize);
   lovrBufferFlush(buffer, vertexIndex * attribute->stride + attribute->offset, attributeSize);
+  if (attributeIndex == lovrMeshGetAttributeIndex(mesh, "lovrPosition")) {
+    lovrMeshUpdateBounds(mesh, vertex, vertexIndex, 1);
+  }
   return 0;
 }
 
@@ -302,6 +311,7 @@ static int l_lovrMeshSetVertices(lua_State* L) {
     void* data = lovrBufferMap(buffer, start * stride, false);
     memcpy(data, blob->data, count * stride);
     lovrBufferFlush(buffer, start * stride, count * stride);
+    lovrMeshUpdateBounds(mesh, blob->data, start, count);
     return 0;
   }
 
@@ -309,7 +319,9 @@ static int l_lovrMeshSetVertices(lua_State* L) {
   count = MIN(count, (uint32_t) luax_len(L, 2));
   lovrAssert(start + count <= capacity, "Overflow in Mesh:setVertices: Mesh can only hold %d vertices", capacity);
 
-  AttributeData data = { .raw = lovrBufferMap(buffer, start * stride, false) };
+  // Decoded into a userdata so the bounds can read it back, and so it gets collected on errors
+  void* vertices = lua_newuserdata(L, count * stride);
+  AttributeData data = { .raw = vertices };
 
   for (uint32_t i = 0; i < count; i++) {
     lua_rawgeti(L, 2, i + 1);
@@ -340,7 +352,10 @@ static int l_lovrMeshSetVertices(lua_State* L) {
     lua_pop(L, 1);
   }
 
+  memcpy(lovrBufferMap(buffer, start * stride, false), vertices, count * stride);
   lovrBufferFlush(buffer, start * stride, count * stride);
+  lovrMeshUpdateBounds(mesh, vertices, start, count);
+  lua_pop(L, 1);
   return 0;
 }
 
@@ -511,6 +526,33 @@ static int l_lovrMeshSetMaterial(lua_State* L) {
   return 0;
 }
 
+static int l_lovrMeshGetBounds(lua_State* L) {
+  Mesh* mesh = luax_checktype(L, 1, Mesh);
+  float aabb[6];
+  if (!lovrMeshGetBounds(mesh, aabb)) {
+    lua_pushnil(L);
+    return 1;
+  }
+  for (int i = 0; i < 6; i++) {
+    lua_pushnumber(L, aabb[i]);
+  }
+  return 6;
+}
+
+static int l_lovrMeshSetBounds(lua_State* L) {
+  Mesh* mesh = luax_checktype(L, 1, Mesh);
+  if (lua_isnoneornil(L, 2)) {
+    lovrMeshSetBounds(mesh, NULL);
+  } else {
+    float aabb[6];
+    for (int i = 0; i < 6; i++) {
+      aabb[i] = luax_checkfloat(L, 2 + i);
+    }
+    lovrMeshSetBounds(mesh, aabb);
+  }
+  return 0;
+}
+
 const luaL_Reg lovrMesh[] = {
   { "attachAttributes", l_lovrMeshAttachAttributes },
   { "detachAttributes", l_lovrMeshDetachAttributes },
@@ -532,5 +574,7 @@ const luaL_Reg lovrMesh[] = {
   { "setDrawRange", l_lovrMeshSetDrawRange },
   { "getMaterial", l_lovrMeshGetMaterial },
   { "setMaterial", l_lovrMeshSetMaterial },
+  { "getBounds", l_lovrMeshGetBounds },
+  { "setBounds", l_lovrMeshSetBounds },
   { NULL, NULL }
 };
@@ -1,11 +1,14 @@
 #include "api.h"
 #include "graphics/material.h"
 #include "graphics/model.h"
+#include "data/blob.h"
 #include "data/modelData.h"
 #include "core/maf.h"
 #include <lua.h>
 #include <lauxlib.h>
 
+#define MAX_BLEND_ANIMATIONS 16
+
 static uint32_t luax_checkanimation(lua_State* L, int index, Model* model) {
   switch (lua_type(L, index)) {
     case LUA_TSTRING: {
@@ -39,6 +42,23 @@ static int l_lovrModelAnimate(lua_State* L) {
   return 0;
 }
 
+static int l_lovrModelAnimateMany(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  uint32_t animations[MAX_BLEND_ANIMATIONS];
+  float times[MAX_BLEND_ANIMATIONS];
+  float weights[MAX_BLEND_ANIMATIONS];
+  uint32_t count = 0;
+  for (int index = 2; !lua_isnoneornil(L, index); index += 3) {
+    lovrAssert(count < MAX_BLEND_ANIMATIONS, "Too many animations (max is %d)", MAX_BLEND_ANIMATIONS);
+    animations[count] = luax_checkanimation(L, index, model);
+    times[count] = luaL_checknumber(L, index + 1);
+    weights[count] = luaL_checknumber(L, index + 2);
+    count++;
+  }
+  lovrModelAnimateMany(model, animations, times, weights, count);
+  return 0;
+}
+
 static int l_lovrModelPose(lua_State* L) {
   Model* model = luax_checktype(L, 1, Model);
 
@@ -131,6 +151,16 @@ static int l_lovrModelGetTriangles(lua_State* L) {
   return 2;
 }
 
+static int l_lovrModelGetTriangleBlobs(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  Blob* vertices;
+  Blob* indices;
+  lovrModelGetTriangleBlobs(model, &vertices, &indices);
+  luax_pushtype(L, Blob, vertices);
+  luax_pushtype(L, Blob, indices);
+  return 2;
+}
+
 static int l_lovrModelGetNodePose(lua_State* L) {
   Model* model = luax_checktype(L, 1, Model);
   uint32_t node;
@@ -223,13 +253,29 @@ static int l_lovrModelHasJoints(lua_State* L) {
   return 1;
 }
 
+static int l_lovrModelIsReady(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  lua_pushboolean(L, lovrModelIsReady(model));
+  return 1;
+}
+
+static int l_lovrModelGetProgress(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  lua_pushnumber(L, lovrModelGetProgress(model));
+  return 1;
+}
+
 const luaL_Reg lovrModel[] = {
   { "draw", l_lovrModelDraw },
+  { "isReady", l_lovrModelIsReady },
+  { "getProgress", l_lovrModelGetProgress },
   { "animate", l_lovrModelAnimate },
+  { "animateMany", l_lovrModelAnimateMany },
   { "pose", l_lovrModelPose },
   { "getMaterial", l_lovrModelGetMaterial },
   { "getAABB", l_lovrModelGetAABB },
   { "getTriangles", l_lovrModelGetTriangles },
+  { "getTriangleBlobs", l_lovrModelGetTriangleBlobs },
   { "getNodePose", l_lovrModelGetNodePose },
   { "getAnimationName", l_lovrModelGetAnimationName },
   { "getMaterialName", l_lovrModelGetMaterialName },
@@ -207,10 +207,29 @@ static int l_lovrShaderHasBlock(lua_State* L) {
   return 1;
 }
 
-static int l_lovrShaderSend(lua_State* L) {
+static int l_lovrShaderGetUniformId(lua_State* L) {
   Shader* shader = luax_checktype(L, 1, Shader);
   const char* name = luaL_checkstring(L, 2);
-  const Uniform* uniform = lovrShaderGetUniform(shader, name);
+  int id = lovrShaderGetUniformId(shader, name);
+  if (id < 0) {
+    lua_pushnil(L);
+  } else {
+    lua_pushinteger(L, id);
+  }
+  return 1;
+}
+
+// Uniforms can be sent by name or by an id from Shader:getUniformId, which skips the name lookup
+static int l_lovrShaderSend(lua_State* L) {
+  Shader* shader = luax_checktype(L, 1, Shader);
+  int id;
+  if (lua_type(L, 2) == LUA_TNUMBER) {
+    id = lua_tointeger(L, 2);
+  } else {
+    id = lovrShaderGetUniformId(shader, luaL_checkstring(L, 2));
+  }
+
+  const Uniform* uniform = lovrShaderGetUniformById(shader, id);
   if (!uniform) {
     lua_pushboolean(L, false);
     return 1;
@@ -221,14 +240,15 @@ static int l_lovrShaderSend(lua_State* L) {
     tempData.data = realloc(tempData.data, tempData.size);
   }
 
-  luax_checkuniform(L, 3, uniform, tempData.data, name);
+  luax_checkuniform(L, 3, uniform, tempData.data, uniform->name);
+  int count = uniform->count;
   switch (uniform->type) {
-    case UNIFORM_FLOAT: lovrShaderSetFloats(shader, uniform->name, tempData.data, 0, uniform->count * uniform->components); break;
-    case UNIFORM_INT: lovrShaderSetInts(shader, uniform->name, tempData.data, 0, uniform->count * uniform->components); break;
-    case UNIFORM_MATRIX: lovrShaderSetMatrices(shader, uniform->name, tempData.data, 0, uniform->count * uniform->components * uniform->components); break;
-    case UNIFORM_SAMPLER: lovrShaderSetTextures(shader, uniform->name, tempData.data, 0, uniform->count); break;
-    case UNIFORM_IMAGE: lovrShaderSetImages(shader, uniform->name, tempData.data, 0, uniform->count); break;
+    case UNIFORM_FLOAT: count *= uniform->components; break;
+    case UNIFORM_INT: count *= uniform->components; break;
+    case UNIFORM_MATRIX: count *= uniform->components * uniform->components; break;
+    default: break;
   }
+  lovrShaderSetUniformById(shader, id, uniform->type, tempData.data, 0, count);
   lua_pushboolean(L, true);
   return 1;
 }
@@ -267,6 +287,7 @@ const luaL_Reg lovrShader[] = {
   { "getType", l_lovrShaderGetType },
   { "hasUniform", l_lovrShaderHasUniform },
   { "hasBlock", l_lovrShaderHasBlock },
+  { "getUniformId", l_lovrShaderGetUniformId },
   { "send", l_lovrShaderSend },
   { "sendBlock", l_lovrShaderSendBlock },
   { "sendImage", l_lovrShaderSendImage },
@@ -90,7 +90,8 @@ static int l_lovrTextureReplacePixels(lua_State* L) {
   int y = luaL_optinteger(L, 4, 0);
   int slice = luaL_optinteger(L, 5, 1) - 1;
   int mipmap = luaL_optinteger(L, 6, 1) - 1;
-  lovrTextureReplacePixels(texture, image, x, y, slice, mipmap);
+  bool stream = lua_toboolean(L, 7);
+  lovrTextureReplacePixels(texture, image, x, y, slice, mipmap, stream);
   return 0;
 }
 
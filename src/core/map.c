@@ -58,6 +58,12 @@ void map_free(map_t* map) {
   free(map->hashes);
 }
 
+// Removes everything but keeps the memory, so the map can be refilled without allocating
+void map_clear(map_t* map) {
+  memset(map->hashes, 0xff, 2 * map->size * sizeof(uint64_t));
+  map->used = 0;
+}
+
 uint64_t map_get(map_t* map, uint64_t hash) {
   return map->values[map_find(map, hash)];
 }
@@ -3,6 +3,9 @@
 #include "event/event.h"
 #include "core/os.h"
 #include "core/util.h"
+#ifndef LOVR_DISABLE_THREAD
+#include "thread/job.h"
+#endif
 #include <lua.h>
 #include <lauxlib.h>
 #include <lualib.h>
@@ -38,6 +41,10 @@ int main(int argc, char** argv) {
   bool restart;
 
   do {
+#ifndef LOVR_DISABLE_THREAD
+    lovrJobInit();
+#endif
+
     lua_State* L = luaL_newstate();
     luax_setmainthread(L);
     luaL_openlibs(L);
@@ -97,6 +104,11 @@ int main(int argc, char** argv) {
       memset(&cookie.value, 0, sizeof(cookie.value));
     }
     lua_close(L);
+
+    // The worker pool is shared by several modules, so it outlives all of them
+#ifndef LOVR_DISABLE_THREAD
+    lovrJobDestroy();
+#endif
   } while (restart);
 
   os_destroy();
@@ -112,6 +124,9 @@ void lovrDestroy(void* arg) {
     lua_State* L = context->L;
     emscripten_cancel_main_loop();
     lua_close(L);
+#ifndef LOVR_DISABLE_THREAD
+    lovrJobDestroy();
+#endif
     os_destroy();
   }
 }
@@ -1,19 +1,36 @@
 #include "data/blob.h"
+#include "core/fs.h"
 #include "core/util.h"
 #include <stdlib.h>
+#include <string.h>
 
+// The name is copied into the same allocation, Blobs often outlive the string they were named with
 Blob* lovrBlobCreate(void* data, size_t size, const char* name) {
-  Blob* blob = calloc(1, sizeof(Blob));
+  size_t length = name ? strlen(name) + 1 : 0;
+  Blob* blob = calloc(1, sizeof(Blob) + length);
   lovrAssert(blob, "Out of memory");
   blob->ref = 1;
   blob->data = data;
   blob->size = size;
-  blob->name = name;
+  if (name) {
+    blob->name = memcpy(blob + 1, name, length);
+  }
+  return blob;
+}
+
+// Wraps a read only file mapping from fs_map, the pages are loaded from disk as they're touched
+Blob* lovrBlobCreateMapped(void* data, size_t size, const char* name) {
+  Blob* blob = lovrBlobCreate(data, size, name);
+  blob->mapped = true;
   return blob;
 }
 
 void lovrBlobDestroy(void* ref) {
   Blob* blob = ref;
-  free(blob->data);
+  if (blob->mapped) {
+    fs_unmap(blob->data, blob->size);
+  } else {
+    free(blob->data);
+  }
   free(blob);
 }
@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -8,7 +9,9 @@ typedef struct Blob {
   void* data;
   size_t size;
   const char* name;
+  bool mapped;
 } Blob;
 
 Blob* lovrBlobCreate(void* data, size_t size, const char* name);
+Blob* lovrBlobCreateMapped(void* data, size_t size, const char* name);
 void lovrBlobDestroy(void* ref);
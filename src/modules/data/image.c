@@ -1,11 +1,18 @@
 #include "data/image.h"
 #include "data/blob.h"
 #include "lib/stb/stb_image.h"
+#ifndef LOVR_DISABLE_THREAD
+#include "thread/job.h"
+#endif
 #include <stdlib.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
 
 #define FOUR_CC(a, b, c, d) ((uint32_t) (((d)<<24) | ((c)<<16) | ((b)<<8) | (a)))
+#define MAX_COMPRESSED_MIPMAPS 16
 
 static size_t getPixelSize(TextureFormat format) {
   switch (format) {
@@ -31,6 +38,56 @@ static size_t getPixelSize(TextureFormat format) {
   }
 }
 
+// Averages each 2x2 block of pixels, repeating the last row or column for odd sizes
+static void downsample(const uint8_t* src, uint32_t width, uint32_t height, uint32_t channels, uint8_t* dst) {
+  uint32_t w = MAX(width >> 1, 1);
+  uint32_t h = MAX(height >> 1, 1);
+  for (uint32_t y = 0; y < h; y++) {
+    const uint8_t* row0 = src + channels * width * MIN(2 * y, height - 1);
+    const uint8_t* row1 = src + channels * width * MIN(2 * y + 1, height - 1);
+    for (uint32_t x = 0; x < w; x++) {
+      uint32_t x0 = channels * MIN(2 * x, width - 1);
+      uint32_t x1 = channels * MIN(2 * x + 1, width - 1);
+      for (uint32_t c = 0; c < channels; c++) {
+        *dst++ = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2;
+      }
+    }
+  }
+}
+
+// Generated mipmaps go stale when the pixels change
+static void clearMipmaps(Image* image) {
+  if (image->mipmapData) {
+    free(image->mipmaps);
+    free(image->mipmapData);
+    image->mipmaps = NULL;
+    image->mipmapData = NULL;
+    image->mipmapCount = 0;
+  }
+}
+
+// Triangle filter weights for each destination pixel along one axis.  When shrinking, the filter
+// widens so every source pixel contributes.  Returns the number of taps per pixel.
+static uint32_t getFilterWeights(uint32_t srcLength, uint32_t dstLength, int32_t* first, float* weights) {
+  float scale = (float) srcLength / dstLength;
+  float radius = MAX(scale, 1.f);
+  uint32_t taps = 2 * (uint32_t) ceilf(radius) + 1;
+  for (uint32_t i = 0; i < dstLength; i++) {
+    float center = (i + .5f) * scale - .5f;
+    float total = 0.f;
+    first[i] = (int32_t) floorf(center - radius) + 1;
+    for (uint32_t t = 0; t < taps; t++) {
+      float weight = MAX(1.f - fabsf(first[i] + (int32_t) t - center) / radius, 0.f);
+      weights[i * taps + t] = weight;
+      total += weight;
+    }
+    for (uint32_t t = 0; t < taps; t++) {
+      weights[i * taps + t] /= total;
+    }
+  }
+  return taps;
+}
+
 // Modified from ddsparse (https://bitbucket.org/slime73/ddsparse)
 static bool parseDDS(uint8_t* data, size_t size, Image* image) {
   enum {
@@ -373,7 +430,7 @@ static bool parseKTX(uint8_t* bytes, size_t size, Image* image) {
     case 0x93BB: case 0x93DB: image->format = FORMAT_ASTC_10x10; break;
     case 0x93BC: case 0x93DC: image->format = FORMAT_ASTC_12x10; break;
     case 0x93BD: case 0x93DD: image->format = FORMAT_ASTC_12x12; break;
-    default: lovrThrow("Unsupported KTX format '%d' (please open an issue)", data.ktx->glInternalFormat);
+    default: return false; // Unsupported format, this can run on a worker so it can't throw
   }
 
   uint32_t width = image->width = data.ktx->pixelWidth;
@@ -430,7 +487,7 @@ static bool parseASTC(uint8_t* bytes, size_t size, Image* image) {
   else if (bx == 10 && by == 10 && bz == 1) { image->format = FORMAT_ASTC_10x10; }
   else if (bx == 12 && by == 10 && bz == 1) { image->format = FORMAT_ASTC_12x10; }
   else if (bx == 12 && by == 12 && bz == 1) { image->format = FORMAT_ASTC_12x12; }
-  else { lovrThrow("Unsupported ASTC format %dx%dx%d", bx, by, bz); }
+  else { return false; }
 
   image->width = data.astc->width[0] + (data.astc->width[1] << 8) + (data.astc->width[2] << 16);
   image->height = data.astc->height[0] + (data.astc->height[1] << 8) + (data.astc->height[2] << 16);
@@ -476,11 +533,19 @@ Image* lovrImageCreate(uint32_t width, uint32_t height, Blob* contents, uint8_t
   return image;
 }
 
-Image* lovrImageCreateFromBlob(Blob* blob, bool flip) {
+// Returns NULL instead of throwing when the image can't be decoded, so it can run on worker threads
+static Image* decodeImage(Blob* blob, bool flip) {
   Image* image = calloc(1, sizeof(Image));
-  lovrAssert(image, "Out of memory");
+  Blob* pixels = calloc(1, sizeof(Blob));
+  if (!image || !pixels) {
+    free(image);
+    free(pixels);
+    return NULL;
+  }
+
   image->ref = 1;
-  image->blob = lovrBlobCreate(NULL, 0, NULL);
+  image->blob = pixels;
+  image->blob->ref = 1;
   if (parseDDS(blob->data, blob->size, image)) {
     image->source = blob;
     lovrRetain(blob);
@@ -514,8 +579,10 @@ Image* lovrImageCreateFromBlob(Blob* blob, bool flip) {
         image->format = FORMAT_RGBA16;
         image->blob->size = 8 * width * height;
         break;
-      default:
-        lovrThrow("Unsupported channel count for 16 bit image: %d", channels);
+      default: // Unsupported channel count
+        stbi_image_free(image->blob->data);
+        image->blob->data = NULL;
+        break;
     }
   } else if (stbi_is_hdr_from_memory(blob->data, length)) {
     image->format = FORMAT_RGBA32F;
@@ -528,7 +595,6 @@ Image* lovrImageCreateFromBlob(Blob* blob, bool flip) {
   }
 
   if (!image->blob->data) {
-    lovrThrow("Could not load image from '%s'", blob->name);
     lovrRelease(image->blob, lovrBlobDestroy);
     free(image);
     return NULL;
@@ -540,10 +606,169 @@ Image* lovrImageCreateFromBlob(Blob* blob, bool flip) {
   return image;
 }
 
+Image* lovrImageCreateFromBlob(Blob* blob, bool flip) {
+  Image* image = decodeImage(blob, flip);
+  lovrAssert(image, "Could not load image from '%s'", blob->name);
+  return image;
+}
+
+// Each Image is decoded by its own task, which takes the next index.  The remaining count reaches
+// zero once every Image is done.
+typedef struct {
+  Blob** blobs;
+  Image** images;
+  bool flip;
+  atomic_uint next;
+  atomic_uint remaining;
+} DecodeJob;
+
+// Returns whether this was the last Image to finish
+static bool decodeNext(DecodeJob* job) {
+  uint32_t i = atomic_fetch_add(&job->next, 1);
+  job->images[i] = job->blobs[i] ? decodeImage(job->blobs[i], job->flip) : NULL;
+  return atomic_fetch_sub(&job->remaining, 1) == 1;
+}
+
+static void decodeImages(void* context, uint32_t index) {
+  decodeNext(context);
+}
+
+// Images are decoded in parallel, NULL Blobs are skipped and give NULL Images.  If any of the Images
+// fail to load, the rest are released and the index of the first one that failed is returned, so the
+// caller can clean up before throwing.  Otherwise ~0u is returned.  This also works from a background
+// task (like an async Model load), since the waiting thread decodes any Images the workers haven't
+// gotten to.
+uint32_t lovrImageCreateMany(Blob** blobs, uint32_t count, bool flip, Image** images) {
+  DecodeJob job = { .blobs = blobs, .images = images, .flip = flip };
+  atomic_fetch_add(&job.remaining, count);
+  for (uint32_t i = 0; i < count; i++) {
+#ifndef LOVR_DISABLE_THREAD
+    lovrJobSubmit(decodeImages, &job);
+#else
+    decodeImages(&job, 0);
+#endif
+  }
+
+#ifndef LOVR_DISABLE_THREAD
+  lovrJobWait(&job, &job.remaining);
+#endif
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (blobs[i] && !images[i]) {
+      for (uint32_t j = 0; j < count; j++) {
+        lovrRelease(images[j], lovrImageDestroy);
+        images[j] = NULL;
+      }
+      return i;
+    }
+  }
+
+  return ~0u;
+}
+
+struct ImageBatch {
+  uint32_t ref;
+  uint32_t count;
+  Blob** blobs;
+  Image** images;
+  DecodeJob job;
+  atomic_uint status; // Only fetch operations are used, the bundled stdatomic shim lacks the rest
+};
+
+enum {
+  BATCH_PENDING,
+  BATCH_DONE,
+  BATCH_FAILED
+};
+
+// The task that finishes the last Image sets the status
+static void decodeBatch(void* context, uint32_t index) {
+  ImageBatch* batch = context;
+
+  if (decodeNext(&batch->job)) {
+    bool failed = false;
+    for (uint32_t i = 0; i < batch->count; i++) {
+      failed |= batch->blobs[i] && !batch->images[i];
+    }
+
+    atomic_fetch_add(&batch->status, failed ? BATCH_FAILED : BATCH_DONE);
+  }
+
+  lovrRelease(batch, lovrImageBatchDestroy);
+}
+
+// Like lovrImageCreateMany, but decoding happens in the background
+ImageBatch* lovrImageBatchCreate(Blob** blobs, uint32_t count, bool flip) {
+  ImageBatch* batch = calloc(1, sizeof(ImageBatch));
+  lovrAssert(batch, "Out of memory");
+  batch->ref = 1;
+  batch->count = count;
+  batch->blobs = malloc(count * sizeof(Blob*));
+  batch->images = calloc(count, sizeof(Image*));
+  lovrAssert((batch->blobs && batch->images) || count == 0, "Out of memory");
+
+  for (uint32_t i = 0; i < count; i++) {
+    batch->blobs[i] = blobs[i];
+    lovrRetain(blobs[i]);
+  }
+
+  if (count == 0) {
+    atomic_fetch_add(&batch->status, BATCH_DONE);
+    return batch;
+  }
+
+  batch->job.blobs = batch->blobs;
+  batch->job.images = batch->images;
+  batch->job.flip = flip;
+  atomic_fetch_add(&batch->job.remaining, count);
+
+  // Each task holds a reference until it's done
+  for (uint32_t i = 0; i < count; i++) {
+    lovrRetain(batch);
+#ifndef LOVR_DISABLE_THREAD
+    lovrJobSubmit(decodeBatch, batch);
+#else
+    decodeBatch(batch, 0);
+#endif
+  }
+
+  return batch;
+}
+
+void lovrImageBatchDestroy(void* ref) {
+  ImageBatch* batch = ref;
+  for (uint32_t i = 0; i < batch->count; i++) {
+    lovrRelease(batch->blobs[i], lovrBlobDestroy);
+    lovrRelease(batch->images[i], lovrImageDestroy);
+  }
+  free(batch->blobs);
+  free(batch->images);
+  free(batch);
+}
+
+bool lovrImageBatchIsReady(ImageBatch* batch) {
+  uint32_t status = atomic_fetch_add(&batch->status, 0);
+  if (status == BATCH_FAILED) {
+    for (uint32_t i = 0; i < batch->count; i++) {
+      if (batch->blobs[i] && !batch->images[i]) {
+        lovrThrow("Could not load image from '%s'", batch->blobs[i]->name);
+      }
+    }
+  }
+  return status == BATCH_DONE;
+}
+
+Image** lovrImageBatchGetImages(ImageBatch* batch, uint32_t* count) {
+  lovrAssert(lovrImageBatchIsReady(batch), "Images are still loading");
+  *count = batch->count;
+  return batch->images;
+}
+
 void lovrImageDestroy(void* ref) {
   Image* image = ref;
   lovrRelease(image->source, lovrBlobDestroy);
   free(image->mipmaps);
+  free(image->mipmapData);
   lovrRelease(image->blob, lovrBlobDestroy);
   free(image);
 }
@@ -568,6 +793,7 @@ Color lovrImageGetPixel(Image* image, uint32_t x, uint32_t y) {
 void lovrImageSetPixel(Image* image, uint32_t x, uint32_t y, Color color) {
   lovrAssert(image->blob->data, "Image does not have any pixel data");
   lovrAssert(x < image->width && y < image->height, "setPixel coordinates must be within Image bounds");
+  clearMipmaps(image);
   size_t index = (image->height - (y + 1)) * image->width + x;
   size_t pixelSize = getPixelSize(image->format);
   uint8_t* u8 = (uint8_t*) image->blob->data + pixelSize * index;
@@ -606,45 +832,350 @@ void lovrImageSetPixel(Image* image, uint32_t x, uint32_t y, Color color) {
   }
 }
 
-static uint32_t crc_lookup[256];
-static bool crc_ready = false;
-static void crc_init(void) {
-  if (!crc_ready) {
-    crc_ready = true;
-    for (uint32_t i = 0; i < 256; i++) {
-      uint32_t x = i;
-      for (uint32_t b = 0; b < 8; b++) {
-        if (x & 1) {
-          x = 0xedb88320L ^ (x >> 1);
-        } else {
-          x >>= 1;
+// Stores a box filtered mipmap chain after the base level.  Textures created from the Image upload
+// these instead of generating mipmaps on the GPU.
+void lovrImageGenerateMipmaps(Image* image) {
+  lovrAssert(image->format == FORMAT_RGB || image->format == FORMAT_RGBA, "Mipmaps can only be generated for rgb and rgba Images");
+  lovrAssert(image->blob->data, "Image does not have any pixel data");
+  clearMipmaps(image);
+
+  uint32_t channels = (uint32_t) getPixelSize(image->format);
+  uint32_t count = 1;
+  while (((uint64_t) MAX(image->width, image->height) >> count) > 0) count++;
+
+  size_t size = 0;
+  for (uint32_t i = 1; i < count; i++) {
+    size += (size_t) MAX(image->width >> i, 1) * MAX(image->height >> i, 1) * channels;
+  }
+
+  image->mipmaps = malloc(count * sizeof(Mipmap));
+  image->mipmapData = malloc(size);
+  lovrAssert(image->mipmaps && (image->mipmapData || size == 0), "Out of memory");
+  image->mipmapCount = count;
+  image->mipmaps[0] = (Mipmap) {
+    .width = image->width,
+    .height = image->height,
+    .size = image->blob->size,
+    .data = image->blob->data
+  };
+
+  uint8_t* data = image->mipmapData;
+  for (uint32_t i = 1; i < count; i++) {
+    Mipmap* parent = &image->mipmaps[i - 1];
+    uint32_t width = MAX(parent->width >> 1, 1);
+    uint32_t height = MAX(parent->height >> 1, 1);
+    image->mipmaps[i] = (Mipmap) { .width = width, .height = height, .size = width * height * channels, .data = data };
+    downsample(parent->data, parent->width, parent->height, channels, data);
+    data += image->mipmaps[i].size;
+  }
+}
+
+// Resamples with a separable triangle filter, going through a float buffer between the passes
+Image* lovrImageResize(Image* image, uint32_t width, uint32_t height) {
+  lovrAssert(image->format == FORMAT_RGB || image->format == FORMAT_RGBA, "Only rgb and rgba Images can be resized");
+  lovrAssert(image->blob->data, "Image does not have any pixel data");
+  lovrAssert(width > 0 && height > 0, "Image dimensions must be positive");
+
+  Image* result = lovrImageCreate(width, height, NULL, 0x0, image->format);
+  uint32_t channels = (uint32_t) getPixelSize(image->format);
+  uint32_t srcWidth = image->width;
+  uint32_t srcHeight = image->height;
+
+  uint32_t maxTapsX = 2 * (uint32_t) ceilf(MAX((float) srcWidth / width, 1.f)) + 1;
+  uint32_t maxTapsY = 2 * (uint32_t) ceilf(MAX((float) srcHeight / height, 1.f)) + 1;
+  int32_t* firstX = malloc(width * sizeof(int32_t));
+  int32_t* firstY = malloc(height * sizeof(int32_t));
+  float* weightsX = malloc(width * maxTapsX * sizeof(float));
+  float* weightsY = malloc(height * maxTapsY * sizeof(float));
+  float* buffer = malloc((size_t) width * srcHeight * channels * sizeof(float));
+  lovrAssert(firstX && firstY && weightsX && weightsY && buffer, "Out of memory");
+  uint32_t tapsX = getFilterWeights(srcWidth, width, firstX, weightsX);
+  uint32_t tapsY = getFilterWeights(srcHeight, height, firstY, weightsY);
+
+  // Horizontal
+  uint8_t* src = image->blob->data;
+  for (uint32_t y = 0; y < srcHeight; y++) {
+    uint8_t* row = src + (size_t) y * srcWidth * channels;
+    float* out = buffer + (size_t) y * width * channels;
+    for (uint32_t x = 0; x < width; x++, out += channels) {
+      float sum[4] = { 0.f };
+      for (uint32_t t = 0; t < tapsX; t++) {
+        float weight = weightsX[x * tapsX + t];
+        uint8_t* pixel = row + channels * (uint32_t) CLAMP(firstX[x] + (int32_t) t, 0, (int32_t) srcWidth - 1);
+        for (uint32_t c = 0; c < channels; c++) {
+          sum[c] += pixel[c] * weight;
         }
-        crc_lookup[i] = x;
       }
+      memcpy(out, sum, channels * sizeof(float));
     }
   }
+
+  // Vertical
+  uint8_t* dst = result->blob->data;
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++, dst += channels) {
+      float sum[4] = { 0.f };
+      for (uint32_t t = 0; t < tapsY; t++) {
+        float weight = weightsY[y * tapsY + t];
+        uint32_t row = (uint32_t) CLAMP(firstY[y] + (int32_t) t, 0, (int32_t) srcHeight - 1);
+        float* pixel = buffer + ((size_t) row * width + x) * channels;
+        for (uint32_t c = 0; c < channels; c++) {
+          sum[c] += pixel[c] * weight;
+        }
+      }
+      for (uint32_t c = 0; c < channels; c++) {
+        dst[c] = (uint8_t) CLAMP(sum[c] + .5f, 0.f, 255.f);
+      }
+    }
+  }
+
+  free(firstX);
+  free(firstY);
+  free(weightsX);
+  free(weightsY);
+  free(buffer);
+  return result;
 }
 
-static uint32_t crc32(uint8_t* data, size_t length) {
+// PNG encoding
+
+typedef struct {
+  uint32_t crc[8][256];
+  uint8_t lengthCodes[259];
+  uint8_t distanceCodes[512];
+  uint16_t codes[288];
+  uint8_t codeLengths[288];
+  uint8_t* data;
+  uint64_t bits;
+  uint32_t bitCount;
+} PNGEncoder;
+
+static const uint16_t lengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const uint8_t lengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t distanceBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+  4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const uint8_t distanceExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static uint32_t reverseBits(uint32_t code, uint32_t length) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < length; i++) {
+    result = (result << 1) | ((code >> i) & 1);
+  }
+  return result;
+}
+
+// The tables are cheap to build, and building them per encode keeps encoding safe to use on threads
+static void initEncoder(PNGEncoder* encoder) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t x = i;
+    for (uint32_t b = 0; b < 8; b++) {
+      x = (x & 1) ? (0xedb88320 ^ (x >> 1)) : (x >> 1);
+    }
+    encoder->crc[0][i] = x;
+  }
+
+  for (uint32_t i = 0; i < 256; i++) {
+    for (uint32_t t = 1; t < 8; t++) {
+      uint32_t x = encoder->crc[t - 1][i];
+      encoder->crc[t][i] = (x >> 8) ^ encoder->crc[0][x & 0xff];
+    }
+  }
+
+  for (uint32_t i = 0, code = 0; i <= 258; i++) {
+    while (code < 28 && lengthBase[code + 1] <= i) code++;
+    encoder->lengthCodes[i] = code;
+  }
+
+  // Distances up to 256 are looked up directly, larger ones by their upper bits
+  for (uint32_t i = 0, code = 0; i < 256; i++) {
+    while (code < 29 && distanceBase[code + 1] <= i + 1) code++;
+    encoder->distanceCodes[i] = code;
+  }
+
+  for (uint32_t i = 0, code = 0; i < 256; i++) {
+    while (code < 29 && distanceBase[code + 1] <= (i << 7) + 1) code++;
+    encoder->distanceCodes[256 + i] = code;
+  }
+
+  // Fixed huffman codes (deflate writes them starting from the most significant bit)
+  for (uint32_t i = 0; i < 288; i++) {
+    uint32_t code, length;
+    if (i < 144) code = 0x30 + i, length = 8;
+    else if (i < 256) code = 0x190 + (i - 144), length = 9;
+    else if (i < 280) code = i - 256, length = 7;
+    else code = 0xc0 + (i - 280), length = 8;
+    encoder->codes[i] = reverseBits(code, length);
+    encoder->codeLengths[i] = length;
+  }
+}
+
+static uint32_t crc32(PNGEncoder* encoder, uint8_t* data, size_t length) {
+  uint32_t (*table)[256] = encoder->crc;
   uint32_t c = 0xffffffff;
-  for (size_t i = 0; i < length; i++) c = crc_lookup[(c ^ data[i]) & 0xff] ^ (c >> 8);
+
+  // Slicing by 8
+  while (length >= 8) {
+    uint32_t a = c ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24));
+    c =
+      table[7][a & 0xff] ^ table[6][(a >> 8) & 0xff] ^ table[5][(a >> 16) & 0xff] ^ table[4][a >> 24] ^
+      table[3][data[4]] ^ table[2][data[5]] ^ table[1][data[6]] ^ table[0][data[7]];
+    data += 8;
+    length -= 8;
+  }
+
+  while (length--) {
+    c = table[0][(c ^ *data++) & 0xff] ^ (c >> 8);
+  }
+
   return c ^ 0xffffffff;
 }
 
-Blob* lovrImageEncode(Image* image) {
-  lovrAssert(image->format == FORMAT_RGBA, "Only RGBA Image can be encoded");
+// The sums are only reduced every 5552 bytes, the most that can be added without overflow
+static uint32_t adler32(uint8_t* data, size_t length) {
+  uint32_t s1 = 1, s2 = 0;
+  while (length > 0) {
+    size_t n = MIN(length, 5552);
+    length -= n;
+    while (n >= 8) {
+      s1 += data[0]; s2 += s1;
+      s1 += data[1]; s2 += s1;
+      s1 += data[2]; s2 += s1;
+      s1 += data[3]; s2 += s1;
+      s1 += data[4]; s2 += s1;
+      s1 += data[5]; s2 += s1;
+      s1 += data[6]; s2 += s1;
+      s1 += data[7]; s2 += s1;
+      data += 8;
+      n -= 8;
+    }
+    while (n--) {
+      s1 += *data++;
+      s2 += s1;
+    }
+    s1 %= 65521;
+    s2 %= 65521;
+  }
+  return (s2 << 16) | s1;
+}
+
+static void writeBits(PNGEncoder* encoder, uint32_t value, uint32_t count) {
+  encoder->bits |= (uint64_t) value << encoder->bitCount;
+  encoder->bitCount += count;
+  while (encoder->bitCount >= 8) {
+    *encoder->data++ = encoder->bits & 0xff;
+    encoder->bits >>= 8;
+    encoder->bitCount -= 8;
+  }
+}
+
+static void writeSymbol(PNGEncoder* encoder, uint32_t symbol) {
+  writeBits(encoder, encoder->codes[symbol], encoder->codeLengths[symbol]);
+}
+
+// A single fixed huffman block with greedy matches found using a hash of the next 4 bytes.  It
+// doesn't compress as well as zlib, but it's a lot faster and filtered images compress well anyway.
+static void deflate(PNGEncoder* encoder, uint8_t* data, size_t size) {
+  enum { HASH_BITS = 15, WINDOW = 32768, MAX_MATCH = 258 };
+  uint32_t* table = malloc((1 << HASH_BITS) * sizeof(uint32_t));
+  lovrAssert(table, "Out of memory");
+  memset(table, 0xff, (1 << HASH_BITS) * sizeof(uint32_t));
+
+  writeBits(encoder, 1, 1); // Final block
+  writeBits(encoder, 1, 2); // Fixed huffman codes
+
+  size_t i = 0;
+  while (i + 4 <= size) {
+    uint32_t next;
+    memcpy(&next, data + i, 4);
+    uint32_t hash = (next * 2654435761u) >> (32 - HASH_BITS);
+    uint32_t candidate = table[hash];
+    table[hash] = (uint32_t) i;
+
+    size_t length = 0;
+    if (candidate != ~0u && i - candidate <= WINDOW && !memcmp(data + candidate, data + i, 4)) {
+      size_t limit = MIN(size - i, MAX_MATCH);
+      length = 4;
+      while (length < limit && data[candidate + length] == data[i + length]) {
+        length++;
+      }
+    }
+
+    if (length == 0) {
+      writeSymbol(encoder, data[i++]);
+      continue;
+    }
+
+    uint32_t distance = (uint32_t) (i - candidate);
+    uint32_t lengthCode = encoder->lengthCodes[length];
+    uint32_t distanceCode = encoder->distanceCodes[distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7)];
+    writeSymbol(encoder, 257 + lengthCode);
+    writeBits(encoder, (uint32_t) length - lengthBase[lengthCode], lengthExtra[lengthCode]);
+    writeBits(encoder, reverseBits(distanceCode, 5), 5);
+    writeBits(encoder, distance - distanceBase[distanceCode], distanceExtra[distanceCode]);
+    i += length;
+  }
+
+  while (i < size) {
+    writeSymbol(encoder, data[i++]);
+  }
+
+  writeSymbol(encoder, 256);
+  writeBits(encoder, 0, 7); // Flush
+  free(table);
+}
+
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+  int p = a + b - c;
+  int pa = abs(p - a);
+  int pb = abs(p - b);
+  int pc = abs(p - c);
+  return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+// Tries every filter on a row and keeps the one with the smallest sum of absolute differences
+static void filterRow(uint8_t* row, uint8_t* previous, size_t size, uint8_t* scratch, uint8_t* out) {
+  uint32_t bestScore = ~0u;
+  for (uint8_t filter = 0; filter < 5; filter++) {
+    uint32_t score = 0;
+    for (size_t i = 0; i < size; i++) {
+      uint8_t a = i >= 4 ? row[i - 4] : 0;
+      uint8_t b = previous ? previous[i] : 0;
+      uint8_t c = previous && i >= 4 ? previous[i - 4] : 0;
+      uint8_t x = row[i];
+      switch (filter) {
+        case 0: break;
+        case 1: x -= a; break;
+        case 2: x -= b; break;
+        case 3: x -= (a + b) >> 1; break;
+        case 4: x -= paeth(a, b, c); break;
+      }
+      scratch[i] = x;
+      score += x < 128 ? x : 256 - x;
+    }
+
+    if (score < bestScore) {
+      bestScore = score;
+      out[0] = filter;
+      memcpy(out + 1, scratch, size);
+    }
+  }
+}
+
+static Blob* encodePNG(Image* image) {
   uint32_t w = image->width;
   uint32_t h = image->height;
   uint8_t* pixels = (uint8_t*) image->blob->data + (h - 1) * w * 4;
-  int32_t stride = -1 * (int) (w * 4);
-
-  // The world's worst png encoder
-  // Encoding uses one unfiltered IDAT chunk, each row is an uncompressed huffman block
-  // The total IDAT chunk data size is
-  // - 2 bytes for the zlib header
-  // - 6 bytes per block (5 bytes for the huffman block header + 1 byte scanline filter prefix)
-  // - n bytes for the image data itself (width * height * 4)
-  // - 4 bytes for the adler32 checksum
 
   uint8_t signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
   uint8_t header[13] = {
@@ -653,94 +1184,121 @@ Blob* lovrImageEncode(Image* image) {
     8, 6, 0, 0, 0
   };
 
+  PNGEncoder* encoder = malloc(sizeof(PNGEncoder));
+  lovrAssert(encoder, "Out of memory");
+  initEncoder(encoder);
+
+  // Filter each scanline, prefixing it with the filter type.  Rows are stored bottom to top.
   size_t rowSize = w * 4;
-  size_t imageSize = rowSize * h;
-  size_t blockSize = rowSize + 1;
-  size_t idatSize = 2 + (h * (5 + 1)) + imageSize + 4;
-
-  size_t size = sizeof(signature);
-  size += 4 + strlen("IHDR") + sizeof(header) + 4;
-  size += 4 + strlen("IDAT") + idatSize + 4;
-  size += 4 + strlen("IEND") + 4;
-  uint8_t* data = malloc(size);
-  lovrAssert(data, "Out of memory");
+  size_t filteredSize = (rowSize + 1) * h;
+  uint8_t* filtered = malloc(filteredSize + rowSize);
+  lovrAssert(filtered, "Out of memory");
+  uint8_t* scratch = filtered + filteredSize;
+  for (uint32_t y = 0; y < h; y++) {
+    uint8_t* row = pixels - y * rowSize;
+    uint8_t* previous = y > 0 ? row + rowSize : NULL;
+    filterRow(row, previous, rowSize, scratch, filtered + y * (rowSize + 1));
+  }
 
-  crc_init();
+  // Fixed huffman codes are at most 9 bits per byte, plus the zlib header, adler32, and block ends
+  size_t maxIdatSize = 2 + filteredSize + filteredSize / 8 + 8 + 4;
+  size_t maxSize = sizeof(signature);
+  maxSize += 4 + strlen("IHDR") + sizeof(header) + 4;
+  maxSize += 4 + strlen("IDAT") + maxIdatSize + 4;
+  maxSize += 4 + strlen("IEND") + 4;
+  uint8_t* data = malloc(maxSize);
+  lovrAssert(data, "Out of memory");
+  uint8_t* cursor = data;
   uint32_t crc;
 
   // Signature
-  memcpy(data, signature, sizeof(signature));
-  data += sizeof(signature);
+  memcpy(cursor, signature, sizeof(signature));
+  cursor += sizeof(signature);
 
   // IHDR
-  memcpy(data, (uint8_t[4]) { 0, 0, 0, sizeof(header) }, 4);
-  memcpy(data + 4, "IHDR", 4);
-  memcpy(data + 8, header, sizeof(header));
-  crc = crc32(data + 4, 4 + sizeof(header));
-  memcpy(data + 8 + sizeof(header), (uint8_t[4]) { crc >> 24, crc >> 16, crc >> 8, crc >> 0 }, 4);
-  data += 8 + sizeof(header) + 4;
+  memcpy(cursor, (uint8_t[4]) { 0, 0, 0, sizeof(header) }, 4);
+  memcpy(cursor + 4, "IHDR", 4);
+  memcpy(cursor + 8, header, sizeof(header));
+  crc = crc32(encoder, cursor + 4, 4 + sizeof(header));
+  memcpy(cursor + 8 + sizeof(header), (uint8_t[4]) { crc >> 24, crc >> 16, crc >> 8, crc >> 0 }, 4);
+  cursor += 8 + sizeof(header) + 4;
 
   // IDAT
-  memcpy(data, (uint8_t[4]) { idatSize >> 24 & 0xff, idatSize >> 16 & 0xff, idatSize >> 8 & 0xff, idatSize >> 0 & 0xff }, 4);
-  memcpy(data + 4, "IDAT", 4);
+  memcpy(cursor + 4, "IDAT", 4);
+  encoder->data = cursor + 8;
+  encoder->bits = 0;
+  encoder->bitCount = 0;
 
-  {
-    uint8_t* p = data + 8;
-    size_t length = imageSize;
+  // zlib header (deflate with a 32K window, fastest compression level)
+  *encoder->data++ = (7 << 4) + (8 << 0);
+  *encoder->data++ = 1;
 
-    // adler32 counters
-    uint64_t s1 = 1, s2 = 0;
+  deflate(encoder, filtered, filteredSize);
 
-    // zlib header
-    *p++ = (7 << 4) + (8 << 0);
-    *p++ = 1;
+  uint32_t adler = adler32(filtered, filteredSize);
+  memcpy(encoder->data, (uint8_t[4]) { adler >> 24, adler >> 16, adler >> 8, adler >> 0 }, 4);
+  encoder->data += 4;
 
-    while (length >= rowSize) {
+  size_t idatSize = encoder->data - (cursor + 8);
+  memcpy(cursor, (uint8_t[4]) { idatSize >> 24 & 0xff, idatSize >> 16 & 0xff, idatSize >> 8 & 0xff, idatSize >> 0 & 0xff }, 4);
+  crc = crc32(encoder, cursor + 4, idatSize + 4);
+  memcpy(cursor + 8 + idatSize, (uint8_t[4]) { crc >> 24, crc >> 16, crc >> 8, crc }, 4);
+  cursor += 8 + idatSize + 4;
 
-      // 1 indicates the final block
-      *p++ = (length == rowSize);
+  // IEND
+  memcpy(cursor, (uint8_t[4]) { 0 }, 4);
+  memcpy(cursor + 4, "IEND", 4);
+  crc = crc32(encoder, cursor + 4, 4);
+  memcpy(cursor + 8, (uint8_t[4]) { crc >> 24, crc >> 16, crc >> 8, crc >> 0 }, 4);
+  cursor += 8 + 4;
+
+  free(filtered);
+  free(encoder);
+
+  size_t size = cursor - data;
+  data = realloc(data, size);
+  return lovrBlobCreate(data, size, "Encoded Image");
+}
 
-      // Write length and negated length
-      memcpy(p + 0, &(uint16_t) {  blockSize & 0xffff }, 2);
-      memcpy(p + 2, &(uint16_t) { ~blockSize & 0xffff }, 2);
-      p += 4;
+// Uncompressed 32 bit TGA.  Bigger than PNG but nearly free to write.
+static Blob* encodeTGA(Image* image) {
+  uint32_t w = image->width;
+  uint32_t h = image->height;
+  lovrAssert(w <= 0xffff && h <= 0xffff, "Image is too big to encode as tga");
 
-      // Write the filter method (0) and the row data
-      *p++ = 0x00;
-      memcpy(p, pixels, rowSize);
+  size_t size = 18 + w * h * 4;
+  uint8_t* data = malloc(size);
+  lovrAssert(data, "Out of memory");
 
-      // Update adler32
-      s1 += 0;
-      s2 += s1;
-      for (size_t i = 0; i < rowSize; i++) {
-        s1 = (s1 + pixels[i]);
-        s2 = (s2 + s1);
-      }
-      s1 %= 65521;
-      s2 %= 65521;
+  uint8_t header[18] = {
+    [2] = 2, // Uncompressed true color
+    [12] = w & 0xff, [13] = w >> 8,
+    [14] = h & 0xff, [15] = h >> 8,
+    [16] = 32, // Bits per pixel
+    [17] = 8 // Alpha bits, rows start from the bottom
+  };
 
-      // Update cursors
-      p += rowSize;
-      pixels += stride;
-      length -= rowSize;
-    }
+  memcpy(data, header, sizeof(header));
 
-    // Write adler32 checksum
-    memcpy(p, (uint8_t[4]) { s2 >> 8, s2 >> 0, s1 >> 8, s1 >> 0 }, 4);
+  uint8_t* src = image->blob->data;
+  uint8_t* dst = data + sizeof(header);
+  for (size_t i = 0; i < (size_t) w * h; i++, src += 4, dst += 4) {
+    dst[0] = src[2];
+    dst[1] = src[1];
+    dst[2] = src[0];
+    dst[3] = src[3];
   }
 
-  crc = crc32(data + 4, idatSize + 4);
-  memcpy(data + 8 + idatSize, (uint8_t[4]) { crc >> 24, crc >> 16, crc >> 8, crc }, 4);
-  data += 8 + idatSize + 4;
-
-  // IEND
-  memcpy(data, (uint8_t[4]) { 0 }, 4);
-  memcpy(data + 4, "IEND", 4);
-  crc = crc32(data + 4, 4);
-  memcpy(data + 8, (uint8_t[4]) { crc >> 24, crc >> 16, crc >> 8, crc >> 0 }, 4);
-  data += 8 + 4;
+  return lovrBlobCreate(data, size, "Encoded Image");
+}
 
-  return lovrBlobCreate(data - size, size, "Encoded Image");
+Blob* lovrImageEncode(Image* image, ImageFileFormat format) {
+  lovrAssert(image->format == FORMAT_RGBA, "Only RGBA Image can be encoded");
+  switch (format) {
+    case IMAGE_PNG: return encodePNG(image);
+    case IMAGE_TGA: return encodeTGA(image);
+    default: lovrThrow("Unreachable");
+  }
 }
 
 void lovrImagePaste(Image* image, Image* source, uint32_t dx, uint32_t dy, uint32_t sx, uint32_t sy, uint32_t w, uint32_t h) {
@@ -749,6 +1307,7 @@ void lovrImagePaste(Image* image, Image* source, uint32_t dx, uint32_t dy, uint3
   size_t pixelSize = getPixelSize(image->format);
   lovrAssert(dx + w <= image->width && dy + h <= image->height, "Attempt to paste outside of destination Image bounds");
   lovrAssert(sx + w <= source->width && sy + h <= source->height, "Attempt to paste from outside of source Image bounds");
+  clearMipmaps(image);
   uint8_t* src = (uint8_t*) source->blob->data + ((source->height - 1 - sy) * source->width + sx) * pixelSize;
   uint8_t* dst = (uint8_t*) image->blob->data + ((image->height - 1 - dy) * image->width + sx) * pixelSize;
   for (uint32_t y = 0; y < h; y++) {
@@ -757,3 +1316,243 @@ void lovrImagePaste(Image* image, Image* source, uint32_t dx, uint32_t dy, uint3
     dst -= image->width * pixelSize;
   }
 }
+
+// Block compression
+
+typedef struct {
+  TextureFormat format;
+  uint32_t levelCount;
+  Mipmap levels[MAX_COMPRESSED_MIPMAPS];
+  uint8_t* blocks[MAX_COMPRESSED_MIPMAPS];
+  uint32_t rows[MAX_COMPRESSED_MIPMAPS + 1];
+} CompressJob;
+
+static uint16_t pack565(const int* color) {
+  return ((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3);
+}
+
+static void unpack565(uint16_t value, int* color) {
+  int r = (value >> 11) & 0x1f;
+  int g = (value >> 5) & 0x3f;
+  int b = value & 0x1f;
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+// Endpoints come from the bounding box of the colors, inset a little and flipped along the diagonal
+// that the colors follow.  Each pixel then picks the closest of the 4 palette entries.
+static void encodeColors(const uint8_t* pixels, uint8_t* out) {
+  int min[3] = { 255, 255, 255 };
+  int max[3] = { 0, 0, 0 };
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 3; c++) {
+      min[c] = MIN(min[c], pixels[4 * i + c]);
+      max[c] = MAX(max[c], pixels[4 * i + c]);
+    }
+  }
+
+  int center[3] = { (min[0] + max[0]) / 2, (min[1] + max[1]) / 2, (min[2] + max[2]) / 2 };
+  int rg = 0, bg = 0;
+  for (int i = 0; i < 16; i++) {
+    int dr = pixels[4 * i + 0] - center[0];
+    int dg = pixels[4 * i + 1] - center[1];
+    int db = pixels[4 * i + 2] - center[2];
+    rg += dr * dg;
+    bg += db * dg;
+  }
+
+  if (rg < 0) { int t = min[0]; min[0] = max[0]; max[0] = t; }
+  if (bg < 0) { int t = min[2]; min[2] = max[2]; max[2] = t; }
+
+  for (int c = 0; c < 3; c++) {
+    int inset = (max[c] - min[c]) / 16;
+    min[c] += inset;
+    max[c] -= inset;
+  }
+
+  uint16_t color0 = pack565(max);
+  uint16_t color1 = pack565(min);
+
+  // The 4 color palette is only used when the first endpoint is bigger
+  if (color0 < color1) {
+    uint16_t t = color0;
+    color0 = color1;
+    color1 = t;
+  }
+
+  uint32_t indices = 0;
+  if (color0 != color1) {
+    int palette[4][3];
+    unpack565(color0, palette[0]);
+    unpack565(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    for (int i = 0; i < 16; i++) {
+      uint32_t best = 0;
+      int bestDistance = INT_MAX;
+      for (uint32_t j = 0; j < 4; j++) {
+        int dr = pixels[4 * i + 0] - palette[j][0];
+        int dg = pixels[4 * i + 1] - palette[j][1];
+        int db = pixels[4 * i + 2] - palette[j][2];
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          best = j;
+        }
+      }
+      indices |= best << (2 * i);
+    }
+  }
+
+  out[0] = color0 & 0xff;
+  out[1] = color0 >> 8;
+  out[2] = color1 & 0xff;
+  out[3] = color1 >> 8;
+  out[4] = indices & 0xff;
+  out[5] = (indices >> 8) & 0xff;
+  out[6] = (indices >> 16) & 0xff;
+  out[7] = indices >> 24;
+}
+
+// Uses the 8 value alpha palette spanning the min and max alpha of the block
+static void encodeAlpha(const uint8_t* pixels, uint8_t* out) {
+  int min = 255;
+  int max = 0;
+  for (int i = 0; i < 16; i++) {
+    min = MIN(min, pixels[4 * i + 3]);
+    max = MAX(max, pixels[4 * i + 3]);
+  }
+
+  uint64_t indices = 0;
+  if (max > min) {
+    static const uint8_t order[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+    int range = max - min;
+    for (int i = 0; i < 16; i++) {
+      int step = ((max - pixels[4 * i + 3]) * 7 + range / 2) / range;
+      indices |= (uint64_t) order[step] << (3 * i);
+    }
+  }
+
+  out[0] = max;
+  out[1] = min;
+  for (int i = 0; i < 6; i++) {
+    out[2 + i] = (indices >> (8 * i)) & 0xff;
+  }
+}
+
+static void compressRow(void* context, uint32_t index) {
+  CompressJob* job = context;
+  uint32_t level = 0;
+  while (index >= job->rows[level + 1]) level++;
+
+  Mipmap* mipmap = &job->levels[level];
+  uint32_t width = mipmap->width;
+  uint32_t height = mipmap->height;
+  uint32_t blocksWide = (width + 3) / 4;
+  uint32_t y = 4 * (index - job->rows[level]);
+  size_t blockSize = job->format == FORMAT_DXT1 ? 8 : 16;
+  uint8_t* pixels = mipmap->data;
+  uint8_t* out = job->blocks[level] + (y / 4) * blocksWide * blockSize;
+
+  for (uint32_t x = 0; x < width; x += 4) {
+    uint8_t block[64];
+
+    // Blocks along the right and bottom edges repeat the last pixel
+    for (uint32_t by = 0; by < 4; by++) {
+      for (uint32_t bx = 0; bx < 4; bx++) {
+        uint32_t px = MIN(x + bx, width - 1);
+        uint32_t py = MIN(y + by, height - 1);
+        memcpy(block + 4 * (4 * by + bx), pixels + 4 * (py * width + px), 4);
+      }
+    }
+
+    if (job->format == FORMAT_DXT5) {
+      encodeAlpha(block, out);
+      out += 8;
+    }
+
+    encodeColors(block, out);
+    out += 8;
+  }
+}
+
+// Compresses an rgba Image and generates its mipmaps.  The result is a DDS file, which is also used
+// as the source of the returned Image so it can be saved and loaded again later.
+Image* lovrImageCompress(Image* image, TextureFormat format) {
+  lovrAssert(image->format == FORMAT_RGBA && image->blob->data, "Only rgba Images can be compressed");
+  lovrAssert(format == FORMAT_DXT1 || format == FORMAT_DXT5, "Images can only be compressed to dxt1 or dxt5");
+
+  CompressJob job = { .format = format, .levelCount = 1 };
+  while (((uint64_t) MAX(image->width, image->height) >> job.levelCount) > 0) job.levelCount++;
+  lovrAssert(job.levelCount <= MAX_COMPRESSED_MIPMAPS, "Image is too big to compress");
+
+  size_t blockSize = format == FORMAT_DXT1 ? 8 : 16;
+  size_t scratchSize = 0;
+  size_t size = 128;
+
+  uint32_t width = image->width;
+  uint32_t height = image->height;
+  for (uint32_t i = 0; i < job.levelCount; i++) {
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    job.levels[i] = (Mipmap) { .width = width, .height = height, .size = 4 * width * height };
+    job.rows[i + 1] = job.rows[i] + blocksHigh;
+    scratchSize += i > 0 ? job.levels[i].size : 0;
+    size += blocksWide * blocksHigh * blockSize;
+    width = MAX(width >> 1, 1);
+    height = MAX(height >> 1, 1);
+  }
+
+  uint8_t* scratch = malloc(scratchSize);
+  uint8_t* data = malloc(size);
+  lovrAssert((scratch || scratchSize == 0) && data, "Out of memory");
+
+  // Mipmaps that were already generated are reused
+  job.levels[0].data = image->blob->data;
+  for (uint32_t i = 1; i < job.levelCount; i++) {
+    if (i < image->mipmapCount) {
+      job.levels[i].data = image->mipmaps[i].data;
+    } else {
+      job.levels[i].data = i == 1 ? scratch : (uint8_t*) job.levels[i - 1].data + job.levels[i - 1].size;
+      downsample(job.levels[i - 1].data, job.levels[i - 1].width, job.levels[i - 1].height, 4, job.levels[i].data);
+    }
+  }
+
+  uint32_t header[32] = {
+    [0] = FOUR_CC('D', 'D', 'S', ' '),
+    [1] = 124, // Header size
+    [2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000, // Caps, height, width, format, mipmaps, size
+    [3] = image->height,
+    [4] = image->width,
+    [5] = (uint32_t) (((image->width + 3) / 4) * ((image->height + 3) / 4) * blockSize),
+    [7] = job.levelCount,
+    [19] = 32, // Pixel format size
+    [20] = 0x4, // FourCC
+    [21] = format == FORMAT_DXT1 ? FOUR_CC('D', 'X', 'T', '1') : FOUR_CC('D', 'X', 'T', '5'),
+    [27] = 0x1000 | 0x8 | 0x400000 // Texture, complex, mipmaps
+  };
+
+  memcpy(data, header, sizeof(header));
+  job.blocks[0] = data + sizeof(header);
+  for (uint32_t i = 1; i < job.levelCount; i++) {
+    job.blocks[i] = job.blocks[i - 1] + (job.rows[i] - job.rows[i - 1]) * ((job.levels[i - 1].width + 3) / 4) * blockSize;
+  }
+
+#ifndef LOVR_DISABLE_THREAD
+  lovrJobRun(compressRow, &job, job.rows[job.levelCount]);
+#else
+  for (uint32_t i = 0; i < job.rows[job.levelCount]; i++) {
+    compressRow(&job, i);
+  }
+#endif
+
+  free(scratch);
+  Blob* blob = lovrBlobCreate(data, size, "Compressed Image");
+  Image* compressed = lovrImageCreateFromBlob(blob, false);
+  lovrRelease(blob, lovrBlobDestroy);
+  return compressed;
+}
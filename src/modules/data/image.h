@@ -44,6 +44,11 @@ typedef enum {
   FORMAT_ASTC_12x12
 } TextureFormat;
 
+typedef enum {
+  IMAGE_PNG,
+  IMAGE_TGA
+} ImageFileFormat;
+
 typedef struct {
   uint32_t width;
   uint32_t height;
@@ -60,12 +65,23 @@ typedef struct Image {
   TextureFormat format;
   Mipmap* mipmaps;
   uint32_t mipmapCount;
+  void* mipmapData;
 } Image;
 
 Image* lovrImageCreate(uint32_t width, uint32_t height, struct Blob* contents, uint8_t value, TextureFormat format);
 Image* lovrImageCreateFromBlob(struct Blob* blob, bool flip);
+uint32_t lovrImageCreateMany(struct Blob** blobs, uint32_t count, bool flip, Image** images);
 void lovrImageDestroy(void* ref);
 Color lovrImageGetPixel(Image* image, uint32_t x, uint32_t y);
 void lovrImageSetPixel(Image* image, uint32_t x, uint32_t y, Color color);
-struct Blob* lovrImageEncode(Image* image);
+struct Blob* lovrImageEncode(Image* image, ImageFileFormat format);
 void lovrImagePaste(Image* image, Image* source, uint32_t dx, uint32_t dy, uint32_t sx, uint32_t sy, uint32_t w, uint32_t h);
+void lovrImageGenerateMipmaps(Image* image);
+Image* lovrImageResize(Image* image, uint32_t width, uint32_t height);
+Image* lovrImageCompress(Image* image, TextureFormat format);
+
+typedef struct ImageBatch ImageBatch;
+ImageBatch* lovrImageBatchCreate(struct Blob** blobs, uint32_t count, bool flip);
+void lovrImageBatchDestroy(void* ref);
+bool lovrImageBatchIsReady(ImageBatch* batch);
+Image** lovrImageBatchGetImages(ImageBatch* batch, uint32_t* count);
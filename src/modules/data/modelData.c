@@ -1,18 +1,18 @@
 #include "data/modelData.h"
 #include "data/blob.h"
 #include "data/image.h"
+#include "core/maf.h"
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 ModelData* lovrModelDataCreate(Blob* source, ModelDataIO* io) {
   ModelData* model = calloc(1, sizeof(ModelData));
   lovrAssert(model, "Out of memory");
   model->ref = 1;
 
-  if (lovrModelDataInitGltf(model, source, io)) {
-    return model;
-  } else if (lovrModelDataInitObj(model, source, io)) {
-    return model;
-  } else if (lovrModelDataInitStl(model, source, io)) {
+  if (lovrModelDataInitGltf(model, source, io) || lovrModelDataInitObj(model, source, io) || lovrModelDataInitStl(model, source, io)) {
+    lovrModelDataFlatten(model);
     return model;
   }
 
@@ -31,6 +31,7 @@ void lovrModelDataDestroy(void* ref) {
   map_free(&model->animationMap);
   map_free(&model->materialMap);
   map_free(&model->nodeMap);
+  free(model->animationData);
   free(model->data);
   free(model);
 }
@@ -38,7 +39,7 @@ void lovrModelDataDestroy(void* ref) {
 // Note: this code is a scary optimization
 void lovrModelDataAllocate(ModelData* model) {
   size_t totalSize = 0;
-  size_t sizes[13];
+  size_t sizes[17];
   size_t alignment = 8;
   totalSize += sizes[0] = ALIGN(model->blobCount * sizeof(Blob*), alignment);
   totalSize += sizes[1] = ALIGN(model->bufferCount * sizeof(ModelBuffer), alignment);
@@ -52,7 +53,11 @@ void lovrModelDataAllocate(ModelData* model) {
   totalSize += sizes[9] = ALIGN(model->channelCount * sizeof(ModelAnimationChannel), alignment);
   totalSize += sizes[10] = ALIGN(model->childCount * sizeof(uint32_t), alignment);
   totalSize += sizes[11] = ALIGN(model->jointCount * sizeof(uint32_t), alignment);
-  totalSize += sizes[12] = model->charCount * sizeof(char);
+  totalSize += sizes[12] = ALIGN(model->lodCount * sizeof(ModelLodGroup), alignment);
+  totalSize += sizes[13] = ALIGN(model->lodLevelCount * sizeof(uint32_t), alignment);
+  totalSize += sizes[14] = ALIGN(model->lodLevelCount * sizeof(float), alignment);
+  totalSize += sizes[15] = ALIGN(4 * model->nodeCount * sizeof(uint32_t), alignment);
+  totalSize += sizes[16] = model->charCount * sizeof(char);
 
   size_t offset = 0;
   char* p = model->data = calloc(1, totalSize);
@@ -69,9 +74,405 @@ void lovrModelDataAllocate(ModelData* model) {
   model->channels = (ModelAnimationChannel*) (p + offset), offset += sizes[9];
   model->children = (uint32_t*) (p + offset), offset += sizes[10];
   model->joints = (uint32_t*) (p + offset), offset += sizes[11];
-  model->chars = (char*) (p + offset), offset += sizes[12];
+  model->lods = (ModelLodGroup*) (p + offset), offset += sizes[12];
+  model->lodNodes = (uint32_t*) (p + offset), offset += sizes[13];
+  model->lodCoverage = (float*) (p + offset), offset += sizes[14];
+  model->nodeOrder = (uint32_t*) (p + offset), offset += sizes[15];
+  model->chars = (char*) (p + offset), offset += sizes[16];
+  model->nodeParents = model->nodeOrder + model->nodeCount;
+  model->nodeSkips = model->nodeParents + model->nodeCount;
+  model->nodePositions = model->nodeSkips + model->nodeCount;
 
   map_init(&model->animationMap, model->animationCount);
   map_init(&model->materialMap, model->materialCount);
   map_init(&model->nodeMap, model->nodeCount);
 }
+
+// Appends a subtree to the node order.  The stack holds pairs of node and parent indices.
+static void flattenSubtree(ModelData* model, uint32_t root, uint32_t parent, uint32_t* stack) {
+  uint32_t start = model->orderedNodeCount;
+  uint32_t top = 0;
+
+  stack[top++] = root;
+  stack[top++] = parent;
+  while (top > 0 && model->orderedNodeCount < model->nodeCount) {
+    parent = stack[--top];
+    uint32_t index = stack[--top];
+    uint32_t position = model->orderedNodeCount++;
+    ModelNode* node = &model->nodes[index];
+    model->nodeOrder[position] = index;
+    model->nodeParents[position] = parent;
+    model->nodeSkips[position] = position + 1;
+    model->nodePositions[index] = position;
+
+    for (uint32_t i = node->childCount; i-- > 0 && top < 2 * model->nodeCount;) {
+      stack[top++] = node->children[i];
+      stack[top++] = index;
+    }
+  }
+
+  // A subtree ends where the last of its children's subtrees ends
+  for (uint32_t i = model->orderedNodeCount - 1; i > start; i--) {
+    uint32_t parentPosition = model->nodePositions[model->nodeParents[i]];
+    model->nodeSkips[parentPosition] = MAX(model->nodeSkips[parentPosition], model->nodeSkips[i]);
+  }
+}
+
+void lovrModelDataFlatten(ModelData* model) {
+  model->orderedNodeCount = 0;
+  model->sceneNodeCount = 0;
+
+  if (model->nodeCount == 0) {
+    return;
+  }
+
+  uint32_t* stack = malloc(2 * model->nodeCount * sizeof(uint32_t));
+  lovrAssert(stack, "Out of memory");
+  memset(model->nodePositions, 0xff, model->nodeCount * sizeof(uint32_t));
+
+  flattenSubtree(model, model->rootNode, ~0u, stack);
+  model->sceneNodeCount = model->orderedNodeCount;
+
+  // This loop also reaches LOD groups nested inside of other LOD levels
+  for (uint32_t i = 0; i < model->orderedNodeCount; i++) {
+    ModelNode* node = &model->nodes[model->nodeOrder[i]];
+    if (node->lod == ~0u) continue;
+
+    ModelLodGroup* group = &model->lods[node->lod];
+    for (uint32_t j = 1; j < group->levelCount; j++) {
+      if (model->nodePositions[group->nodes[j]] == ~0u) {
+        flattenSubtree(model, group->nodes[j], model->nodeParents[i], stack);
+      }
+    }
+  }
+
+  free(stack);
+}
+
+// Finds the first keyframe at or after a time.  Playback usually moves forward a little each
+// frame, so the keyframe from the last lookup is checked before falling back to a binary search.
+static uint32_t findKeyframe(ModelAnimationChannel* channel, uint32_t* cursor, float time) {
+  float* times = channel->times;
+  uint32_t count = channel->keyframeCount;
+
+  for (uint32_t k = *cursor; k <= count && k <= *cursor + 1; k++) {
+    if ((k == 0 || times[k - 1] < time) && (k == count || times[k] >= time)) {
+      return *cursor = k;
+    }
+  }
+
+  uint32_t lo = 0;
+  uint32_t hi = count;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (times[mid] < time) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return *cursor = lo;
+}
+
+#define SQRT2 1.41421356f
+
+// Smallest three encoding: the largest component is dropped and rebuilt from the others, which are
+// stored in 15 bits each.  The index of the dropped component goes in the top bits of the first two.
+static void encodeRotation(const float q[4], uint16_t out[3]) {
+  int largest = 0;
+  for (int i = 1; i < 4; i++) {
+    if (fabsf(q[i]) > fabsf(q[largest])) {
+      largest = i;
+    }
+  }
+
+  float sign = q[largest] < 0.f ? -1.f : 1.f;
+  for (int i = 0, j = 0; i < 4; i++) {
+    if (i == largest) continue;
+    float x = CLAMP(q[i] * sign * SQRT2 * .5f + .5f, 0.f, 1.f);
+    out[j++] = (uint16_t) (x * 32767.f + .5f);
+  }
+
+  out[0] |= (largest & 1) << 15;
+  out[1] |= (largest >> 1) << 15;
+}
+
+static void decodeRotation(const uint16_t in[3], float q[4]) {
+  int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+  float sum = 0.f;
+  for (int i = 0, j = 0; i < 4; i++) {
+    if (i == largest) continue;
+    float x = (in[j++] & 0x7fff) / 32767.f;
+    q[i] = (x - .5f) * 2.f / SQRT2;
+    sum += q[i] * q[i];
+  }
+  q[largest] = sqrtf(MAX(1.f - sum, 0.f));
+}
+
+static void readKeyframe(ModelAnimationChannel* channel, uint32_t index, float property[4]) {
+  if (channel->rotations) {
+    decodeRotation(channel->rotations + 3 * index, property);
+  } else {
+    size_t n = channel->property == PROP_ROTATION ? 4 : 3;
+    memcpy(property, channel->data + index * n, n * sizeof(float));
+  }
+}
+
+// Samples a channel at a time.  Compressed channels have evenly spaced keyframes, so the keyframe
+// is found directly.  The cursor is optional and speeds up the search for regular channels.
+void lovrModelDataSampleChannel(ModelAnimationChannel* channel, float time, uint32_t* cursor, float property[4]) {
+  bool rotate = channel->property == PROP_ROTATION;
+  size_t n = 3 + rotate;
+  float* (*lerp)(float* a, float* b, float t) = rotate ? quat_slerp : vec3_lerp;
+
+  if (channel->sampleRate > 0.f) {
+    float position = MAX(time, 0.f) * channel->sampleRate;
+    uint32_t keyframe = MIN((uint32_t) position, channel->keyframeCount - 1);
+    float next[4];
+    readKeyframe(channel, keyframe, property);
+    readKeyframe(channel, MIN(keyframe + 1, channel->keyframeCount - 1), next);
+    lerp(property, next, MIN(position - keyframe, 1.f));
+    return;
+  }
+
+  uint32_t start = 0;
+  uint32_t keyframe = findKeyframe(channel, cursor ? cursor : &start, time);
+
+  if (keyframe == 0 || keyframe >= channel->keyframeCount) {
+    size_t index = MIN(keyframe, channel->keyframeCount - 1);
+
+    // For cubic interpolation, each keyframe has 3 parts, and the actual data is in the middle (*3, +1)
+    if (channel->smoothing == SMOOTH_CUBIC) {
+      index = 3 * index + 1;
+    }
+
+    memcpy(property, channel->data + index * n, n * sizeof(float));
+  } else {
+    float t1 = channel->times[keyframe - 1];
+    float t2 = channel->times[keyframe];
+    float z = (time - t1) / (t2 - t1);
+
+    switch (channel->smoothing) {
+      case SMOOTH_STEP:
+        memcpy(property, channel->data + (z >= .5f ? keyframe : keyframe - 1) * n, n * sizeof(float));
+        break;
+      case SMOOTH_LINEAR:
+        memcpy(property, channel->data + (keyframe - 1) * n, n * sizeof(float));
+        lerp(property, channel->data + keyframe * n, z);
+        break;
+      case SMOOTH_CUBIC: {
+        size_t stride = 3 * n;
+        float* p0 = channel->data + (keyframe - 1) * stride + 1 * n;
+        float* m0 = channel->data + (keyframe - 1) * stride + 2 * n;
+        float* p1 = channel->data + (keyframe - 0) * stride + 1 * n;
+        float* m1 = channel->data + (keyframe - 0) * stride + 0 * n;
+        float dt = t2 - t1;
+        float z2 = z * z;
+        float z3 = z2 * z;
+        float a = 2.f * z3 - 3.f * z2 + 1.f;
+        float b = 2.f * z3 - 3.f * z2 + 1.f;
+        float c = (-2.f * z3 + 3.f * z2);
+        float d = (z3 * -z2) * dt;
+        for (size_t j = 0; j < n; j++) {
+          property[j] = a * p0[j] + b * m0[j] + c * p1[j] + d * m1[j];
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
+
+// Largest difference between two properties.  Rotations are compared in the same hemisphere.
+static float propertyError(const float* a, const float* b, bool rotate) {
+  float error = 0.f;
+  float flipped = 0.f;
+  for (int i = 0; i < (rotate ? 4 : 3); i++) {
+    error = MAX(error, fabsf(a[i] - b[i]));
+    flipped = MAX(flipped, fabsf(a[i] + b[i]));
+  }
+  return rotate ? MIN(error, flipped) : error;
+}
+
+// Finds how many base samples can be skipped between keyframes while staying within the tolerance
+static uint32_t getKeyframeStride(ModelAnimationChannel* channel, float* samples, uint32_t sampleCount, float sampleRate, float tolerance) {
+  bool rotate = channel->property == PROP_ROTATION;
+  float* (*lerp)(float* a, float* b, float t) = rotate ? quat_slerp : vec3_lerp;
+
+  bool constant = true;
+  for (uint32_t i = 1; i < sampleCount && constant; i++) {
+    constant = propertyError(samples, samples + 4 * i, rotate) <= tolerance;
+  }
+
+  if (constant) {
+    return sampleCount;
+  }
+
+  uint32_t stride = 1;
+  while (stride * 2 < sampleCount) stride *= 2;
+
+  for (; stride > 1; stride /= 2) {
+    bool fits = true;
+    for (uint32_t i = 0; i < sampleCount && fits; i++) {
+      uint32_t key = i / stride;
+      float z = (float) (i - key * stride) / stride;
+      float a[4], b[4];
+      lovrModelDataSampleChannel(channel, key * stride / sampleRate, NULL, a);
+      lovrModelDataSampleChannel(channel, (key + 1) * stride / sampleRate, NULL, b);
+      lerp(a, b, z);
+      fits = propertyError(a, samples + 4 * i, rotate) <= tolerance;
+    }
+
+    if (fits) {
+      break;
+    }
+  }
+
+  return stride;
+}
+
+static bool isInBlob(Blob* blob, const void* pointer) {
+  const char* p = pointer;
+  const char* data = blob->data;
+  return p && p >= data && p < data + blob->size;
+}
+
+// Releases Blobs that nothing points into anymore, once the keyframes have been copied out of them.
+// Blobs that also hold geometry, skins, step channels, or compressed images stay loaded.
+static void releaseUnusedBlobs(ModelData* model) {
+  for (uint32_t i = 0; i < model->blobCount; i++) {
+    Blob* blob = model->blobs[i];
+    if (!blob || !blob->data) continue;
+
+    bool used = false;
+    for (uint32_t j = 0; j < model->primitiveCount && !used; j++) {
+      ModelPrimitive* primitive = &model->primitives[j];
+      for (uint32_t k = 0; k < MAX_DEFAULT_ATTRIBUTES && !used; k++) {
+        ModelAttribute* attribute = primitive->attributes[k];
+        used = attribute && isInBlob(blob, model->buffers[attribute->buffer].data);
+      }
+      used = used || (primitive->indices && isInBlob(blob, model->buffers[primitive->indices->buffer].data));
+    }
+
+    for (uint32_t j = 0; j < model->skinCount && !used; j++) {
+      used = isInBlob(blob, model->skins[j].inverseBindMatrices);
+    }
+
+    for (uint32_t j = 0; j < model->channelCount && !used; j++) {
+      used = isInBlob(blob, model->channels[j].times) || isInBlob(blob, model->channels[j].data);
+    }
+
+    for (uint32_t j = 0; j < model->imageCount && !used; j++) {
+      Image* image = model->images[j];
+      used = image && image->mipmapCount > 0 && isInBlob(blob, image->mipmaps[0].data);
+    }
+
+    if (used) continue;
+
+    for (uint32_t j = 0; j < model->bufferCount; j++) {
+      if (isInBlob(blob, model->buffers[j].data)) {
+        model->buffers[j].data = NULL;
+        model->buffers[j].size = 0;
+      }
+    }
+
+    lovrRelease(blob, lovrBlobDestroy);
+    model->blobs[i] = NULL;
+  }
+}
+
+// Resamples animation channels at a fixed rate, so sampling them doesn't need to search for a
+// keyframe.  Keyframes are then dropped by lowering the rate of each channel as far as possible
+// without going over the tolerance, and rotations are quantized to 48 bits.  Step channels are
+// left alone since resampling would smooth them out.
+void lovrModelDataCompressAnimations(ModelData* model, float sampleRate, float tolerance) {
+  lovrAssert(sampleRate > 0.f, "Animation sample rate must be positive");
+  uint32_t* strides = calloc(model->channelCount, sizeof(uint32_t));
+  uint32_t* counts = calloc(model->channelCount, sizeof(uint32_t));
+  lovrAssert(strides && counts, "Out of memory");
+  float* samples = NULL;
+  size_t floatCount = 0;
+  size_t rotationCount = 0;
+
+  for (uint32_t a = 0; a < model->animationCount; a++) {
+    ModelAnimation* animation = &model->animations[a];
+    uint32_t sampleCount = (uint32_t) ceilf(animation->duration * sampleRate) + 1;
+    samples = realloc(samples, 4 * sampleCount * sizeof(float));
+    lovrAssert(samples, "Out of memory");
+
+    for (uint32_t c = 0; c < animation->channelCount; c++) {
+      ModelAnimationChannel* channel = &animation->channels[c];
+      uint32_t index = (uint32_t) (channel - model->channels);
+      if (channel->keyframeCount == 0 || channel->smoothing == SMOOTH_STEP) continue;
+
+      for (uint32_t i = 0; i < sampleCount; i++) {
+        lovrModelDataSampleChannel(channel, i / sampleRate, NULL, samples + 4 * i);
+      }
+
+      // A stride covering the whole animation means the channel is constant, so one keyframe is enough
+      strides[index] = getKeyframeStride(channel, samples, sampleCount, sampleRate, tolerance);
+      counts[index] = strides[index] >= sampleCount ? 1 : (sampleCount - 1 + strides[index] - 1) / strides[index] + 1;
+
+      if (channel->property == PROP_ROTATION) {
+        rotationCount += 3 * counts[index];
+      } else {
+        floatCount += 3 * counts[index];
+      }
+    }
+  }
+
+  // Everything goes in one allocation, the old one can be freed once all channels are resampled
+  void* data = malloc(floatCount * sizeof(float) + rotationCount * sizeof(uint16_t));
+  lovrAssert(data || floatCount + rotationCount == 0, "Out of memory");
+  float* floats = data;
+  uint16_t* rotations = (uint16_t*) (floats + floatCount);
+
+  for (uint32_t i = 0; i < model->channelCount; i++) {
+    ModelAnimationChannel* channel = &model->channels[i];
+    if (counts[i] == 0) continue;
+
+    bool rotate = channel->property == PROP_ROTATION;
+    float rate = sampleRate / strides[i];
+    float* values = floats;
+
+    if (rotate) {
+      samples = realloc(samples, 4 * counts[i] * sizeof(float));
+      lovrAssert(samples, "Out of memory");
+      values = samples;
+    }
+
+    for (uint32_t k = 0; k < counts[i]; k++) {
+      float property[4];
+      lovrModelDataSampleChannel(channel, k / rate, NULL, property);
+      memcpy(values + (rotate ? 4 : 3) * k, property, (rotate ? 4 : 3) * sizeof(float));
+    }
+
+    if (rotate) {
+      for (uint32_t k = 0; k < counts[i]; k++) {
+        encodeRotation(samples + 4 * k, rotations + 3 * k);
+      }
+      channel->rotations = rotations;
+      channel->data = NULL;
+      rotations += 3 * counts[i];
+    } else {
+      channel->rotations = NULL;
+      channel->data = floats;
+      floats += 3 * counts[i];
+    }
+
+    channel->times = NULL;
+    channel->smoothing = SMOOTH_LINEAR;
+    channel->keyframeCount = counts[i];
+    channel->sampleRate = rate;
+  }
+
+  free(model->animationData);
+  model->animationData = data;
+  free(samples);
+  free(strides);
+  free(counts);
+
+  releaseUnusedBlobs(model);
+}
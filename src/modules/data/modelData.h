@@ -6,7 +6,8 @@
 
 #pragma once
 
-#define MAX_BONES 48
+#define MAX_BONES 256
+#define MAX_LOD_LEVELS 8
 
 struct Blob;
 struct Image;
@@ -129,6 +130,8 @@ typedef struct {
   uint32_t keyframeCount;
   float* times;
   float* data;
+  uint16_t* rotations;
+  float sampleRate;
 } ModelAnimationChannel;
 
 typedef struct {
@@ -169,6 +172,7 @@ typedef struct {
   uint32_t primitiveIndex;
   uint32_t primitiveCount;
   uint32_t skin;
+  uint32_t lod;
   bool matrix;
 } ModelNode;
 
@@ -178,9 +182,18 @@ typedef struct {
   float* inverseBindMatrices;
 } ModelSkin;
 
+// Node indices from most to least detailed, nodes[0] is the node that owns the group.  Each level
+// is used while the node covers at least coverage[level] of the screen height.
+typedef struct {
+  uint32_t* nodes;
+  float* coverage;
+  uint32_t levelCount;
+} ModelLodGroup;
+
 typedef struct ModelData {
   uint32_t ref;
   void* data;
+  void* animationData;
   struct Blob** blobs;
   ModelBuffer* buffers;
   struct Image** images;
@@ -190,8 +203,19 @@ typedef struct ModelData {
   ModelAnimation* animations;
   ModelSkin* skins;
   ModelNode* nodes;
+  ModelLodGroup* lods;
   uint32_t rootNode;
 
+  // Nodes in depth-first order, so parents come before their children and each subtree is a
+  // contiguous range ending at nodeSkips[i].  Nodes reachable from the root come first, followed by
+  // the coarser LOD levels, which share the parent of the node they replace.
+  uint32_t* nodeOrder;
+  uint32_t* nodeParents;
+  uint32_t* nodeSkips;
+  uint32_t* nodePositions;
+  uint32_t orderedNodeCount;
+  uint32_t sceneNodeCount;
+
   uint32_t blobCount;
   uint32_t bufferCount;
   uint32_t imageCount;
@@ -201,14 +225,18 @@ typedef struct ModelData {
   uint32_t animationCount;
   uint32_t skinCount;
   uint32_t nodeCount;
+  uint32_t lodCount;
 
   ModelAnimationChannel* channels;
   uint32_t* children;
   uint32_t* joints;
+  uint32_t* lodNodes;
+  float* lodCoverage;
   char* chars;
   uint32_t channelCount;
   uint32_t childCount;
   uint32_t jointCount;
+  uint32_t lodLevelCount;
   uint32_t charCount;
 
   map_t animationMap;
@@ -224,3 +252,6 @@ ModelData* lovrModelDataInitObj(ModelData* model, struct Blob* blob, ModelDataIO
 ModelData* lovrModelDataInitStl(ModelData* model, struct Blob* blob, ModelDataIO* io);
 void lovrModelDataDestroy(void* ref);
 void lovrModelDataAllocate(ModelData* model);
+void lovrModelDataFlatten(ModelData* model);
+void lovrModelDataCompressAnimations(ModelData* model, float sampleRate, float tolerance);
+void lovrModelDataSampleChannel(ModelAnimationChannel* channel, float time, uint32_t* cursor, float property[4]);
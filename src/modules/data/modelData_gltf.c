@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdio.h>
 
 #define MAX_STACK_TOKENS 1024
 
@@ -79,6 +80,17 @@ static int nomValue(const char* data, jsmntok_t* token, int count, int sum) {
   }
 }
 
+// Returns the level of a node named with the NAME_LOD<n> convention, or -1
+static int parseLodSuffix(const char* name, size_t length, size_t* prefix) {
+  size_t digits = 0;
+  while (digits < length && isdigit(name[length - digits - 1])) digits++;
+  if (digits == 0 || digits > 2 || length < digits + 4 || memcmp(name + length - digits - 4, "_LOD", 4)) {
+    return -1;
+  }
+  *prefix = length - digits - 4;
+  return (int) nomInt(name + length - digits);
+}
+
 static void* decodeBase64(char* str, size_t length, size_t decodedSize) {
   str = memchr(str, ',', length);
   if (!str) {
@@ -145,6 +157,18 @@ static jsmntok_t* resolveTexture(const char* json, jsmntok_t* token, ModelMateri
   return token;
 }
 
+// Blobs for images in buffer views don't own their data
+static void releaseImageBlobs(Blob** blobs, bool* views, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (blobs[i] && views[i]) {
+      blobs[i]->data = NULL; // XXX Blob data ownership
+    }
+    lovrRelease(blobs[i], lovrBlobDestroy);
+  }
+  free(blobs);
+  free(views);
+}
+
 ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io) {
   uint8_t* data = source->data;
   gltfHeader* header = (gltfHeader*) data;
@@ -408,7 +432,30 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
           for (int k = (token++)->size; k > 0; k--) {
             gltfString key = NOM_STR(json, token);
             if (STR_EQ(key, "children")) { model->childCount += token->size; }
-            else if (STR_EQ(key, "name")) { model->charCount += token->end - token->start + 1; }
+            else if (STR_EQ(key, "name")) {
+              size_t prefix;
+              int level = parseLodSuffix(json + token->start, token->end - token->start, &prefix);
+              model->lodCount += level == 0;
+              model->lodLevelCount += level >= 0;
+              model->charCount += token->end - token->start + 1;
+            } else if (STR_EQ(key, "extensions")) {
+              jsmntok_t* t = token;
+              for (int e = (t++)->size; e > 0; e--) {
+                gltfString extension = NOM_STR(json, t);
+                if (STR_EQ(extension, "MSFT_lod")) {
+                  for (int l = (t++)->size; l > 0; l--) {
+                    gltfString key = NOM_STR(json, t);
+                    if (STR_EQ(key, "ids")) {
+                      model->lodCount++;
+                      model->lodLevelCount += t->size + 1;
+                    }
+                    t += NOM_VALUE(json, t);
+                  }
+                } else {
+                  t += NOM_VALUE(json, t);
+                }
+              }
+            }
             token += NOM_VALUE(json, token);
           }
         }
@@ -649,36 +696,53 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
     }
   }
 
-  // Images
+  // Images (files are read first, then everything is decoded in parallel)
   if (model->imageCount > 0) {
     jsmntok_t* token = info.images;
-    Image** image = model->images;
-    for (int i = (token++)->size; i > 0; i--, image++) {
+    Blob** blobs = calloc(model->imageCount, sizeof(Blob*));
+    bool* views = calloc(model->imageCount, sizeof(bool));
+    if (!blobs || !views) {
+      free(blobs);
+      free(views);
+      lovrThrow("Out of memory");
+    }
+
+    // Everything read so far is released before throwing
+    for (uint32_t i = 0, count = (token++)->size; i < count; i++) {
       for (int k = (token++)->size; k > 0; k--) {
         gltfString key = NOM_STR(json, token);
         if (STR_EQ(key, "bufferView")) {
           ModelBuffer* buffer = &model->buffers[NOM_INT(json, token)];
-          Blob* blob = lovrBlobCreate(buffer->data, buffer->size, NULL);
-          *image = lovrImageCreateFromBlob(blob, false);
-          blob->data = NULL; // XXX Blob data ownership
-          lovrRelease(blob, lovrBlobDestroy);
+          blobs[i] = lovrBlobCreate(buffer->data, buffer->size, NULL);
+          views[i] = true;
         } else if (STR_EQ(key, "uri")) {
           size_t size = 0;
           gltfString uri = NOM_STR(json, token);
-          lovrAssert(uri.length < 5 || strncmp("data:", uri.data, 5), "Base64 images aren't supported yet");
-          lovrAssert(uri.length < maxPathLength, "Image filename is too long");
+          if (uri.length >= 5 && !strncmp("data:", uri.data, 5)) {
+            releaseImageBlobs(blobs, views, model->imageCount);
+            lovrThrow("Base64 images aren't supported yet");
+          } else if (uri.length >= maxPathLength) {
+            releaseImageBlobs(blobs, views, model->imageCount);
+            lovrThrow("Image filename is too long");
+          }
           strncat(filename, uri.data, uri.length);
           void* data = io(filename, &size);
-          lovrAssert(data && size > 0, "Unable to read image from '%s'", filename);
-          Blob* blob = lovrBlobCreate(data, size, NULL);
-          *image = lovrImageCreateFromBlob(blob, false);
-          lovrRelease(blob, lovrBlobDestroy);
+          if (!data || size == 0) {
+            free(data);
+            releaseImageBlobs(blobs, views, model->imageCount);
+            lovrThrow("Unable to read image from '%s'", filename);
+          }
+          blobs[i] = lovrBlobCreate(data, size, NULL);
           *root = '\0';
         } else {
           token += NOM_VALUE(json, token);
         }
       }
     }
+
+    uint32_t failed = lovrImageCreateMany(blobs, model->imageCount, false, model->images);
+    releaseImageBlobs(blobs, views, model->imageCount);
+    lovrAssert(failed == ~0u, "Could not load image %d", failed);
   }
 
   // Materials
@@ -803,6 +867,8 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
 
   // Nodes
   uint32_t childIndex = 0;
+  uint32_t lodIndex = 0;
+  uint32_t lodNodeIndex = 0;
   if (model->nodeCount > 0) {
     jsmntok_t* token = info.nodes;
     ModelNode* node = model->nodes;
@@ -813,6 +879,10 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
       node->matrix = false;
       node->primitiveCount = 0;
       node->skin = ~0u;
+      node->lod = ~0u;
+
+      float coverage[MAX_LOD_LEVELS];
+      uint32_t coverageCount = 0;
 
       for (int k = (token++)->size; k > 0; k--) {
         gltfString key = NOM_STR(json, token);
@@ -852,14 +922,60 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
           scale[2] = NOM_FLOAT(json, token);
         } else if (STR_EQ(key, "name")) {
           gltfString name = NOM_STR(json, token);
-          map_set(&model->nodeMap, hash64(name.data, name.length), model->nodeCount - i);
+          map_set(&model->nodeMap, hash64(name.data, name.length), node - model->nodes);
           memcpy(model->chars, name.data, name.length);
           node->name = model->chars;
           model->chars += name.length + 1;
+        } else if (STR_EQ(key, "extensions")) {
+          for (int e = (token++)->size; e > 0; e--) {
+            gltfString extension = NOM_STR(json, token);
+            if (STR_EQ(extension, "MSFT_lod")) {
+              for (int l = (token++)->size; l > 0; l--) {
+                gltfString key = NOM_STR(json, token);
+                if (STR_EQ(key, "ids")) {
+                  ModelLodGroup* group = &model->lods[lodIndex];
+                  node->lod = lodIndex++;
+                  group->nodes = &model->lodNodes[lodNodeIndex];
+                  group->coverage = &model->lodCoverage[lodNodeIndex];
+                  group->levelCount = (token++)->size + 1;
+                  group->nodes[0] = node - model->nodes;
+                  for (uint32_t j = 1; j < group->levelCount; j++) {
+                    group->nodes[j] = NOM_INT(json, token);
+                  }
+                  lodNodeIndex += group->levelCount;
+                } else {
+                  token += NOM_VALUE(json, token);
+                }
+              }
+            } else {
+              token += NOM_VALUE(json, token);
+            }
+          }
+        } else if (STR_EQ(key, "extras") && token->type == JSMN_OBJECT) {
+          for (int e = (token++)->size; e > 0; e--) {
+            gltfString key = NOM_STR(json, token);
+            if (STR_EQ(key, "MSFT_screencoverage") && token->type == JSMN_ARRAY) {
+              for (int j = (token++)->size; j > 0; j--) {
+                float value = NOM_FLOAT(json, token);
+                if (coverageCount < MAX_LOD_LEVELS) {
+                  coverage[coverageCount++] = value;
+                }
+              }
+            } else {
+              token += NOM_VALUE(json, token);
+            }
+          }
         } else {
           token += NOM_VALUE(json, token);
         }
       }
+
+      if (node->lod != ~0u) {
+        ModelLodGroup* group = &model->lods[node->lod];
+        for (uint32_t j = 0; j < group->levelCount; j++) {
+          group->coverage[j] = j < coverageCount ? coverage[j] : (j < group->levelCount - 1 ? .25f / (1 << j) : 0.f);
+        }
+      }
     }
   }
 
@@ -900,6 +1016,7 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
     lastNode->matrix = true;
     lastNode->primitiveCount = 0;
     lastNode->skin = ~0u;
+    lastNode->lod = ~0u;
 
     jsmntok_t* token = info.scenes;
     int sceneCount = (token++)->size;
@@ -923,6 +1040,68 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
     model->rootNode = scenes[rootScene].node;
   }
 
+  // LOD groups using the NAME_LOD0, NAME_LOD1, ... naming convention
+  for (uint32_t i = 0; i < model->nodeCount; i++) {
+    ModelNode* node = &model->nodes[i];
+    size_t prefix;
+    char name[256];
+
+    if (node->lod != ~0u || !node->name || parseLodSuffix(node->name, strlen(node->name), &prefix) != 0 || prefix + 8 > sizeof(name)) {
+      continue;
+    }
+
+    ModelLodGroup* group = &model->lods[lodIndex];
+    group->nodes = &model->lodNodes[lodNodeIndex];
+    group->coverage = &model->lodCoverage[lodNodeIndex];
+    group->nodes[0] = i;
+    group->levelCount = 1;
+    memcpy(name, node->name, prefix);
+
+    while (group->levelCount < MAX_LOD_LEVELS && lodNodeIndex + group->levelCount < model->lodLevelCount) {
+      int length = snprintf(name + prefix, sizeof(name) - prefix, "_LOD%u", group->levelCount);
+      uint64_t level = map_get(&model->nodeMap, hash64(name, prefix + length));
+      if (level == MAP_NIL) break;
+      group->nodes[group->levelCount++] = (uint32_t) level;
+    }
+
+    if (group->levelCount > 1) {
+      for (uint32_t j = 0; j < group->levelCount; j++) {
+        group->coverage[j] = j < group->levelCount - 1 ? .25f / (1 << j) : 0.f;
+      }
+      node->lod = lodIndex++;
+      lodNodeIndex += group->levelCount;
+    }
+  }
+
+  model->lodCount = lodIndex;
+
+  // Coarser LOD levels are only drawn through their group, so detach them from the hierarchy
+  if (model->lodCount > 0) {
+    bool* detached = calloc(model->nodeCount, sizeof(bool));
+    lovrAssert(detached, "Out of memory");
+
+    for (uint32_t i = 0; i < model->lodCount; i++) {
+      ModelLodGroup* group = &model->lods[i];
+      for (uint32_t j = 1; j < group->levelCount; j++) {
+        lovrAssert(group->nodes[j] < model->nodeCount, "LOD node index out of range");
+        detached[group->nodes[j]] = true;
+      }
+    }
+
+    for (uint32_t i = 0; i < model->nodeCount; i++) {
+      ModelNode* node = &model->nodes[i];
+      uint32_t childCount = 0;
+      for (uint32_t j = 0; j < node->childCount; j++) {
+        if (!detached[node->children[j]]) {
+          node->children[childCount++] = node->children[j];
+        }
+      }
+      node->childCount = childCount;
+    }
+
+    free(detached);
+  }
+
   free(animationSamplers);
   free(meshes);
   free(samplers);
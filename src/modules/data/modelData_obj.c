@@ -15,7 +15,7 @@ typedef struct {
 } objGroup;
 
 typedef arr_t(ModelMaterial) arr_material_t;
-typedef arr_t(Image*) arr_image_t;
+typedef arr_t(Blob*) arr_blob_t;
 typedef arr_t(objGroup) arr_group_t;
 
 #define STARTS_WITH(a, b) !strncmp(a, b, strlen(b))
@@ -27,7 +27,7 @@ static uint32_t nomu32(char* s, char** end) {
   return n;
 }
 
-static void parseMtl(char* path, char* base, ModelDataIO* io, arr_image_t* images, arr_material_t* materials, map_t* names) {
+static void parseMtl(char* path, char* base, ModelDataIO* io, arr_blob_t* images, arr_material_t* materials, map_t* names) {
   size_t size = 0;
   char* p = io(path, &size);
   lovrAssert(p && size > 0, "Unable to read mtl from '%s'", path);
@@ -71,15 +71,12 @@ static void parseMtl(char* path, char* base, ModelDataIO* io, arr_image_t* image
       void* pixels = io(path, &imageSize);
       lovrAssert(pixels && imageSize > 0, "Unable to read image from %s", path);
       Blob* blob = lovrBlobCreate(pixels, imageSize, NULL);
-
-      Image* image = lovrImageCreateFromBlob(blob, true);
       lovrAssert(materials->length > 0, "Tried to set a material property without declaring a material first");
       ModelMaterial* material = &materials->data[materials->length - 1];
       material->images[TEXTURE_DIFFUSE] = (uint32_t) images->length;
       material->filters[TEXTURE_DIFFUSE].mode = FILTER_TRILINEAR;
       material->wraps[TEXTURE_DIFFUSE] = (TextureWrap) { .s = WRAP_REPEAT, .t = WRAP_REPEAT };
-      arr_push(images, image);
-      lovrRelease(blob, lovrBlobDestroy);
+      arr_push(images, blob);
     }
 
     next:
@@ -100,7 +97,7 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
   size_t size = source->size;
 
   arr_group_t groups;
-  arr_image_t images;
+  arr_blob_t images;
   arr_material_t materials;
   arr_t(float) vertexBlob;
   arr_t(int) indexBlob;
@@ -267,7 +264,8 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
     .stride = sizeof(int)
   };
 
-  memcpy(model->images, images.data, model->imageCount * sizeof(Image*));
+  uint32_t failed = lovrImageCreateMany(images.data, model->imageCount, true, model->images);
+  lovrAssert(failed == ~0u, "Could not load OBJ material image %d", failed + 1);
   memcpy(model->materials, materials.data, model->materialCount * sizeof(ModelMaterial));
   memcpy(model->materialMap.hashes, materialMap.hashes, materialMap.size * sizeof(uint64_t));
   memcpy(model->materialMap.values, materialMap.values, materialMap.size * sizeof(uint64_t));
@@ -347,10 +345,14 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
     .primitiveIndex = 0,
     .primitiveCount = (uint32_t) groups.length,
     .skin = ~0u,
+    .lod = ~0u,
     .matrix = true
   };
 
 finish:
+  for (size_t i = 0; i < images.length; i++) {
+    lovrRelease(images.data[i], lovrBlobDestroy);
+  }
   arr_free(&groups);
   arr_free(&images);
   arr_free(&materials);
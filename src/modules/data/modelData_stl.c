@@ -44,7 +44,8 @@ extern ModelData* lovrModelDataInitStlBinary(ModelData* model, Blob* source, Mod
     .matrix = true,
     .transform.matrix = MAT4_IDENTITY,
     .primitiveCount = 1,
-    .skin = ~0u
+    .skin = ~0u,
+    .lod = ~0u
   };
 
   for (uint32_t i = 0; i < triangleCount; i++) {
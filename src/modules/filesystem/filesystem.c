@@ -41,6 +41,7 @@ typedef struct Archive {
   bool (*stat)(struct Archive* archive, const char* path, FileInfo* info);
   void (*list)(struct Archive* archive, const char* path, fs_list_cb callback, void* context);
   bool (*read)(struct Archive* archive, const char* path, size_t bytes, size_t* bytesRead, void** data);
+  bool (*map)(struct Archive* archive, const char* path, size_t* size, void** data);
   void (*close)(struct Archive* archive);
   zip_state zip;
   strpool strings;
@@ -262,6 +263,20 @@ void* lovrFilesystemRead(const char* path, size_t bytes, size_t* bytesRead) {
   return NULL;
 }
 
+// Returns NULL if the file can't be mapped (e.g. it's compressed in a zip), lovrFilesystemRead still
+// works in that case.  The mapping is read only and is released with fs_unmap.
+void* lovrFilesystemMap(const char* path, size_t* size) {
+  if (valid(path)) {
+    void* data;
+    FOREACH_ARCHIVE(archive) {
+      if (archive->map(archive, path, size, &data)) {
+        return data;
+      }
+    }
+  }
+  return NULL;
+}
+
 void lovrFilesystemGetDirectoryItems(const char* path, void (*callback)(void* context, const char* path), void* context) {
   if (valid(path)) {
     FOREACH_ARCHIVE(archive) {
@@ -480,6 +495,18 @@ static bool dir_read(Archive* archive, const char* path, size_t bytes, size_t* b
   return true;
 }
 
+static bool dir_map(Archive* archive, const char* path, size_t* size, void** data) {
+  char resolved[LOVR_PATH_MAX];
+  FileInfo info;
+
+  if (!dir_resolve(resolved, archive, path) || !fs_stat(resolved, &info)) {
+    return false;
+  }
+
+  *data = info.type == FILE_REGULAR && info.size > 0 ? fs_map(resolved, size) : NULL;
+  return true;
+}
+
 static void dir_close(Archive* archive) {
   arr_free(&archive->strings);
 }
@@ -493,6 +520,7 @@ static bool dir_init(Archive* archive, const char* path, const char* mountpoint,
   archive->stat = dir_stat;
   archive->list = dir_list;
   archive->read = dir_read;
+  archive->map = dir_map;
   archive->close = dir_close;
   return true;
 }
@@ -583,6 +611,12 @@ static bool zip_read(Archive* archive, const char* path, size_t bytes, size_t* b
   return true;
 }
 
+// Files in a zip share the mapping of the whole archive, which could be unmounted at any time
+static bool zip_map(Archive* archive, const char* path, size_t* size, void** data) {
+  *data = NULL;
+  return zip_lookup(archive, path) != NULL;
+}
+
 static void zip_close(Archive* archive) {
   arr_free(&archive->nodes);
   map_free(&archive->lookup);
@@ -700,6 +734,7 @@ static bool zip_init(Archive* archive, const char* filename, const char* mountpo
   archive->stat = zip_stat;
   archive->list = zip_list;
   archive->read = zip_read;
+  archive->map = zip_map;
   archive->close = zip_close;
   return true;
 }
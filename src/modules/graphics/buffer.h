@@ -15,7 +15,8 @@ typedef enum {
 typedef enum {
   USAGE_STATIC,
   USAGE_DYNAMIC,
-  USAGE_STREAM
+  USAGE_STREAM,
+  USAGE_PERSISTENT
 } BufferUsage;
 
 typedef struct Buffer Buffer;
@@ -0,0 +1,21 @@
+#include "graphics/graphics.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#pragma once
+
+struct Material;
+struct Mesh;
+struct Shader;
+
+typedef struct DrawList DrawList;
+DrawList* lovrDrawListCreate(void);
+void lovrDrawListDestroy(void* ref);
+uint32_t lovrDrawListGetDrawCount(DrawList* list);
+void lovrDrawListClear(DrawList* list);
+void lovrDrawListSetColor(DrawList* list, Color color);
+void lovrDrawListSetShader(DrawList* list, struct Shader* shader);
+void lovrDrawListBox(DrawList* list, DrawStyle style, struct Material* material, mat4 transform);
+void lovrDrawListCylinder(DrawList* list, struct Material* material, mat4 transform, float r1, float r2, bool capped, int segments);
+void lovrDrawListSphere(DrawList* list, struct Material* material, mat4 transform, int segments);
+void lovrDrawListDrawMesh(DrawList* list, struct Mesh* mesh, mat4 transform, uint32_t instances, float* pose, uint32_t boneCount);
@@ -106,7 +106,7 @@ Texture* lovrFontGetTexture(Font* font) {
   return font->texture;
 }
 
-void lovrFontRender(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign, float* vertices, uint16_t* indices, uint16_t baseVertex) {
+void lovrFontRender(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign, float* vertices, void* indices, uint32_t baseVertex, bool wideIndices) {
   FontAtlas* atlas = &font->atlas;
   bool flip = font->flip;
 
@@ -126,8 +126,9 @@ void lovrFontRender(Font* font, const char* str, size_t length, float wrap, Hori
 
   float* vertexCursor = vertices;
   uint16_t* indexCursor = indices;
+  uint32_t* wideIndexCursor = indices;
   float* lineStart = vertices;
-  uint16_t I = baseVertex;
+  uint32_t I = baseVertex;
 
   while ((bytes = utf8_decode(str, end, &codepoint)) > 0) {
 
@@ -160,7 +161,7 @@ void lovrFontRender(Font* font, const char* str, size_t length, float wrap, Hori
 
     // Start over if texture was repacked
     if (u != atlas->width || v != atlas->height) {
-      lovrFontRender(font, start, length, wrap, halign, vertices, indices, baseVertex);
+      lovrFontRender(font, start, length, wrap, halign, vertices, indices, baseVertex, wideIndices);
       return;
     }
 
@@ -183,10 +184,15 @@ void lovrFontRender(Font* font, const char* str, size_t length, float wrap, Hori
         x2, y2, 0.f, 0.f, 0.f, 0.f, s2, t2
       }, 32 * sizeof(float));
 
-      memcpy(indexCursor, (uint16_t[6]) { I + 0, I + 1, I + 2, I + 2, I + 1, I + 3 }, 6 * sizeof(uint16_t));
+      if (wideIndices) {
+        memcpy(wideIndexCursor, (uint32_t[6]) { I + 0, I + 1, I + 2, I + 2, I + 1, I + 3 }, 6 * sizeof(uint32_t));
+        wideIndexCursor += 6;
+      } else {
+        memcpy(indexCursor, (uint16_t[6]) { I + 0, I + 1, I + 2, I + 2, I + 1, I + 3 }, 6 * sizeof(uint16_t));
+        indexCursor += 6;
+      }
 
       vertexCursor += 32;
-      indexCursor += 6;
       I += 4;
     }
 
@@ -351,7 +357,7 @@ static void lovrFontAddGlyph(Font* font, Glyph* glyph) {
   glyph->y = atlas->y;
 
   // Paste glyph into texture
-  lovrTextureReplacePixels(font->texture, glyph->data, atlas->x, atlas->y, 0, 0);
+  lovrTextureReplacePixels(font->texture, glyph->data, atlas->x, atlas->y, 0, 0, false);
 
   // Advance atlas cursor
   atlas->x += glyph->tw + atlas->padding;
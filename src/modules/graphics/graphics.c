@@ -1,14 +1,18 @@
 #include "graphics/graphics.h"
 #include "graphics/buffer.h"
 #include "graphics/canvas.h"
+#include "graphics/drawList.h"
 #include "graphics/material.h"
 #include "graphics/mesh.h"
+#include "graphics/model.h"
 #include "graphics/shader.h"
 #include "graphics/texture.h"
 #include "data/rasterizer.h"
+#include "resources/shaders.h"
 #include "event/event.h"
 #include "math/math.h"
 #include "core/maf.h"
+#include "core/map.h"
 #include "core/os.h"
 #include "core/util.h"
 #include <stdlib.h>
@@ -16,16 +20,25 @@
 #include <math.h>
 
 #define MAX_TRANSFORMS 64
-#define MAX_BATCHES 4
 #define MAX_DRAWS 256
+#define MAX_WIDE_DRAWS (1 << 16)
+#define MAX_STREAM_DRAWS (MAX_DRAWS * 16)
+#define MAX_WIDE_POSES (1 << 16)
+#define STREAM_REGIONS 4
+#define MAX_SHAPES 256
+#define MAX_SHAPE_KEYS 1024
+#define SHAPE_SEEN (MAP_NIL - 1)
+#define MAX_RECORDED_ELEMENTS (1 << 24)
 
 typedef enum {
   STREAM_VERTEX,
   STREAM_DRAWID,
   STREAM_INDEX,
+  STREAM_INDEX32,
   STREAM_MODEL,
   STREAM_COLOR,
   STREAM_FRAME,
+  STREAM_POSE,
   MAX_STREAMS
 } StreamType;
 
@@ -52,7 +65,7 @@ typedef union {
   struct { int segments; } sphere;
   struct { float spread; } text;
   struct { float u; float v; float w; float h; } fill;
-  struct { uint32_t rangeStart; uint32_t rangeCount; uint32_t instances; float* pose; } mesh;
+  struct { uint32_t rangeStart; uint32_t rangeCount; uint32_t instances; uint32_t boneCount; } mesh;
 } BatchParams;
 
 typedef struct {
@@ -65,11 +78,13 @@ typedef struct {
   Material* material;
   Texture* texture;
   mat4 transform;
+  float* pose;
   uint32_t vertexCount;
   uint32_t indexCount;
   float** vertices;
-  uint16_t** indices;
-  uint16_t* baseVertex;
+  void** indices;
+  uint32_t* baseVertex;
+  bool* wideIndices;
   bool instanced;
 } BatchRequest;
 
@@ -77,14 +92,63 @@ typedef struct {
   BatchType type;
   BatchParams params;
   DrawCommand draw;
+  DefaultShader defaultShader;
   Material* material;
-  mat4 transforms;
-  Color* colors;
+  uint64_t sortKey;
   uint32_t drawStart;
   uint32_t drawCount;
+  uint32_t poseStart;
+  uint32_t cursor;
   bool indexed;
+  bool wideIndices;
+  bool ordered;
 } Batch;
 
+typedef struct {
+  float transform[16];
+  Color color;
+  uint32_t batch;
+  uint32_t pose;
+} DrawData;
+
+typedef struct {
+  BatchType type;
+  BatchParams params;
+  Mesh* mesh;
+  uint64_t hash;
+} Shape;
+
+typedef struct {
+  Batch batch;
+  struct Texture* texture;
+  struct Texture* skybox;
+  bool defaultMaterial;
+  bool inheritPipeline;
+} DrawListCommand;
+
+struct DrawList {
+  uint32_t ref;
+  arr_t(DrawListCommand) commands;
+  arr_t(uint8_t) streams[STREAM_MODEL];
+  arr_t(float) transforms;
+  arr_t(Color) colors;
+  arr_t(float) poses;
+  Buffer* buffers[MAX_STREAMS];
+  uint32_t bufferCount[MAX_STREAMS];
+  Mesh* mesh;
+  Mesh* instancedMesh;
+  Shader* shader;
+  Color color;
+  float transform[16];
+  uint32_t slotCount;
+  uint32_t poseCount;
+  uint32_t drawCount;
+  bool uploaded;
+  bool dirty;
+};
+
+typedef void ShapeTessellator(const BatchParams* params, float* vertices, void* indices, bool wideIndices, uint32_t baseVertex);
+
 typedef struct {
   float viewMatrix[2][16];
   float projection[2][16];
@@ -93,11 +157,19 @@ typedef struct {
 static struct {
   bool initialized;
   bool debug;
+  bool wideDraws;
+  uint32_t maxDraws;
+  uint32_t maxBones;
+  uint32_t streamVertices;
+  uint32_t streamIndices;
   int width;
   int height;
   Canvas* backbuffer;
   FrameData frameData;
   bool frameDataDirty;
+  float viewProjection[2][16];
+  bool frustumDirty;
+  bool frustumCulling;
   Canvas* defaultCanvas;
   Shader* defaultShaders[MAX_DEFAULT_SHADERS][2];
   Material* defaultMaterial;
@@ -118,42 +190,65 @@ static struct {
   Mesh* instancedMesh;
   Buffer* identityBuffer;
   Buffer* buffers[MAX_STREAMS];
+  uint32_t bufferCount[MAX_STREAMS];
   uint32_t head[MAX_STREAMS];
   uint32_t tail[MAX_STREAMS];
-  Batch batches[MAX_BATCHES];
-  uint8_t batchCount;
+  bool persistent[MAX_STREAMS];
+  void* fences[MAX_STREAMS][STREAM_REGIONS];
+  uint32_t fenced[MAX_STREAMS];
+  arr_t(Batch) batches;
+  arr_t(DrawData) draws;
+  arr_t(float) poses;
+  arr_t(uint32_t) batchOrder;
+  map_t batchMap;
+  uint32_t batchBarrier;
+  arr_t(Shape) shapes;
+  map_t shapeMap;
+  DrawList* drawList;
+  uint32_t savedHead[STREAM_MODEL];
+  uint32_t savedCount[STREAM_MODEL];
 } state;
 
-static const uint32_t bufferCount[] = {
-  [STREAM_VERTEX] = (1 << 16) - 1,
-  [STREAM_DRAWID] = (1 << 16) - 1,
+#define RESTART_INDEX 0xffffffff
+#define MAX_SHORT_VERTICES ((1 << 16) - 1)
+
+static const uint32_t defaultBufferCount[] = {
+  [STREAM_VERTEX] = MAX_SHORT_VERTICES,
+  [STREAM_DRAWID] = MAX_SHORT_VERTICES,
   [STREAM_INDEX] = 1 << 16,
+  [STREAM_INDEX32] = 0,
 #if defined(LOVR_WEBGL) // Work around bugs where big UBOs don't work
   [STREAM_MODEL] = MAX_DRAWS,
   [STREAM_COLOR] = MAX_DRAWS,
+  [STREAM_POSE] = MAX_BONES,
 #else
-  [STREAM_MODEL] = MAX_DRAWS * MAX_BATCHES,
-  [STREAM_COLOR] = MAX_DRAWS * MAX_BATCHES,
+  [STREAM_MODEL] = MAX_STREAM_DRAWS,
+  [STREAM_COLOR] = MAX_STREAM_DRAWS,
+  [STREAM_POSE] = MAX_BONES * 16,
 #endif
   [STREAM_FRAME] = 4
 };
 
 static const size_t bufferStride[] = {
   [STREAM_VERTEX] = 8 * sizeof(float),
-  [STREAM_DRAWID] = sizeof(uint8_t),
+  [STREAM_DRAWID] = sizeof(uint16_t),
   [STREAM_INDEX] = sizeof(uint16_t),
+  [STREAM_INDEX32] = sizeof(uint32_t),
   [STREAM_MODEL] = 16 * sizeof(float),
   [STREAM_COLOR] = 4 * sizeof(float),
-  [STREAM_FRAME] = sizeof(FrameData)
+  [STREAM_FRAME] = sizeof(FrameData),
+  [STREAM_POSE] = 16 * sizeof(float)
 };
 
 static const BufferType bufferType[] = {
   [STREAM_VERTEX] = BUFFER_VERTEX,
   [STREAM_DRAWID] = BUFFER_GENERIC,
   [STREAM_INDEX] = BUFFER_INDEX,
+  [STREAM_INDEX32] = BUFFER_INDEX,
   [STREAM_MODEL] = BUFFER_UNIFORM,
   [STREAM_COLOR] = BUFFER_UNIFORM,
-  [STREAM_FRAME] = BUFFER_UNIFORM
+  [STREAM_FRAME] = BUFFER_UNIFORM,
+  [STREAM_POSE] = BUFFER_UNIFORM
 };
 
 static void gammaCorrect(Color* color) {
@@ -174,23 +269,75 @@ static void onResizeWindow(int width, int height) {
   lovrEventPush((Event) { .type = EVENT_RESIZE, .data.resize = { width, height } });
 }
 
+// Persistent streams are split into regions.  Once the stream moves past a region, a fence is
+// inserted after the draws that read from it, and the region isn't written again until the
+// fence is signaled.
+static uint32_t getRegionSize(StreamType type) {
+  return (state.bufferCount[type] + STREAM_REGIONS - 1) / STREAM_REGIONS;
+}
+
+static void fenceRegions(StreamType type, uint32_t end) {
+  uint32_t regionSize = getRegionSize(type);
+  while (state.fenced[type] < STREAM_REGIONS && (state.fenced[type] + 1) * regionSize <= end) {
+    void** fence = &state.fences[type][state.fenced[type]++];
+    lovrGpuDestroyFence(*fence);
+    *fence = lovrGpuFence();
+  }
+}
+
+// Waits for the GPU to finish reading the regions covering [start, end) before they're written
+static void waitRegions(StreamType type, uint32_t start, uint32_t end) {
+  if (!state.persistent[type] || end <= start) {
+    return;
+  }
+
+  uint32_t regionSize = getRegionSize(type);
+  uint32_t last = MIN((end - 1) / regionSize, STREAM_REGIONS - 1);
+  for (uint32_t i = start / regionSize; i <= last; i++) {
+    if (state.fences[type][i]) {
+      lovrGpuWaitFence(state.fences[type][i]);
+      state.fences[type][i] = NULL;
+    }
+  }
+}
+
 static void* lovrGraphicsMapBuffer(StreamType type, uint32_t count) {
-  lovrAssert(count <= bufferCount[type], "Whoa there!  Tried to get %d elements from a buffer that only has %d elements.", count, bufferCount[type]);
+  lovrAssert(count <= state.bufferCount[type], "Whoa there!  Tried to get %d elements from a buffer that only has %d elements.", count, state.bufferCount[type]);
+
+  // While a DrawList is recording, geometry goes to the list instead of the streams
+  if (state.drawList && type < STREAM_MODEL) {
+    lovrAssert(state.head[type] + count <= state.bufferCount[type], "Too much geometry was recorded into a DrawList");
+    size_t size = (state.head[type] + count) * bufferStride[type];
+    arr_reserve(&state.drawList->streams[type], size);
+    state.drawList->streams[type].length = MAX(state.drawList->streams[type].length, size);
+    return state.drawList->streams[type].data + state.head[type] * bufferStride[type];
+  }
 
-  if (state.head[type] + count > bufferCount[type]) {
-    lovrAssert(state.batchCount == 0, "Internal error: Batches still exist during Buffer reset");
-    lovrBufferDiscard(state.buffers[type]);
+  if (state.head[type] + count > state.bufferCount[type]) {
+    lovrAssert(state.batches.length == 0, "Internal error: Batches still exist during Buffer reset");
+    if (state.persistent[type]) {
+      fenceRegions(type, UINT32_MAX);
+      state.fenced[type] = 0;
+    } else {
+      lovrBufferDiscard(state.buffers[type]);
+    }
     state.tail[type] = 0;
     state.head[type] = 0;
   }
 
+  waitRegions(type, state.head[type], state.head[type] + MAX(count, 1));
   return lovrBufferMap(state.buffers[type], state.head[type] * bufferStride[type], true);
 }
 
 // Base
 
-bool lovrGraphicsInit(bool debug) {
+bool lovrGraphicsInit(bool debug, uint32_t vertexCount, uint32_t indexCount) {
+  if (state.initialized) return false; // Threads load the module to record DrawLists
+  lovrAssert(vertexCount <= MAX_STREAM_VERTICES, "Too many stream vertices (max is %d)", MAX_STREAM_VERTICES);
+  lovrAssert(indexCount <= MAX_STREAM_INDICES, "Too many stream indices (max is %d)", MAX_STREAM_INDICES);
   state.debug = debug;
+  state.streamVertices = vertexCount;
+  state.streamIndices = indexCount;
   return false; // See lovrGraphicsCreateWindow for actual initialization
 }
 
@@ -204,19 +351,33 @@ void lovrGraphicsDestroy() {
     lovrRelease(state.defaultShaders[i][true], lovrShaderDestroy);
   }
   for (int i = 0; i < MAX_STREAMS; i++) {
+    for (int j = 0; j < STREAM_REGIONS; j++) {
+      lovrGpuDestroyFence(state.fences[i][j]);
+    }
     lovrRelease(state.buffers[i], lovrBufferDestroy);
   }
+  for (size_t i = 0; i < state.shapes.length; i++) {
+    lovrRelease(state.shapes.data[i].mesh, lovrMeshDestroy);
+  }
+  arr_free(&state.shapes);
+  map_free(&state.shapeMap);
   lovrRelease(state.mesh, lovrMeshDestroy);
   lovrRelease(state.instancedMesh, lovrMeshDestroy);
   lovrRelease(state.identityBuffer, lovrBufferDestroy);
   lovrRelease(state.defaultMaterial, lovrMaterialDestroy);
   lovrRelease(state.defaultFont, lovrFontDestroy);
   lovrRelease(state.defaultCanvas, lovrCanvasDestroy);
+  arr_free(&state.batches);
+  arr_free(&state.draws);
+  arr_free(&state.poses);
+  arr_free(&state.batchOrder);
+  map_free(&state.batchMap);
   lovrGpuDestroy();
   memset(&state, 0, sizeof(state));
 }
 
 void lovrGraphicsPresent() {
+  lovrModelUpdateLoading();
   lovrGraphicsFlush();
   os_window_swap();
   lovrGpuPresent();
@@ -248,16 +409,51 @@ void lovrGraphicsCreateWindow(WindowFlags* flags) {
   state.defaultCanvas = lovrCanvasCreateFromHandle(state.width, state.height, (CanvasFlags) { .stereo = false }, 0, 0, 0, 1, true);
   state.backbuffer = state.defaultCanvas;
 
+  // When storage buffers are usable in vertex shaders, transforms and colors are read from storage
+  // blocks instead of fixed size uniform blocks, which lets a single batch hold many more draws.
+  state.wideDraws = lovrGpuGetFeatures()->wideDraws;
+  state.maxDraws = state.wideDraws ? MAX_WIDE_DRAWS : MAX_DRAWS;
+  memcpy(state.bufferCount, defaultBufferCount, sizeof(state.bufferCount));
+
+  if (state.streamVertices > 0) {
+    state.bufferCount[STREAM_VERTEX] = state.streamVertices;
+    state.bufferCount[STREAM_DRAWID] = state.streamVertices;
+  }
+
+  if (state.streamIndices > 0) {
+    state.bufferCount[STREAM_INDEX] = state.streamIndices;
+  }
+
+  // Vertices past the range of 16 bit indices use a separate 32 bit index stream, with as many
+  // indices as the 16 bit one.  It only exists when the vertex stream is bigger than 16 bit indices
+  // can address, which is also the only way a batch can need wide indices.
+  if (state.bufferCount[STREAM_VERTEX] > MAX_SHORT_VERTICES) {
+    state.bufferCount[STREAM_INDEX32] = state.bufferCount[STREAM_INDEX];
+  }
+
+  if (state.wideDraws) {
+    state.bufferCount[STREAM_MODEL] = MAX_WIDE_DRAWS;
+    state.bufferCount[STREAM_COLOR] = MAX_WIDE_DRAWS;
+    state.bufferCount[STREAM_POSE] = MAX_WIDE_POSES;
+  }
+
+  // Skinned meshes read their joints from the pose stream, a uniform block limits them to MAX_BONES
+  state.maxBones = state.wideDraws ? MAX_WIDE_POSES : MAX_BONES;
+
   for (int i = 0; i < MAX_STREAMS; i++) {
-    state.buffers[i] = lovrBufferCreate(bufferCount[i] * bufferStride[i], NULL, bufferType[i], USAGE_STREAM, false);
+    if (state.bufferCount[i] == 0) continue;
+    bool storage = state.wideDraws && (i == STREAM_MODEL || i == STREAM_COLOR || i == STREAM_POSE);
+    BufferType type = storage ? BUFFER_SHADER_STORAGE : bufferType[i];
+    state.buffers[i] = lovrBufferCreate(state.bufferCount[i] * bufferStride[i], NULL, type, USAGE_PERSISTENT, false);
+    state.persistent[i] = lovrBufferGetUsage(state.buffers[i]) == USAGE_PERSISTENT;
   }
 
   // The identity buffer is used for autoinstanced meshes and instanced primitives and maps the
   // instance ID to a vertex attribute.  Its contents never change, so they are initialized here.
-  state.identityBuffer = lovrBufferCreate(MAX_DRAWS * sizeof(uint8_t), NULL, BUFFER_VERTEX, USAGE_STATIC, false);
-  uint8_t* id = lovrBufferMap(state.identityBuffer, 0, true);
-  for (int i = 0; i < MAX_DRAWS; i++) id[i] = i;
-  lovrBufferFlush(state.identityBuffer, 0, MAX_DRAWS);
+  state.identityBuffer = lovrBufferCreate(state.maxDraws * sizeof(uint16_t), NULL, BUFFER_VERTEX, USAGE_STATIC, false);
+  uint16_t* id = lovrBufferMap(state.identityBuffer, 0, true);
+  for (uint32_t i = 0; i < state.maxDraws; i++) id[i] = (uint16_t) i;
+  lovrBufferFlush(state.identityBuffer, 0, state.maxDraws * sizeof(uint16_t));
   lovrBufferUnmap(state.identityBuffer);
 
   Buffer* vertexBuffer = state.buffers[STREAM_VERTEX];
@@ -266,8 +462,8 @@ void lovrGraphicsCreateWindow(WindowFlags* flags) {
   MeshAttribute position = { .buffer = vertexBuffer, .offset = 0, .stride = stride, .type = F32, .components = 3 };
   MeshAttribute normal = { .buffer = vertexBuffer, .offset = 12, .stride = stride, .type = F32, .components = 3 };
   MeshAttribute texCoord = { .buffer = vertexBuffer, .offset = 24, .stride = stride, .type = F32, .components = 2 };
-  MeshAttribute drawId = { .buffer = state.buffers[STREAM_DRAWID], .type = U8, .components = 1 };
-  MeshAttribute identity = { .buffer = state.identityBuffer, .type = U8, .components = 1, .divisor = 1 };
+  MeshAttribute drawId = { .buffer = state.buffers[STREAM_DRAWID], .type = U16, .components = 1 };
+  MeshAttribute identity = { .buffer = state.identityBuffer, .type = U16, .components = 1, .divisor = 1 };
 
   state.mesh = lovrMeshCreate(DRAW_TRIANGLES, NULL, 0);
   lovrMeshAttachAttribute(state.mesh, "lovrPosition", &position);
@@ -281,6 +477,14 @@ void lovrGraphicsCreateWindow(WindowFlags* flags) {
   lovrMeshAttachAttribute(state.instancedMesh, "lovrTexCoord", &texCoord);
   lovrMeshAttachAttribute(state.instancedMesh, "lovrDrawID", &identity);
 
+  arr_init(&state.batches, realloc);
+  arr_init(&state.draws, realloc);
+  arr_init(&state.poses, realloc);
+  arr_init(&state.batchOrder, realloc);
+  map_init(&state.batchMap, 64);
+  arr_init(&state.shapes, realloc);
+  map_init(&state.shapeMap, 64);
+
   lovrGraphicsReset();
   state.initialized = true;
 }
@@ -336,6 +540,7 @@ void lovrGraphicsSetViewMatrix(uint32_t index, float* viewMatrix) {
     mat4_identity(state.frameData.viewMatrix[index]);
   }
   state.frameDataDirty = true;
+  state.frustumDirty = true;
 }
 
 void lovrGraphicsGetProjection(uint32_t index, float* projection) {
@@ -354,6 +559,7 @@ void lovrGraphicsSetProjection(uint32_t index, float* projection) {
     mat4_perspective(state.frameData.projection[index], .01f, 100.f, fov, aspect);
   }
   state.frameDataDirty = true;
+  state.frustumDirty = true;
 }
 
 Buffer* lovrGraphicsGetIdentityBuffer() {
@@ -375,6 +581,7 @@ void lovrGraphicsReset() {
   lovrGraphicsSetColor((Color) { 1, 1, 1, 1 });
   lovrGraphicsSetColorMask(true, true, true, true);
   lovrGraphicsSetCullingEnabled(false);
+  lovrGraphicsSetFrustumCullingEnabled(true);
   lovrGraphicsSetDefaultFilter((TextureFilter) { .mode = FILTER_TRILINEAR });
   lovrGraphicsSetDepthTest(COMPARE_LEQUAL, true);
   lovrGraphicsSetFont(NULL);
@@ -461,6 +668,14 @@ void lovrGraphicsSetCullingEnabled(bool culling) {
   state.pipeline.culling = culling;
 }
 
+bool lovrGraphicsIsFrustumCullingEnabled() {
+  return state.frustumCulling;
+}
+
+void lovrGraphicsSetFrustumCullingEnabled(bool enabled) {
+  state.frustumCulling = enabled;
+}
+
 TextureFilter lovrGraphicsGetDefaultFilter() {
   return state.defaultFilter;
 }
@@ -585,79 +800,185 @@ void lovrGraphicsMatrixTransform(mat4 transform) {
   mat4_mul(state.transforms[state.transform], transform);
 }
 
+// Estimates the fraction of the first view's height covered by a bounding sphere (xyz + radius)
+// relative to the current transform.  DrawLists can be submitted anywhere, so they get full detail.
+float lovrGraphicsGetScreenCoverage(float sphere[4]) {
+  if (state.drawList) {
+    return 1.f;
+  }
+
+  float m[16];
+  mat4_init(m, state.frameData.viewMatrix[0]);
+  mat4_mul(m, state.transforms[state.transform]);
+
+  float center[4] = { sphere[0], sphere[1], sphere[2], 1.f };
+  mat4_transform(m, center);
+
+  float scale = MAX(vec3_length(m + 0), MAX(vec3_length(m + 4), vec3_length(m + 8)));
+  float radius = sphere[3] * scale;
+  float* projection = state.frameData.projection[0];
+
+  // Orthographic projections don't shrink things with distance
+  if (projection[11] == 0.f) {
+    return MIN(radius * projection[5], 1.f);
+  }
+
+  float distance = -center[2];
+  if (distance <= radius) {
+    return 1.f;
+  }
+
+  return MIN(radius * projection[5] / distance, 1.f);
+}
+
 // Rendering
 
+static uint64_t hashBatch(BatchType type, BatchParams* params, Mesh* mesh, Canvas* canvas, Shader* shader, Material* material, Pipeline* pipeline) {
+  struct {
+    void* objects[4];
+    Pipeline pipeline;
+    BatchParams params;
+    BatchType type;
+  } key;
+
+  memset(&key, 0, sizeof(key));
+  key.objects[0] = mesh;
+  key.objects[1] = canvas;
+  key.objects[2] = shader;
+  key.objects[3] = material;
+  memcpy(&key.pipeline, pipeline, sizeof(Pipeline));
+  memcpy(&key.params, params, sizeof(BatchParams));
+  key.type = type;
+  return hash64(&key, sizeof(key));
+}
+
+// Packs the state of a batch into a sort key, with the most expensive state changes in the high
+// bits.  The fields are hashed, so collisions only make the sort worse, they don't break anything.
+static uint64_t packSortKey(Canvas* canvas, Shader* shader, Pipeline* pipeline, Material* material, Mesh* mesh) {
+  uint64_t key = 0;
+  key |= (hash64(&canvas, sizeof(canvas)) & 0xff) << 56;
+  key |= (hash64(&shader, sizeof(shader)) & 0xffff) << 40;
+  key |= (hash64(pipeline, sizeof(Pipeline)) & 0xffff) << 24;
+  key |= (hash64(&material, sizeof(material)) & 0xfff) << 12;
+  key |= (hash64(&mesh, sizeof(mesh)) & 0xfff) << 0;
+  return key;
+}
+
+// Uniform blocks have a fixed size, storage blocks only need to cover the draws in the batch
+static uint32_t getDrawBlockSize(Batch* batch) {
+  return state.wideDraws ? batch->drawCount : MAX_DRAWS;
+}
+
+static uint32_t getBoneCount(Batch* batch) {
+  return batch->type == BATCH_MESH ? batch->params.mesh.boneCount : 0;
+}
+
+// Each draw in a skinned batch gets boneCount matrices in the pose block, indexed by its draw id
+static uint32_t getPoseBlockSize(Batch* batch) {
+  return state.wideDraws ? MAX(batch->drawCount * getBoneCount(batch), 1) : MAX_BONES;
+}
+
+static int compareBatches(const void* a, const void* b) {
+  uint32_t i = *(const uint32_t*) a;
+  uint32_t j = *(const uint32_t*) b;
+  uint64_t x = state.batches.data[i].sortKey;
+  uint64_t y = state.batches.data[j].sortKey;
+  return x != y ? (x < y ? -1 : 1) : (i < j ? -1 : (i > j));
+}
+
+static Shader* lovrGraphicsGetDefaultShader(DefaultShader type, bool stereo) {
+  if (!state.defaultShaders[type][stereo]) {
+    state.defaultShaders[type][stereo] = lovrShaderCreateDefault(type, NULL, 0, stereo);
+  }
+
+  return state.defaultShaders[type][stereo];
+}
+
+static Material* lovrGraphicsGetDefaultMaterial() {
+  if (!state.defaultMaterial) {
+    state.defaultMaterial = lovrMaterialCreate();
+  }
+
+  return state.defaultMaterial;
+}
+
 static void lovrGraphicsBatch(BatchRequest* req) {
 
   // Resolve objects
   Mesh* mesh = req->mesh ? req->mesh : (req->instanced ? state.instancedMesh : state.mesh);
   Canvas* canvas = state.canvas ? state.canvas : state.backbuffer;
   bool stereo = lovrCanvasIsStereo(canvas);
-  Shader* shader = state.shader ? state.shader : (state.defaultShaders[req->shader][stereo] ? state.defaultShaders[req->shader][stereo] : (state.defaultShaders[req->shader][stereo] = lovrShaderCreateDefault(req->shader, NULL, 0, stereo)));
+  Shader* shader = state.shader ? state.shader : lovrGraphicsGetDefaultShader(req->shader, stereo);
   Pipeline* pipeline = req->pipeline ? req->pipeline : &state.pipeline;
-  Material* material = req->material ? req->material : (state.defaultMaterial ? state.defaultMaterial : (state.defaultMaterial = lovrMaterialCreate()));
+  Material* material = req->material ? req->material : lovrGraphicsGetDefaultMaterial();
 
   if (!req->material) {
     if (req->type == BATCH_SKYBOX && lovrTextureGetType(req->texture) == TEXTURE_CUBE) {
-      lovrShaderSetTextures(shader, "lovrSkyboxTexture", &req->texture, 0, 1);
+      lovrShaderSetUniformById(shader, lovrShaderGetBuiltinUniformId(shader, BUILTIN_SKYBOX_TEXTURE), UNIFORM_SAMPLER, &req->texture, 0, 1);
     } else {
       lovrMaterialSetTexture(material, TEXTURE_DIFFUSE, req->texture);
     }
   }
 
-  if (lovrShaderHasUniform(shader, "lovrPose")) {
-    if (req->type == BATCH_MESH && req->params.mesh.pose) {
-      lovrShaderSetMatrices(shader, "lovrPose", req->params.mesh.pose, 0, MAX_BONES * 16);
-    } else {
-      lovrShaderSetMatrices(shader, "lovrPose", (float[]) MAT4_IDENTITY, 0, 16);
-    }
-  }
+  // Draws can't be reordered when blending is on or the depth test is off
+  bool ordered = pipeline->blendMode != BLEND_NONE || pipeline->depthTest == COMPARE_NONE;
+  uint64_t hash = hashBatch(req->type, &req->params, mesh, canvas, shader, material, pipeline);
 
-  // Try to find an existing batch to use
+  // Try to find an existing batch to use.  Instanced draws can join any batch with the same state
+  // recorded after the last ordered batch.  Streamed draws can only join the most recent batch,
+  // since the vertices of a batch must be contiguous.
   Batch* batch = NULL;
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (req->type == BATCH_MESH && req->params.mesh.instances > 1) { break; }
-
-    Batch* b = &state.batches[i];
-    if (b->type != req->type) { goto next; }
-    if (b->drawCount >= MAX_DRAWS) { goto next; }
-    if (b->draw.mesh != mesh) { goto next; }
-    if (b->draw.canvas != canvas) { goto next; }
-    if (b->draw.shader != shader) { goto next; }
-    if (b->material != material) { goto next; }
-    if (memcmp(&b->draw.pipeline, pipeline, sizeof(Pipeline))) { goto next; }
-    if (memcmp(&b->params, &req->params, sizeof(BatchParams))) { goto next; }
-    batch = b;
-    break;
-
-next:
-    // Draws can't be reordered when blending is on, depth test is off, or either of the batches
-    // are streaming their vertices (since the vertices of a batch must be contiguous)
-    if (b->draw.pipeline.blendMode != BLEND_NONE || pipeline->blendMode != BLEND_NONE) { break; }
-    if (b->draw.pipeline.depthTest == COMPARE_NONE || pipeline->depthTest == COMPARE_NONE) { break; }
-    if (!req->instanced) { break; }
+  if (state.batches.length > 0 && !(req->type == BATCH_MESH && req->params.mesh.instances > 1)) {
+    uint64_t index = map_get(&state.batchMap, hash);
+    bool last = index == state.batches.length - 1;
+    if (index != MAP_NIL && (last || (req->instanced && !ordered && index >= state.batchBarrier))) {
+      Batch* b = &state.batches.data[index];
+      uint32_t boneCount = getBoneCount(b);
+      if (
+        b->drawCount < state.maxDraws &&
+        (b->drawCount + 1) * boneCount <= state.maxBones &&
+        b->type == req->type &&
+        b->draw.mesh == mesh &&
+        b->draw.canvas == canvas &&
+        b->draw.shader == shader &&
+        b->material == material &&
+        !memcmp(&b->draw.pipeline, pipeline, sizeof(Pipeline)) &&
+        !memcmp(&b->params, &req->params, sizeof(BatchParams))
+      ) {
+        batch = b;
+      }
+    }
   }
 
   // The final draw id isn't known until the batch is fully resolved and all the potential flushes
   // have occurred, so we have to do this weird thing where we map the draw id buffer early on but
   // write the ids much later.
-  uint8_t* ids = NULL;
-
-  // Figure out if a flush is necessary before mapping buffers for vertex data or UBOs.
-  // - A flush is necessary if vertices are about to be written (during the first element of an
-  //   instanced batch or any element of a stream batch) and any of the ranges go past the end.
-  // - If a new batch is required but there isn't space for it, flush to make space.
-  // - If a new batch is required, make sure there is space for the matrix/color UBO streams.
-  // It's important to flush before mapping any streams, because flushing unmaps all streams.
+  uint16_t* ids = NULL;
+
+  // Figure out if a flush is necessary before mapping buffers for vertex data.  A flush is
+  // necessary if vertices are about to be written (during the first element of an instanced batch
+  // or any element of a stream batch) and any of the ranges go past the end.  It's important to
+  // flush before mapping any streams, because flushing unmaps all streams.  Transforms and colors
+  // are recorded on the CPU and uploaded during the flush, so they never need to flush here.
   bool needFlush = false;
   bool hasVertices = req->vertexCount > 0 && (!req->instanced || !batch);
   bool hasIndices = hasVertices && req->indexCount > 0;
-  needFlush = needFlush || (hasVertices && state.head[STREAM_VERTEX] + req->vertexCount > bufferCount[STREAM_VERTEX]);
-  needFlush = needFlush || (hasVertices && state.head[STREAM_DRAWID] + req->vertexCount > bufferCount[STREAM_DRAWID]);
-  needFlush = needFlush || (hasIndices && state.head[STREAM_INDEX] + req->indexCount > bufferCount[STREAM_INDEX]);
-  needFlush = needFlush || (!batch && state.batchCount >= MAX_BATCHES);
-  needFlush = needFlush || (!batch && state.head[STREAM_MODEL] + MAX_DRAWS > bufferCount[STREAM_MODEL]);
-  needFlush = needFlush || (!batch && state.head[STREAM_COLOR] + MAX_DRAWS > bufferCount[STREAM_COLOR]);
+
+  // Vertices that can't be addressed with 16 bit indices use the 32 bit index stream.  The vertex
+  // stream starts over at zero when it fills up, so that needs to be taken into account here.
+  bool vertexReset = state.head[STREAM_VERTEX] + req->vertexCount > state.bufferCount[STREAM_VERTEX];
+  uint32_t vertexStart = vertexReset ? 0 : state.head[STREAM_VERTEX];
+  bool wideIndices = hasIndices && vertexStart + req->vertexCount > MAX_SHORT_VERTICES;
+  StreamType indexStream = wideIndices ? STREAM_INDEX32 : STREAM_INDEX;
+  lovrAssert(!wideIndices || state.bufferCount[STREAM_INDEX32] > 0, "Unreachable");
+
+  if (batch && hasIndices && batch->wideIndices != wideIndices) {
+    batch = NULL;
+  }
+
+  needFlush = needFlush || (hasVertices && state.head[STREAM_VERTEX] + req->vertexCount > state.bufferCount[STREAM_VERTEX]);
+  needFlush = needFlush || (hasVertices && state.head[STREAM_DRAWID] + req->vertexCount > state.bufferCount[STREAM_DRAWID]);
+  needFlush = needFlush || (hasIndices && state.head[indexStream] + req->indexCount > state.bufferCount[indexStream]);
   if (needFlush) lovrGraphicsFlush();
 
   if (req->vertexCount > 0 && (!req->instanced || !batch)) {
@@ -665,28 +986,32 @@ next:
     ids = lovrGraphicsMapBuffer(STREAM_DRAWID, req->vertexCount);
 
     if (req->indexCount > 0) {
-      *(req->indices) = lovrGraphicsMapBuffer(STREAM_INDEX, req->indexCount);
+      *(req->indices) = lovrGraphicsMapBuffer(indexStream, req->indexCount);
       *(req->baseVertex) = state.head[STREAM_VERTEX];
+      *(req->wideIndices) = wideIndices;
     }
   }
 
   // Start a new batch
-  if (!batch || state.batchCount == 0) {
-    float* transforms = lovrGraphicsMapBuffer(STREAM_MODEL, MAX_DRAWS);
-    Color* colors = lovrGraphicsMapBuffer(STREAM_COLOR, MAX_DRAWS);
-
+  if (!batch || state.batches.length == 0) {
     uint32_t rangeStart, rangeCount, instances;
     if (req->type == BATCH_MESH) {
       rangeStart = req->params.mesh.rangeStart;
       rangeCount = req->params.mesh.rangeCount;
       instances = req->instanced ? 0 : req->params.mesh.instances;
+    } else if (req->mesh) {
+      rangeStart = 0;
+      rangeCount = lovrMeshGetIndexCount(mesh);
+      rangeCount = rangeCount > 0 ? rangeCount : lovrMeshGetVertexCount(mesh);
+      instances = 0;
     } else {
-      rangeStart = req->indexCount > 0 ? state.head[STREAM_INDEX] : state.head[STREAM_VERTEX];
+      rangeStart = req->indexCount > 0 ? state.head[indexStream] : state.head[STREAM_VERTEX];
       rangeCount = 0;
       instances = 0;
     }
 
-    batch = &state.batches[state.batchCount++];
+    arr_expand(&state.batches, 1);
+    batch = &state.batches.data[state.batches.length++];
     *batch = (Batch) {
       .type = req->type,
       .params = req->params,
@@ -700,39 +1025,53 @@ next:
         .rangeCount = rangeCount,
         .instances = instances
       },
+      .defaultShader = state.shader ? MAX_DEFAULT_SHADERS : req->shader,
       .material = material,
-      .transforms = transforms,
-      .colors = colors,
-      .drawStart = state.head[STREAM_MODEL],
-      .indexed = req->indexCount > 0
+      .sortKey = packSortKey(canvas, shader, pipeline, material, mesh),
+      .drawStart = ~0u,
+      .indexed = req->indexCount > 0,
+      .wideIndices = wideIndices,
+      .ordered = ordered
     };
 
-    state.head[STREAM_MODEL] += MAX_DRAWS;
-    state.head[STREAM_COLOR] += MAX_DRAWS;
+    map_set(&state.batchMap, hash, state.batches.length - 1);
+
+    if (ordered) {
+      state.batchBarrier = state.batches.length;
+    }
+  }
+
+  // Transform and color
+  arr_expand(&state.draws, 1);
+  DrawData* draw = &state.draws.data[state.draws.length++];
+  draw->batch = (uint32_t) (batch - state.batches.data);
+  draw->color = state.linearColor;
+  draw->pose = ~0u;
+
+  if (req->pose) {
+    uint32_t count = 16 * req->params.mesh.boneCount;
+    draw->pose = (uint32_t) state.poses.length;
+    arr_append(&state.poses, req->pose, count);
   }
 
-  // Transform
   if (req->transform) {
-    float transform[16];
-    mat4_mul(mat4_init(transform, state.transforms[state.transform]), req->transform);
-    memcpy(&batch->transforms[16 * batch->drawCount], transform, 16 * sizeof(float));
+    mat4_mul(mat4_init(draw->transform, state.transforms[state.transform]), req->transform);
   } else {
-    memcpy(&batch->transforms[16 * batch->drawCount], state.transforms[state.transform], 16 * sizeof(float));
+    mat4_init(draw->transform, state.transforms[state.transform]);
   }
 
-  // Color
-  batch->colors[batch->drawCount] = state.linearColor;
-
   // Cursors
   if (!req->instanced || batch->drawCount == 0) {
     if (ids) {
-      memset(ids, batch->drawCount, req->vertexCount * sizeof(uint8_t));
+      for (uint32_t i = 0; i < req->vertexCount; i++) {
+        ids[i] = (uint16_t) batch->drawCount;
+      }
     }
 
     batch->draw.rangeCount += batch->indexed ? req->indexCount : req->vertexCount;
     state.head[STREAM_VERTEX] += req->vertexCount;
     state.head[STREAM_DRAWID] += req->vertexCount;
-    state.head[STREAM_INDEX] += req->indexCount;
+    state.head[indexStream] += req->indexCount;
   }
 
   if (req->instanced) {
@@ -742,70 +1081,185 @@ next:
   batch->drawCount++;
 }
 
-void lovrGraphicsFlush() {
-  if (state.batchCount == 0) {
-    return;
-  }
-
-  // Prevent infinite flushing >_>
-  int batchCount = state.batchCount;
-  state.batchCount = 0;
-
+static void lovrGraphicsUpdateFrameData() {
   if (state.frameDataDirty) {
     state.frameDataDirty = false;
     void* data = lovrGraphicsMapBuffer(STREAM_FRAME, 1);
     memcpy(data, &state.frameData, sizeof(FrameData));
     state.head[STREAM_FRAME]++;
   }
+}
 
-  // Flush buffers
-  for (int i = 0; i < MAX_STREAMS; i++) {
-    lovrBufferFlush(state.buffers[i], state.tail[i] * bufferStride[i], (state.head[i] - state.tail[i]) * bufferStride[i]);
-    lovrBufferUnmap(state.buffers[i]);
-    state.tail[i] = state.head[i];
-  }
-
-  for (int b = 0; b < batchCount; b++) {
-    Batch* batch = &state.batches[b];
-
-    // Uniforms
-    lovrMaterialBind(batch->material, batch->draw.shader);
-    lovrShaderSetBlock(batch->draw.shader, "lovrModelBlock", state.buffers[STREAM_MODEL], batch->drawStart * bufferStride[STREAM_MODEL], MAX_DRAWS * bufferStride[STREAM_MODEL], ACCESS_READ);
-    lovrShaderSetBlock(batch->draw.shader, "lovrColorBlock", state.buffers[STREAM_COLOR], batch->drawStart * bufferStride[STREAM_COLOR], MAX_DRAWS * bufferStride[STREAM_COLOR], ACCESS_READ);
-    lovrShaderSetBlock(batch->draw.shader, "lovrFrameBlock", state.buffers[STREAM_FRAME], (state.head[STREAM_FRAME] - 1) * bufferStride[STREAM_FRAME], bufferStride[STREAM_FRAME], ACCESS_READ);
-    if (batch->type == BATCH_TEXT) {
-      Texture* texture = lovrMaterialGetTexture(batch->material, TEXTURE_DIFFUSE);
-      uint32_t width = lovrTextureGetWidth(texture, 0);
-      uint32_t height = lovrTextureGetHeight(texture, 0);
-      float range[2] = { batch->params.text.spread / width, batch->params.text.spread / height };
-      lovrShaderSetFloats(batch->draw.shader, "lovrSdfRange", range, 0, 2);
-    }
-    if (batch->draw.topology == DRAW_POINTS) {
-      lovrShaderSetFloats(batch->draw.shader, "lovrPointSize", &state.pointSize, 0, 1);
+static void lovrGraphicsFlushStreams() {
+  for (int s = 0; s < MAX_STREAMS; s++) {
+    if (!state.buffers[s]) continue;
+    lovrBufferFlush(state.buffers[s], state.tail[s] * bufferStride[s], (state.head[s] - state.tail[s]) * bufferStride[s]);
+    lovrBufferUnmap(state.buffers[s]);
+    state.tail[s] = state.head[s];
+  }
+}
+
+// Draws a resolved batch.  The transform/color blocks and the index buffer for streamed geometry
+// come from the buffers passed in, which are either the streams or the buffers of a DrawList.
+static void lovrGraphicsDrawBatch(Batch* batch, Buffer** buffers, const uint32_t* bufferCount, Mesh* mesh, Mesh* instancedMesh) {
+
+  // Uniforms
+  Shader* shader = batch->draw.shader;
+  lovrMaterialBind(batch->material, shader);
+  uint32_t blockSize = getDrawBlockSize(batch);
+  lovrShaderSetBlockById(shader, lovrShaderGetBuiltinBlockId(shader, BUILTIN_MODEL_BLOCK), buffers[STREAM_MODEL], batch->drawStart * bufferStride[STREAM_MODEL], blockSize * bufferStride[STREAM_MODEL], ACCESS_READ);
+  lovrShaderSetBlockById(shader, lovrShaderGetBuiltinBlockId(shader, BUILTIN_COLOR_BLOCK), buffers[STREAM_COLOR], batch->drawStart * bufferStride[STREAM_COLOR], blockSize * bufferStride[STREAM_COLOR], ACCESS_READ);
+  lovrShaderSetBlockById(shader, lovrShaderGetBuiltinBlockId(shader, BUILTIN_FRAME_BLOCK), state.buffers[STREAM_FRAME], (state.head[STREAM_FRAME] - 1) * bufferStride[STREAM_FRAME], bufferStride[STREAM_FRAME], ACCESS_READ);
+  int poseBlock = lovrShaderGetBuiltinBlockId(shader, BUILTIN_POSE_BLOCK);
+  if (poseBlock >= 0) {
+    Buffer* poses = buffers[STREAM_POSE] ? buffers[STREAM_POSE] : state.buffers[STREAM_POSE];
+    lovrShaderSetBlockById(shader, poseBlock, poses, batch->poseStart * bufferStride[STREAM_POSE], getPoseBlockSize(batch) * bufferStride[STREAM_POSE], ACCESS_READ);
+    lovrShaderSetUniformById(shader, lovrShaderGetBuiltinUniformId(shader, BUILTIN_POSE_COUNT), UNIFORM_INT, &(int) { getBoneCount(batch) }, 0, 1);
+  }
+  if (batch->type == BATCH_TEXT) {
+    Texture* texture = lovrMaterialGetTexture(batch->material, TEXTURE_DIFFUSE);
+    uint32_t width = lovrTextureGetWidth(texture, 0);
+    uint32_t height = lovrTextureGetHeight(texture, 0);
+    float range[2] = { batch->params.text.spread / width, batch->params.text.spread / height };
+    lovrShaderSetUniformById(shader, lovrShaderGetBuiltinUniformId(shader, BUILTIN_SDF_RANGE), UNIFORM_FLOAT, range, 0, 2);
+  }
+  if (batch->draw.topology == DRAW_POINTS) {
+    lovrShaderSetUniformById(shader, lovrShaderGetBuiltinUniformId(shader, BUILTIN_POINT_SIZE), UNIFORM_FLOAT, &state.pointSize, 0, 1);
+  }
+
+  // Other bindings (TODO try to get rid of all this!)
+  if (batch->type == BATCH_MESH) {
+    lovrMeshSetAttributeEnabled(batch->draw.mesh, "lovrDrawID", batch->params.mesh.instances <= 1);
+  } else if (batch->draw.mesh == mesh || batch->draw.mesh == instancedMesh) {
+    if (batch->draw.mesh == instancedMesh && batch->draw.instances <= 1) {
+      batch->draw.mesh = mesh;
     }
 
-    // Other bindings (TODO try to get rid of all this!)
-    if (batch->type == BATCH_MESH) {
-      lovrMeshSetAttributeEnabled(batch->draw.mesh, "lovrDrawID", batch->params.mesh.instances <= 1);
+    if (batch->indexed) {
+      StreamType stream = batch->wideIndices ? STREAM_INDEX32 : STREAM_INDEX;
+      lovrMeshSetIndexBuffer(batch->draw.mesh, buffers[stream], bufferCount[stream], bufferStride[stream], 0);
     } else {
-      if (batch->draw.mesh == state.instancedMesh && batch->draw.instances <= 1) {
-        batch->draw.mesh = state.mesh;
+      lovrMeshSetIndexBuffer(batch->draw.mesh, NULL, 0, 0, 0);
+    }
+  }
+
+  lovrGpuDraw(&batch->draw);
+}
+
+static void lovrGraphicsCapture(DrawList* list, Batch* batches, uint32_t* order, uint32_t batchCount);
+
+void lovrGraphicsFlush() {
+  if (state.batches.length == 0) {
+    return;
+  }
+
+  // Prevent infinite flushing >_>
+  Batch* batches = state.batches.data;
+  uint32_t batchCount = (uint32_t) state.batches.length;
+  arr_clear(&state.batches);
+  state.batchBarrier = 0;
+  map_clear(&state.batchMap);
+
+  // Sort each run of unordered batches by state, ordered batches stay where they were submitted
+  arr_reserve(&state.batchOrder, batchCount);
+  uint32_t* order = state.batchOrder.data;
+  for (uint32_t i = 0; i < batchCount; i++) {
+    order[i] = i;
+  }
+
+  for (uint32_t i = 0; i < batchCount; i++) {
+    uint32_t j = i;
+    while (j < batchCount && !batches[j].ordered) j++;
+    if (j - i > 1) qsort(order + i, j - i, sizeof(uint32_t), compareBatches);
+    i = j;
+  }
+
+  if (state.drawList) {
+    lovrGraphicsCapture(state.drawList, batches, order, batchCount);
+    arr_clear(&state.draws);
+    arr_clear(&state.poses);
+    return;
+  }
+
+  lovrGraphicsUpdateFrameData();
+
+  // Each batch gets a block of the transform/color streams big enough for its draws.  Blocks are
+  // aligned so they can be bound as buffer ranges.  Uniform blocks always bind a full MAX_DRAWS
+  // range, so that much space needs to be left at the end of the stream.  Skinned batches get a
+  // block of the pose stream the same way.
+  uint32_t align = MAX(lovrGpuGetLimits()->blockAlign / (uint32_t) bufferStride[STREAM_COLOR], 1);
+  uint32_t poseAlign = MAX(lovrGpuGetLimits()->blockAlign / (uint32_t) bufferStride[STREAM_POSE], 1);
+
+  for (uint32_t i = 0; i < batchCount;) {
+    float* transforms = lovrGraphicsMapBuffer(STREAM_MODEL, getDrawBlockSize(&batches[order[i]]));
+    Color* colors = lovrGraphicsMapBuffer(STREAM_COLOR, getDrawBlockSize(&batches[order[i]]));
+    float* poses = state.poses.length > 0 ? lovrGraphicsMapBuffer(STREAM_POSE, getPoseBlockSize(&batches[order[i]])) : NULL;
+    uint32_t base = state.head[STREAM_MODEL];
+    uint32_t colorBase = state.head[STREAM_COLOR];
+    uint32_t poseBase = state.head[STREAM_POSE];
+
+    uint32_t end = i;
+    while (end < batchCount && state.head[STREAM_MODEL] + getDrawBlockSize(&batches[order[end]]) <= state.bufferCount[STREAM_MODEL]) {
+      Batch* batch = &batches[order[end]];
+      uint32_t poseCount = batch->drawCount * getBoneCount(batch);
+
+      if (poseCount > 0 && (!poses || state.head[STREAM_POSE] + getPoseBlockSize(batch) > state.bufferCount[STREAM_POSE])) {
+        break;
       }
 
-      if (batch->indexed) {
-        lovrMeshSetIndexBuffer(batch->draw.mesh, state.buffers[STREAM_INDEX], bufferCount[STREAM_INDEX], sizeof(uint16_t), 0);
-      } else {
-        lovrMeshSetIndexBuffer(batch->draw.mesh, NULL, 0, 0, 0);
+      batch->drawStart = state.head[STREAM_MODEL];
+      batch->poseStart = poseCount > 0 ? state.head[STREAM_POSE] : 0;
+      batch->cursor = 0;
+      state.head[STREAM_MODEL] += (batch->drawCount + align - 1) / align * align;
+      state.head[STREAM_COLOR] = state.head[STREAM_MODEL];
+      state.head[STREAM_POSE] += (poseCount + poseAlign - 1) / poseAlign * poseAlign;
+      end++;
+    }
+
+    // Mapping only waited for the first batch's block, the rest may reach into more regions
+    waitRegions(STREAM_MODEL, base, state.head[STREAM_MODEL]);
+    waitRegions(STREAM_COLOR, colorBase, state.head[STREAM_COLOR]);
+    if (poses) {
+      waitRegions(STREAM_POSE, poseBase, state.head[STREAM_POSE]);
+    }
+
+    for (size_t d = 0; d < state.draws.length; d++) {
+      DrawData* draw = &state.draws.data[d];
+      Batch* batch = &batches[draw->batch];
+      if (batch->drawStart >= base && batch->drawStart < state.head[STREAM_MODEL] && batch->cursor < batch->drawCount) {
+        uint32_t index = batch->cursor++;
+        uint32_t slot = batch->drawStart - base + index;
+        memcpy(transforms + 16 * slot, draw->transform, 16 * sizeof(float));
+        colors[slot] = draw->color;
+
+        if (draw->pose != ~0u) {
+          uint32_t boneCount = getBoneCount(batch);
+          float* pose = poses + 16 * (batch->poseStart - poseBase + index * boneCount);
+          memcpy(pose, state.poses.data + draw->pose, 16 * boneCount * sizeof(float));
+        }
       }
     }
 
-    lovrGpuDraw(&batch->draw);
+    lovrGraphicsFlushStreams();
+
+    for (; i < end; i++) {
+      lovrGraphicsDrawBatch(&batches[order[i]], state.buffers, state.bufferCount, state.mesh, state.instancedMesh);
+    }
+
+    for (int s = 0; s < MAX_STREAMS; s++) {
+      if (state.persistent[s]) {
+        fenceRegions(s, state.head[s]);
+      }
+    }
   }
+
+  arr_clear(&state.draws);
+  arr_clear(&state.poses);
 }
 
 void lovrGraphicsFlushCanvas(Canvas* canvas) {
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (state.batches[i].draw.canvas == canvas) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    if (state.batches.data[i].draw.canvas == canvas) {
       lovrGraphicsFlush();
       return;
     }
@@ -813,8 +1267,8 @@ void lovrGraphicsFlushCanvas(Canvas* canvas) {
 }
 
 void lovrGraphicsFlushShader(Shader* shader) {
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (state.batches[i].draw.shader == shader) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    if (state.batches.data[i].draw.shader == shader) {
       lovrGraphicsFlush();
       return;
     }
@@ -822,8 +1276,8 @@ void lovrGraphicsFlushShader(Shader* shader) {
 }
 
 void lovrGraphicsFlushMaterial(Material* material) {
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (state.batches[i].material == material) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    if (state.batches.data[i].material == material) {
       lovrGraphicsFlush();
       return;
     }
@@ -831,8 +1285,8 @@ void lovrGraphicsFlushMaterial(Material* material) {
 }
 
 void lovrGraphicsFlushMesh(Mesh* mesh) {
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (state.batches[i].draw.mesh == mesh) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    if (state.batches.data[i].draw.mesh == mesh) {
       lovrGraphicsFlush();
       return;
     }
@@ -840,6 +1294,7 @@ void lovrGraphicsFlushMesh(Mesh* mesh) {
 }
 
 void lovrGraphicsClear(Color* color, float* depth, int* stencil) {
+  lovrAssert(!state.drawList || !(color || depth || stencil), "DrawLists can not record clears");
 #if !defined(LOVR_WEBGL) && !defined(LOVR_USE_PICO)
   if (color) gammaCorrect(color);
 #endif
@@ -848,10 +1303,28 @@ void lovrGraphicsClear(Color* color, float* depth, int* stencil) {
 }
 
 void lovrGraphicsDiscard(bool color, bool depth, bool stencil) {
+  lovrAssert(!state.drawList || !(color || depth || stencil), "DrawLists can not record discards");
   if (color || depth || stencil) lovrGraphicsFlush();
   lovrGpuDiscard(state.canvas ? state.canvas : state.backbuffer, color, depth, stencil);
 }
 
+// Writes indices relative to the base vertex into a 16 or 32 bit index stream, advancing the cursor
+static void writeIndices(void** cursor, bool wide, const uint32_t* data, uint32_t count, uint32_t base) {
+  if (wide) {
+    uint32_t* indices = *cursor;
+    for (uint32_t i = 0; i < count; i++) {
+      indices[i] = data[i] == RESTART_INDEX ? RESTART_INDEX : data[i] + base;
+    }
+    *cursor = indices + count;
+  } else {
+    uint16_t* indices = *cursor;
+    for (uint32_t i = 0; i < count; i++) {
+      indices[i] = data[i] == RESTART_INDEX ? 0xffff : (uint16_t) (data[i] + base);
+    }
+    *cursor = indices + count;
+  }
+}
+
 void lovrGraphicsPoints(uint32_t count, float** vertices) {
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_POINTS,
@@ -863,8 +1336,9 @@ void lovrGraphicsPoints(uint32_t count, float** vertices) {
 
 void lovrGraphicsLine(uint32_t count, float** vertices) {
   uint32_t indexCount = count + 1;
-  uint16_t* indices;
-  uint16_t baseVertex;
+  void* indices;
+  uint32_t baseVertex;
+  bool wideIndices;
 
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_LINES,
@@ -873,19 +1347,21 @@ void lovrGraphicsLine(uint32_t count, float** vertices) {
     .vertices = vertices,
     .indexCount = indexCount,
     .indices = &indices,
-    .baseVertex = &baseVertex
+    .baseVertex = &baseVertex,
+    .wideIndices = &wideIndices
   });
 
-  indices[0] = 0xffff;
-  for (uint32_t i = 1; i < indexCount; i++) {
-    indices[i] = baseVertex + i - 1;
+  writeIndices(&indices, wideIndices, &(uint32_t) { RESTART_INDEX }, 1, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    writeIndices(&indices, wideIndices, &i, 1, baseVertex);
   }
 }
 
 void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, float u, float v, float w, float h) {
   float* vertices = NULL;
-  uint16_t* indices = NULL;
-  uint16_t baseVertex;
+  void* indices = NULL;
+  uint32_t baseVertex;
+  bool wideIndices;
 
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_PLANE,
@@ -897,7 +1373,8 @@ void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, floa
     .indexCount = style == STYLE_LINE ? 5 : 6,
     .vertices = &vertices,
     .indices = &indices,
-    .baseVertex = &baseVertex
+    .baseVertex = &baseVertex,
+    .wideIndices = &wideIndices
   });
 
   if (style == STYLE_LINE) {
@@ -910,11 +1387,8 @@ void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, floa
 
     memcpy(vertices, vertexData, sizeof(vertexData));
 
-    indices[0] = 0xffff;
-    indices[1] = 0 + baseVertex;
-    indices[2] = 1 + baseVertex;
-    indices[3] = 2 + baseVertex;
-    indices[4] = 3 + baseVertex;
+    static uint32_t indexData[] = { RESTART_INDEX, 0, 1, 2, 3 };
+    writeIndices(&indices, wideIndices, indexData, sizeof(indexData) / sizeof(indexData[0]), baseVertex);
   } else {
     float vertexData[] = {
       -.5f,  .5f, 0.f, 0.f, 0.f, -1.f, u, v + h,
@@ -925,20 +1399,321 @@ void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, floa
 
     memcpy(vertices, vertexData, sizeof(vertexData));
 
-    static uint16_t indexData[] = { 0, 1, 2, 2, 1, 3 };
+    static uint32_t indexData[] = { 0, 1, 2, 2, 1, 3 };
+    writeIndices(&indices, wideIndices, indexData, sizeof(indexData) / sizeof(indexData[0]), baseVertex);
+  }
+}
+
+static void tessellateBox(const BatchParams* params, float* vertices, void* indices, bool wideIndices, uint32_t baseVertex) {
+  if (params->box.style == STYLE_LINE) {
+    static float vertexData[] = {
+      -.5f,  .5f, -.5f, 0.f, 0.f, 0.f, 0.f, 0.f, // Front
+       .5f,  .5f, -.5f, 0.f, 0.f, 0.f, 0.f, 0.f,
+       .5f, -.5f, -.5f, 0.f, 0.f, 0.f, 0.f, 0.f,
+      -.5f, -.5f, -.5f, 0.f, 0.f, 0.f, 0.f, 0.f,
+      -.5f,  .5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f, // Back
+       .5f,  .5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f,
+       .5f, -.5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f,
+      -.5f, -.5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f
+    };
+
+    memcpy(vertices, vertexData, sizeof(vertexData));
+
+    static uint32_t indexData[] = {
+      0, 1, 1, 2, 2, 3, 3, 0, // Front
+      4, 5, 5, 6, 6, 7, 7, 4, // Back
+      0, 4, 1, 5, 2, 6, 3, 7  // Connections
+    };
+
+    writeIndices(&indices, wideIndices, indexData, sizeof(indexData) / sizeof(indexData[0]), baseVertex);
+  } else {
+    static float vertexData[] = {
+      -.5f, -.5f, -.5f,  0.f,  0.f, -1.f, 0.f, 0.f, // Front
+      -.5f,  .5f, -.5f,  0.f,  0.f, -1.f, 0.f, 1.f,
+       .5f, -.5f, -.5f,  0.f,  0.f, -1.f, 1.f, 0.f,
+       .5f,  .5f, -.5f,  0.f,  0.f, -1.f, 1.f, 1.f,
+       .5f,  .5f, -.5f,  1.f,  0.f,  0.f, 0.f, 1.f, // Right
+       .5f,  .5f,  .5f,  1.f,  0.f,  0.f, 1.f, 1.f,
+       .5f, -.5f, -.5f,  1.f,  0.f,  0.f, 0.f, 0.f,
+       .5f, -.5f,  .5f,  1.f,  0.f,  0.f, 1.f, 0.f,
+       .5f, -.5f,  .5f,  0.f,  0.f,  1.f, 0.f, 0.f, // Back
+       .5f,  .5f,  .5f,  0.f,  0.f,  1.f, 0.f, 1.f,
+      -.5f, -.5f,  .5f,  0.f,  0.f,  1.f, 1.f, 0.f,
+      -.5f,  .5f,  .5f,  0.f,  0.f,  1.f, 1.f, 1.f,
+      -.5f,  .5f,  .5f, -1.f,  0.f,  0.f, 0.f, 1.f, // Left
+      -.5f,  .5f, -.5f, -1.f,  0.f,  0.f, 1.f, 1.f,
+      -.5f, -.5f,  .5f, -1.f,  0.f,  0.f, 0.f, 0.f,
+      -.5f, -.5f, -.5f, -1.f,  0.f,  0.f, 1.f, 0.f,
+      -.5f, -.5f, -.5f,  0.f, -1.f,  0.f, 0.f, 0.f, // Bottom
+       .5f, -.5f, -.5f,  0.f, -1.f,  0.f, 1.f, 0.f,
+      -.5f, -.5f,  .5f,  0.f, -1.f,  0.f, 0.f, 1.f,
+       .5f, -.5f,  .5f,  0.f, -1.f,  0.f, 1.f, 1.f,
+      -.5f,  .5f, -.5f,  0.f,  1.f,  0.f, 0.f, 1.f, // Top
+      -.5f,  .5f,  .5f,  0.f,  1.f,  0.f, 0.f, 0.f,
+       .5f,  .5f, -.5f,  0.f,  1.f,  0.f, 1.f, 1.f,
+       .5f,  .5f,  .5f,  0.f,  1.f,  0.f, 1.f, 0.f
+    };
+
+    memcpy(vertices, vertexData, sizeof(vertexData));
+
+    static uint32_t indexData[] = {
+      0,  1,   2,  2,  1,  3,
+      4,  5,   6,  6,  5,  7,
+      8,  9,  10, 10,  9, 11,
+      12, 13, 14, 14, 13, 15,
+      16, 17, 18, 18, 17, 19,
+      20, 21, 22, 22, 21, 23
+    };
+
+    writeIndices(&indices, wideIndices, indexData, sizeof(indexData) / sizeof(indexData[0]), baseVertex);
+  }
+}
+
+static void tessellateArc(const BatchParams* params, float* vertices, void* indices, bool wideIndices, uint32_t baseVertex) {
+  float r1 = params->arc.r1;
+  float r2 = params->arc.r2;
+  int segments = params->arc.segments;
+
+  if (params->arc.mode == ARC_MODE_PIE && fabsf(r1 - r2) < 2.f * (float) M_PI) {
+    memcpy(vertices, ((float[]) { 0.f, 0.f, 0.f, 0.f, 0.f, 1.f, .5f, .5f }), 8 * sizeof(float));
+    vertices += 8;
+  }
+
+  float theta = r1;
+  float angleShift = (r2 - r1) / (float) segments;
+
+  for (int i = 0; i <= segments; i++) {
+    float x = cosf(theta);
+    float y = sinf(theta);
+    memcpy(vertices, ((float[]) { x, y, 0.f, 0.f, 0.f, 1.f, x + .5f, 1.f - (y + .5f) }), 8 * sizeof(float));
+    vertices += 8;
+    theta += angleShift;
+  }
+}
+
+static void tessellateCylinder(const BatchParams* params, float* vertices, void* indices, bool wideIndices, uint32_t baseVertex) {
+  float r1 = params->cylinder.r1;
+  float r2 = params->cylinder.r2;
+  bool capped = params->cylinder.capped;
+  int segments = params->cylinder.segments;
+  float* v = vertices;
+
+  // Ring
+  for (int i = 0; i <= segments; i++) {
+    float t = (float) i / segments;
+    float theta = t * (2 * M_PI);
+    float X = cosf(theta);
+    float Y = sinf(theta);
+    memcpy(vertices, (float[16]) {
+      r1 * X, r1 * Y, -.5f, X, Y, 0.f, 1.f - t, 1.f,
+      r2 * X, r2 * Y,  .5f, X, Y, 0.f, 1.f - t, 0.f
+    }, 16 * sizeof(float));
+    vertices += 16;
+  }
+
+  // Top
+  uint32_t top = (segments + 1) * 2;
+  if (capped && r1 != 0) {
+    memcpy(vertices, (float[8]) { 0.f, 0.f, -.5f, 0.f, 0.f, -1.f, .5f, .5f }, 8 * sizeof(float));
+    vertices += 8;
+    for (int i = 0; i <= segments; i++) {
+      int j = i * 2 * 8;
+      float x = v[j + 0];
+      float y = v[j + 1];
+      float z = v[j + 2];
+      float u = 1.f - (x / r1 * .5 + .5);
+      float v = y / r1 * .5 + .5;
+      memcpy(vertices, (float[8]) { x, y, z, 0.f, 0.f, -1.f, u, v }, 8 * sizeof(float));
+      vertices += 8;
+    }
+  }
 
-    for (size_t i = 0; i < sizeof(indexData) / sizeof(indexData[0]); i++) {
-      indices[i] = indexData[i] + baseVertex;
+  // Bottom
+  uint32_t bot = (segments + 1) * 2 + (1 + segments + 1) * (capped && r1 != 0);
+  if (capped && r2 != 0) {
+    memcpy(vertices, (float[8]) { 0.f, 0.f, .5f, 0.f, 0.f, 1.f, .5f, .5f }, 8 * sizeof(float));
+    vertices += 8;
+    for (int i = 0; i <= segments; i++) {
+      int j = i * 2 * 8 + 8;
+      float x = v[j + 0];
+      float y = v[j + 1];
+      float z = v[j + 2];
+      float u = x / r1 * .5 + .5;
+      float v = y / r1 * .5 + .5;
+      memcpy(vertices, (float[8]) { x, y, z, 0.f, 0.f, 1.f, u, v }, 8 * sizeof(float));
+      vertices += 8;
+    }
+  }
+
+  // Indices
+  for (uint32_t i = 0; i < (uint32_t) segments; i++) {
+    uint32_t j = 2 * i;
+    writeIndices(&indices, wideIndices, (uint32_t[6]) { j, j + 2, j + 1, j + 1, j + 2, j + 3 }, 6, baseVertex);
+
+    if (capped && r1 != 0.f) {
+      writeIndices(&indices, wideIndices, (uint32_t[3]) { top, top + i + 2, top + i + 1 }, 3, baseVertex);
+    }
+
+    if (capped && r2 != 0.f) {
+      writeIndices(&indices, wideIndices, (uint32_t[3]) { bot, bot + i + 1, bot + i + 2 }, 3, baseVertex);
     }
   }
 }
 
-void lovrGraphicsBox(DrawStyle style, Material* material, mat4 transform) {
+static void tessellateSphere(const BatchParams* params, float* vertices, void* indices, bool wideIndices, uint32_t baseVertex) {
+  int segments = params->sphere.segments;
+
+  for (int i = 0; i <= segments; i++) {
+    float v = i / (float) segments;
+    float sinV = sinf(v * (float) M_PI);
+    float cosV = cosf(v * (float) M_PI);
+    for (int k = 0; k <= segments; k++) {
+      float u = k / (float) segments;
+      float x = sinf(u * 2.f * (float) M_PI) * sinV;
+      float y = cosV;
+      float z = -cosf(u * 2.f * (float) M_PI) * sinV;
+      memcpy(vertices, ((float[8]) { x, y, z, x, y, z, u, 1.f - v }), 8 * sizeof(float));
+      vertices += 8;
+    }
+  }
+
+  for (int i = 0; i < segments; i++) {
+    uint32_t offset0 = i * (segments + 1);
+    uint32_t offset1 = (i + 1) * (segments + 1);
+    for (int j = 0; j < segments; j++) {
+      uint32_t i0 = offset0 + j;
+      uint32_t i1 = offset1 + j;
+      writeIndices(&indices, wideIndices, (uint32_t[6]) { i0, i0 + 1, i1, i1, i0 + 1, i1 + 1 }, 6, baseVertex);
+    }
+  }
+}
+
+static uint64_t hashShape(BatchType type, BatchParams* params) {
+  struct {
+    BatchParams params;
+    BatchType type;
+  } key;
+
+  memset(&key, 0, sizeof(key));
+  memcpy(&key.params, params, sizeof(BatchParams));
+  key.type = type;
+  return hash64(&key, sizeof(key));
+}
+
+static void lovrGraphicsClearShapes() {
+  for (size_t i = 0; i < state.shapes.length; i++) {
+    lovrRelease(state.shapes.data[i].mesh, lovrMeshDestroy);
+  }
+  arr_clear(&state.shapes);
+  map_free(&state.shapeMap);
+  map_init(&state.shapeMap, 64);
+}
+
+// Primitives are tessellated once into static buffers and drawn with instancing after that.  A
+// shape is only cached the second time it's seen, so shapes with parameters that change every
+// frame (e.g. an animated arc) keep streaming their vertices instead of creating new buffers.
+static Mesh* lovrGraphicsGetShape(BatchRequest* req, ShapeTessellator* tessellate) {
+  uint64_t hash = hashShape(req->type, &req->params);
+  uint64_t index = map_get(&state.shapeMap, hash);
+
+  if (index == MAP_NIL) {
+    // Forget about shapes that were only seen once, keeping the ones that were cached
+    if (state.shapeMap.used >= MAX_SHAPE_KEYS) {
+      map_free(&state.shapeMap);
+      map_init(&state.shapeMap, 64);
+      for (size_t i = 0; i < state.shapes.length; i++) {
+        map_set(&state.shapeMap, state.shapes.data[i].hash, i);
+      }
+    }
+
+    map_set(&state.shapeMap, hash, SHAPE_SEEN);
+    return NULL;
+  } else if (index != SHAPE_SEEN) {
+    Shape* shape = &state.shapes.data[index];
+    bool match = shape->type == req->type && !memcmp(&shape->params, &req->params, sizeof(BatchParams));
+    return match ? shape->mesh : NULL;
+  }
+
+  if (state.shapes.length >= MAX_SHAPES) {
+    lovrGraphicsFlush();
+    lovrGraphicsClearShapes();
+  }
+
+  uint32_t vertexCount = req->vertexCount;
+  uint32_t indexCount = req->indexCount;
+  bool wideIndices = vertexCount > MAX_SHORT_VERTICES;
+  size_t indexSize = wideIndices ? sizeof(uint32_t) : sizeof(uint16_t);
+  size_t stride = bufferStride[STREAM_VERTEX];
+
+  Buffer* vertexBuffer = lovrBufferCreate(vertexCount * stride, NULL, BUFFER_VERTEX, USAGE_STATIC, false);
+  Buffer* indexBuffer = indexCount > 0 ? lovrBufferCreate(indexCount * indexSize, NULL, BUFFER_INDEX, USAGE_STATIC, false) : NULL;
+  float* vertices = lovrBufferMap(vertexBuffer, 0, true);
+  void* indices = indexBuffer ? lovrBufferMap(indexBuffer, 0, true) : NULL;
+  tessellate(&req->params, vertices, indices, wideIndices, 0);
+  lovrBufferFlush(vertexBuffer, 0, vertexCount * stride);
+  lovrBufferUnmap(vertexBuffer);
+
+  MeshAttribute position = { .buffer = vertexBuffer, .offset = 0, .stride = stride, .type = F32, .components = 3 };
+  MeshAttribute normal = { .buffer = vertexBuffer, .offset = 12, .stride = stride, .type = F32, .components = 3 };
+  MeshAttribute texCoord = { .buffer = vertexBuffer, .offset = 24, .stride = stride, .type = F32, .components = 2 };
+  MeshAttribute identity = { .buffer = state.identityBuffer, .type = U16, .components = 1, .divisor = 1 };
+
+  Mesh* mesh = lovrMeshCreate(req->topology, vertexBuffer, vertexCount);
+  lovrMeshAttachAttribute(mesh, "lovrPosition", &position);
+  lovrMeshAttachAttribute(mesh, "lovrNormal", &normal);
+  lovrMeshAttachAttribute(mesh, "lovrTexCoord", &texCoord);
+  lovrMeshAttachAttribute(mesh, "lovrDrawID", &identity);
+
+  if (indexBuffer) {
+    lovrBufferFlush(indexBuffer, 0, indexCount * indexSize);
+    lovrBufferUnmap(indexBuffer);
+    lovrMeshSetIndexBuffer(mesh, indexBuffer, indexCount, indexSize, 0);
+  }
+
+  lovrRelease(vertexBuffer, lovrBufferDestroy);
+  lovrRelease(indexBuffer, lovrBufferDestroy);
+
+  arr_expand(&state.shapes, 1);
+  state.shapes.data[state.shapes.length++] = (Shape) {
+    .type = req->type,
+    .params = req->params,
+    .mesh = mesh,
+    .hash = hash
+  };
+
+  map_set(&state.shapeMap, hash, state.shapes.length - 1);
+  return mesh;
+}
+
+// Draws an instanced primitive, either from the shape cache or by streaming its vertices
+static void lovrGraphicsShape(BatchRequest* req, ShapeTessellator* tessellate) {
+  Mesh* mesh = lovrGraphicsGetShape(req, tessellate);
+
+  if (mesh) {
+    req->mesh = mesh;
+    req->vertexCount = 0;
+    req->indexCount = 0;
+    lovrGraphicsBatch(req);
+    return;
+  }
+
   float* vertices = NULL;
-  uint16_t* indices = NULL;
-  uint16_t baseVertex;
+  void* indices = NULL;
+  uint32_t baseVertex = 0;
+  bool wideIndices = false;
+  req->vertices = &vertices;
+  req->indices = &indices;
+  req->baseVertex = &baseVertex;
+  req->wideIndices = &wideIndices;
+  lovrGraphicsBatch(req);
 
-  lovrGraphicsBatch(&(BatchRequest) {
+  if (vertices) {
+    tessellate(&req->params, vertices, indices, wideIndices, baseVertex);
+  }
+}
+
+void lovrGraphicsBox(DrawStyle style, Material* material, mat4 transform) {
+  lovrGraphicsShape(&(BatchRequest) {
     .type = BATCH_BOX,
     .params.box.style = style,
     .topology = style == STYLE_LINE ? DRAW_LINES : DRAW_TRIANGLES,
@@ -946,80 +1721,8 @@ void lovrGraphicsBox(DrawStyle style, Material* material, mat4 transform) {
     .transform = transform,
     .vertexCount = style == STYLE_LINE ? 8 : 24,
     .indexCount = style == STYLE_LINE ? 24 : 36,
-    .vertices = &vertices,
-    .indices = &indices,
-    .baseVertex = &baseVertex,
     .instanced = true
-  });
-
-  if (vertices) {
-    if (style == STYLE_LINE) {
-      static float vertexData[] = {
-        -.5f,  .5f, -.5f, 0.f, 0.f, 0.f, 0.f, 0.f, // Front
-         .5f,  .5f, -.5f, 0.f, 0.f, 0.f, 0.f, 0.f,
-         .5f, -.5f, -.5f, 0.f, 0.f, 0.f, 0.f, 0.f,
-        -.5f, -.5f, -.5f, 0.f, 0.f, 0.f, 0.f, 0.f,
-        -.5f,  .5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f, // Back
-         .5f,  .5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f,
-         .5f, -.5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f,
-        -.5f, -.5f,  .5f, 0.f, 0.f, 0.f, 0.f, 0.f
-      };
-
-      memcpy(vertices, vertexData, sizeof(vertexData));
-
-      static uint16_t indexData[] = {
-        0, 1, 1, 2, 2, 3, 3, 0, // Front
-        4, 5, 5, 6, 6, 7, 7, 4, // Back
-        0, 4, 1, 5, 2, 6, 3, 7  // Connections
-      };
-
-      for (size_t i = 0; i < sizeof(indexData) / sizeof(indexData[0]); i++) {
-        indices[i] = indexData[i] + baseVertex;
-      }
-    } else {
-      static float vertexData[] = {
-        -.5f, -.5f, -.5f,  0.f,  0.f, -1.f, 0.f, 0.f, // Front
-        -.5f,  .5f, -.5f,  0.f,  0.f, -1.f, 0.f, 1.f,
-         .5f, -.5f, -.5f,  0.f,  0.f, -1.f, 1.f, 0.f,
-         .5f,  .5f, -.5f,  0.f,  0.f, -1.f, 1.f, 1.f,
-         .5f,  .5f, -.5f,  1.f,  0.f,  0.f, 0.f, 1.f, // Right
-         .5f,  .5f,  .5f,  1.f,  0.f,  0.f, 1.f, 1.f,
-         .5f, -.5f, -.5f,  1.f,  0.f,  0.f, 0.f, 0.f,
-         .5f, -.5f,  .5f,  1.f,  0.f,  0.f, 1.f, 0.f,
-         .5f, -.5f,  .5f,  0.f,  0.f,  1.f, 0.f, 0.f, // Back
-         .5f,  .5f,  .5f,  0.f,  0.f,  1.f, 0.f, 1.f,
-        -.5f, -.5f,  .5f,  0.f,  0.f,  1.f, 1.f, 0.f,
-        -.5f,  .5f,  .5f,  0.f,  0.f,  1.f, 1.f, 1.f,
-        -.5f,  .5f,  .5f, -1.f,  0.f,  0.f, 0.f, 1.f, // Left
-        -.5f,  .5f, -.5f, -1.f,  0.f,  0.f, 1.f, 1.f,
-        -.5f, -.5f,  .5f, -1.f,  0.f,  0.f, 0.f, 0.f,
-        -.5f, -.5f, -.5f, -1.f,  0.f,  0.f, 1.f, 0.f,
-        -.5f, -.5f, -.5f,  0.f, -1.f,  0.f, 0.f, 0.f, // Bottom
-         .5f, -.5f, -.5f,  0.f, -1.f,  0.f, 1.f, 0.f,
-        -.5f, -.5f,  .5f,  0.f, -1.f,  0.f, 0.f, 1.f,
-         .5f, -.5f,  .5f,  0.f, -1.f,  0.f, 1.f, 1.f,
-        -.5f,  .5f, -.5f,  0.f,  1.f,  0.f, 0.f, 1.f, // Top
-        -.5f,  .5f,  .5f,  0.f,  1.f,  0.f, 0.f, 0.f,
-         .5f,  .5f, -.5f,  0.f,  1.f,  0.f, 1.f, 1.f,
-         .5f,  .5f,  .5f,  0.f,  1.f,  0.f, 1.f, 0.f
-      };
-
-      memcpy(vertices, vertexData, sizeof(vertexData));
-
-      uint16_t indexData[] = {
-        0,  1,   2,  2,  1,  3,
-        4,  5,   6,  6,  5,  7,
-        8,  9,  10, 10,  9, 11,
-        12, 13, 14, 14, 13, 15,
-        16, 17, 18, 18, 17, 19,
-        20, 21, 22, 22, 21, 23
-      };
-
-      for (size_t i = 0; i < sizeof(indexData) / sizeof(indexData[0]); i++) {
-        indices[i] = indexData[i] + baseVertex;
-      }
-    }
-  }
+  }, tessellateBox);
 }
 
 void lovrGraphicsArc(DrawStyle style, ArcMode mode, Material* material, mat4 transform, float r1, float r2, int segments) {
@@ -1032,10 +1735,7 @@ void lovrGraphicsArc(DrawStyle style, ArcMode mode, Material* material, mat4 tra
     hasCenterPoint = mode == ARC_MODE_PIE;
   }
 
-  uint32_t vertexCount = segments + 1 + hasCenterPoint;
-  float* vertices = NULL;
-
-  lovrGraphicsBatch(&(BatchRequest) {
+  lovrGraphicsShape(&(BatchRequest) {
     .type = BATCH_ARC,
     .params.arc.r1 = r1,
     .params.arc.r2 = r2,
@@ -1045,28 +1745,9 @@ void lovrGraphicsArc(DrawStyle style, ArcMode mode, Material* material, mat4 tra
     .topology = style == STYLE_LINE ? (mode == ARC_MODE_OPEN ? DRAW_LINE_STRIP : DRAW_LINE_LOOP) : DRAW_TRIANGLE_FAN,
     .material = material,
     .transform = transform,
-    .vertexCount = vertexCount,
-    .vertices = &vertices,
+    .vertexCount = segments + 1 + hasCenterPoint,
     .instanced = true
-  });
-
-  if (vertices) {
-    if (hasCenterPoint) {
-      memcpy(vertices, ((float[]) { 0.f, 0.f, 0.f, 0.f, 0.f, 1.f, .5f, .5f }), 8 * sizeof(float));
-      vertices += 8;
-    }
-
-    float theta = r1;
-    float angleShift = (r2 - r1) / (float) segments;
-
-    for (int i = 0; i <= segments; i++) {
-      float x = cosf(theta);
-      float y = sinf(theta);
-      memcpy(vertices, ((float[]) { x, y, 0.f, 0.f, 0.f, 1.f, x + .5f, 1.f - (y + .5f) }), 8 * sizeof(float));
-      vertices += 8;
-      theta += angleShift;
-    }
-  }
+  }, tessellateArc);
 }
 
 void lovrGraphicsCircle(DrawStyle style, Material* material, mat4 transform, int segments) {
@@ -1078,13 +1759,7 @@ void lovrGraphicsCylinder(Material* material, mat4 transform, float r1, float r2
   r1 /= length;
   r2 /= length;
 
-  uint32_t vertexCount = ((capped && r1) * (segments + 2) + (capped && r2) * (segments + 2) + 2 * (segments + 1));
-  uint32_t indexCount = 3 * segments * ((capped && r1) + (capped && r2) + 2);
-  float* vertices = NULL;
-  uint16_t* indices = NULL;
-  uint16_t baseVertex;
-
-  lovrGraphicsBatch(&(BatchRequest) {
+  lovrGraphicsShape(&(BatchRequest) {
     .type = BATCH_CYLINDER,
     .params.cylinder.r1 = r1,
     .params.cylinder.r2 = r2,
@@ -1093,89 +1768,14 @@ void lovrGraphicsCylinder(Material* material, mat4 transform, float r1, float r2
     .topology = DRAW_TRIANGLES,
     .material = material,
     .transform = transform,
-    .vertexCount = vertexCount,
-    .indexCount = indexCount,
-    .vertices = &vertices,
-    .indices = &indices,
-    .baseVertex = &baseVertex,
+    .vertexCount = ((capped && r1) * (segments + 2) + (capped && r2) * (segments + 2) + 2 * (segments + 1)),
+    .indexCount = 3 * segments * ((capped && r1) + (capped && r2) + 2),
     .instanced = true
-  });
-
-  if (vertices) {
-    float* v = vertices;
-
-    // Ring
-    for (int i = 0; i <= segments; i++) {
-      float t = (float) i / segments;
-      float theta = t * (2 * M_PI);
-      float X = cosf(theta);
-      float Y = sinf(theta);
-      memcpy(vertices, (float[16]) {
-        r1 * X, r1 * Y, -.5f, X, Y, 0.f, 1.f - t, 1.f,
-        r2 * X, r2 * Y,  .5f, X, Y, 0.f, 1.f - t, 0.f
-      }, 16 * sizeof(float));
-      vertices += 16;
-    }
-
-    // Top
-    int top = (segments + 1) * 2 + baseVertex;
-    if (capped && r1 != 0) {
-      memcpy(vertices, (float[8]) { 0.f, 0.f, -.5f, 0.f, 0.f, -1.f, .5f, .5f }, 8 * sizeof(float));
-      vertices += 8;
-      for (int i = 0; i <= segments; i++) {
-        int j = i * 2 * 8;
-        float x = v[j + 0];
-        float y = v[j + 1];
-        float z = v[j + 2];
-        float u = 1.f - (x / r1 * .5 + .5);
-        float v = y / r1 * .5 + .5;
-        memcpy(vertices, (float[8]) { x, y, z, 0.f, 0.f, -1.f, u, v }, 8 * sizeof(float));
-        vertices += 8;
-      }
-    }
-
-    // Bottom
-    int bot = (segments + 1) * 2 + (1 + segments + 1) * (capped && r1 != 0) + baseVertex;
-    if (capped && r2 != 0) {
-      memcpy(vertices, (float[8]) { 0.f, 0.f, .5f, 0.f, 0.f, 1.f, .5f, .5f }, 8 * sizeof(float));
-      vertices += 8;
-      for (int i = 0; i <= segments; i++) {
-        int j = i * 2 * 8 + 8;
-        float x = v[j + 0];
-        float y = v[j + 1];
-        float z = v[j + 2];
-        float u = x / r1 * .5 + .5;
-        float v = y / r1 * .5 + .5;
-        memcpy(vertices, (float[8]) { x, y, z, 0.f, 0.f, 1.f, u, v }, 8 * sizeof(float));
-        vertices += 8;
-      }
-    }
-
-    // Indices
-    for (int i = 0; i < segments; i++) {
-      int j = 2 * i + baseVertex;
-      memcpy(indices, (uint16_t[6]) { j, j + 2, j + 1, j + 1, j + 2, j + 3 }, 6 * sizeof(uint16_t));
-      indices += 6;
-
-      if (capped && r1 != 0.f) {
-        memcpy(indices, (uint16_t[3]) { top, top + i + 2, top + i + 1 }, 3 * sizeof(uint16_t));
-        indices += 3;
-      }
-
-      if (capped && r2 != 0.f) {
-        memcpy(indices, (uint16_t[3]) { bot, bot + i + 1, bot + i + 2 }, 3 * sizeof(uint16_t));
-        indices += 3;
-      }
-    }
-  }
+  }, tessellateCylinder);
 }
 
 void lovrGraphicsSphere(Material* material, mat4 transform, int segments) {
-  float* vertices = NULL;
-  uint16_t* indices = NULL;
-  uint16_t baseVertex;
-
-  lovrGraphicsBatch(&(BatchRequest) {
+  lovrGraphicsShape(&(BatchRequest) {
     .type = BATCH_SPHERE,
     .params.sphere.segments = segments,
     .topology = DRAW_TRIANGLES,
@@ -1183,38 +1783,8 @@ void lovrGraphicsSphere(Material* material, mat4 transform, int segments) {
     .transform = transform,
     .vertexCount = (segments + 1) * (segments + 1),
     .indexCount = segments * segments * 6,
-    .vertices = &vertices,
-    .indices = &indices,
-    .baseVertex = &baseVertex,
     .instanced = true
-  });
-
-  if (vertices) {
-    for (int i = 0; i <= segments; i++) {
-      float v = i / (float) segments;
-      float sinV = sinf(v * (float) M_PI);
-      float cosV = cosf(v * (float) M_PI);
-      for (int k = 0; k <= segments; k++) {
-        float u = k / (float) segments;
-        float x = sinf(u * 2.f * (float) M_PI) * sinV;
-        float y = cosV;
-        float z = -cosf(u * 2.f * (float) M_PI) * sinV;
-        memcpy(vertices, ((float[8]) { x, y, z, x, y, z, u, 1.f - v }), 8 * sizeof(float));
-        vertices += 8;
-      }
-    }
-
-    for (int i = 0; i < segments; i++) {
-      uint16_t offset0 = i * (segments + 1) + baseVertex;
-      uint16_t offset1 = (i + 1) * (segments + 1) + baseVertex;
-      for (int j = 0; j < segments; j++) {
-        uint16_t i0 = offset0 + j;
-        uint16_t i1 = offset1 + j;
-        memcpy(indices, ((uint16_t[]) { i0, i0 + 1, i1, i1, i0 + 1, i1 + 1 }), 6 * sizeof(uint16_t));
-        indices += 6;
-      }
-    }
-  }
+  }, tessellateSphere);
 }
 
 void lovrGraphicsSkybox(Texture* texture) {
@@ -1269,8 +1839,9 @@ void lovrGraphicsPrint(const char* str, size_t length, mat4 transform, float wra
   pipeline.blendMode = pipeline.blendMode == BLEND_NONE ? BLEND_ALPHA : pipeline.blendMode;
 
   float* vertices;
-  uint16_t* indices;
-  uint16_t baseVertex;
+  void* indices;
+  uint32_t baseVertex;
+  bool wideIndices;
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_TEXT,
     .params.text.spread = lovrFontGetSpread(font),
@@ -1283,10 +1854,11 @@ void lovrGraphicsPrint(const char* str, size_t length, mat4 transform, float wra
     .indexCount = glyphCount * 6,
     .vertices = &vertices,
     .indices = &indices,
-    .baseVertex = &baseVertex
+    .baseVertex = &baseVertex,
+    .wideIndices = &wideIndices
   });
 
-  lovrFontRender(font, str, length, wrap, halign, vertices, indices, baseVertex);
+  lovrFontRender(font, str, length, wrap, halign, vertices, indices, baseVertex, wideIndices);
 }
 
 void lovrGraphicsFill(Texture* texture, float u, float v, float w, float h) {
@@ -1317,7 +1889,66 @@ void lovrGraphicsFill(Texture* texture, float u, float v, float w, float h) {
   }
 }
 
-void lovrGraphicsDrawMesh(Mesh* mesh, mat4 transform, uint32_t instances, float* pose) {
+// Returns whether a bounding box, relative to the current transform and an optional transform, is
+// outside the frustum of every view.  The corners are projected to clip space, and the box can be
+// skipped if all of them are outside the same clip plane.  DrawLists can be submitted anywhere,
+// so nothing is culled while recording one.
+bool lovrGraphicsCull(float aabb[6], mat4 transform) {
+  if (!state.frustumCulling || state.drawList) {
+    return false;
+  }
+
+  if (state.frustumDirty) {
+    for (int i = 0; i < 2; i++) {
+      mat4_init(state.viewProjection[i], state.frameData.projection[i]);
+      mat4_mul(state.viewProjection[i], state.frameData.viewMatrix[i]);
+    }
+    state.frustumDirty = false;
+  }
+
+  float model[16];
+  mat4_init(model, state.transforms[state.transform]);
+  if (transform) {
+    mat4_mul(model, transform);
+  }
+
+  Canvas* canvas = state.canvas ? state.canvas : state.backbuffer;
+  uint32_t viewCount = lovrCanvasIsStereo(canvas) ? 2 : 1;
+  for (uint32_t i = 0; i < viewCount; i++) {
+    float m[16];
+    mat4_init(m, state.viewProjection[i]);
+    mat4_mul(m, model);
+
+    uint8_t outside = 0x3f;
+    for (int c = 0; c < 8; c++) {
+      float x = aabb[0 + ((c >> 0) & 1)];
+      float y = aabb[2 + ((c >> 1) & 1)];
+      float z = aabb[4 + ((c >> 2) & 1)];
+      float cx = x * m[0] + y * m[4] + z * m[8] + m[12];
+      float cy = x * m[1] + y * m[5] + z * m[9] + m[13];
+      float cz = x * m[2] + y * m[6] + z * m[10] + m[14];
+      float cw = x * m[3] + y * m[7] + z * m[11] + m[15];
+      outside &= (cx < -cw) | (cx > cw) << 1 | (cy < -cw) << 2 | (cy > cw) << 3 | (cz < -cw) << 4 | (cz > cw) << 5;
+    }
+
+    if (!outside) {
+      return false;
+    }
+  }
+
+  lovrGpuCountCulled(1);
+  return true;
+}
+
+void lovrGraphicsDrawMesh(Mesh* mesh, mat4 transform, uint32_t instances, float* pose, uint32_t boneCount) {
+  float aabb[6];
+  lovrAssert(!pose || boneCount <= state.maxBones, "Too many bones (%d, max is %d)", boneCount, state.maxBones);
+
+  // Instances are positioned by the shader and poses move vertices, so the bounds don't apply
+  if (instances <= 1 && !pose && lovrMeshGetBounds(mesh, aabb) && lovrGraphicsCull(aabb, transform)) {
+    return;
+  }
+
   uint32_t vertexCount = lovrMeshGetVertexCount(mesh);
   uint32_t indexCount = lovrMeshGetIndexCount(mesh);
   uint32_t defaultCount = indexCount > 0 ? indexCount : vertexCount;
@@ -1332,11 +1963,560 @@ void lovrGraphicsDrawMesh(Mesh* mesh, mat4 transform, uint32_t instances, float*
     .params.mesh.rangeStart = rangeStart,
     .params.mesh.rangeCount = rangeCount,
     .params.mesh.instances = instances,
-    .params.mesh.pose = pose,
+    .params.mesh.boneCount = pose ? boneCount : 0,
     .mesh = mesh,
     .topology = mode,
     .transform = transform,
+    .pose = pose,
     .material = material,
     .instanced = instances <= 1
   });
 }
+
+// DrawList
+
+// Grows the transform and color arrays to cover a number of draw slots, zeroing the new slots
+static void lovrDrawListReserveSlots(DrawList* list, size_t count) {
+  size_t oldCount = list->colors.length;
+  if (count > oldCount) {
+    arr_reserve(&list->transforms, 16 * count);
+    arr_reserve(&list->colors, count);
+    memset(list->transforms.data + 16 * oldCount, 0, 16 * (count - oldCount) * sizeof(float));
+    memset(list->colors.data + oldCount, 0, (count - oldCount) * sizeof(Color));
+    list->transforms.length = 16 * count;
+    list->colors.length = count;
+  }
+}
+
+// Grows the pose array to cover a number of matrices, zeroing the new ones
+static void lovrDrawListReservePoses(DrawList* list, size_t count) {
+  size_t oldCount = list->poses.length / 16;
+  if (count > oldCount) {
+    arr_reserve(&list->poses, 16 * count);
+    memset(list->poses.data + 16 * oldCount, 0, 16 * (count - oldCount) * sizeof(float));
+    list->poses.length = 16 * count;
+  }
+}
+
+static void lovrDrawListReleaseBuffers(DrawList* list) {
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    lovrRelease(list->buffers[i], lovrBufferDestroy);
+    list->buffers[i] = NULL;
+    list->bufferCount[i] = 0;
+  }
+
+  lovrRelease(list->mesh, lovrMeshDestroy);
+  lovrRelease(list->instancedMesh, lovrMeshDestroy);
+  list->mesh = NULL;
+  list->instancedMesh = NULL;
+}
+
+static void lovrDrawListReset(DrawList* list) {
+  lovrDrawListClear(list);
+  lovrDrawListReleaseBuffers(list);
+}
+
+DrawList* lovrDrawListCreate() {
+  DrawList* list = calloc(1, sizeof(DrawList));
+  lovrAssert(list, "Out of memory");
+  list->ref = 1;
+  arr_init(&list->commands, realloc);
+  for (int i = 0; i < STREAM_MODEL; i++) {
+    arr_init(&list->streams[i], realloc);
+  }
+  arr_init(&list->transforms, realloc);
+  arr_init(&list->colors, realloc);
+  arr_init(&list->poses, realloc);
+  list->color = (Color) { 1.f, 1.f, 1.f, 1.f };
+  return list;
+}
+
+void lovrDrawListDestroy(void* ref) {
+  DrawList* list = ref;
+  lovrDrawListReset(list);
+  lovrRelease(list->shader, lovrShaderDestroy);
+  arr_free(&list->commands);
+  for (int i = 0; i < STREAM_MODEL; i++) {
+    arr_free(&list->streams[i]);
+  }
+  arr_free(&list->transforms);
+  arr_free(&list->colors);
+  arr_free(&list->poses);
+  free(list);
+}
+
+uint32_t lovrDrawListGetDrawCount(DrawList* list) {
+  return list->drawCount;
+}
+
+// The functions below only touch the DrawList and never the graphics state, so a list can be
+// filled on any thread as long as no other thread is using it at the same time.  Its buffers are
+// created by the main thread the next time it's submitted.
+
+void lovrDrawListClear(DrawList* list) {
+  for (size_t i = 0; i < list->commands.length; i++) {
+    DrawListCommand* command = &list->commands.data[i];
+    lovrRelease(command->batch.draw.mesh, lovrMeshDestroy);
+    lovrRelease(command->batch.draw.shader, lovrShaderDestroy);
+    lovrRelease(command->batch.material, lovrMaterialDestroy);
+    lovrRelease(command->texture, lovrTextureDestroy);
+    lovrRelease(command->skybox, lovrTextureDestroy);
+  }
+
+  for (int i = 0; i < STREAM_MODEL; i++) {
+    arr_clear(&list->streams[i]);
+  }
+
+  arr_clear(&list->commands);
+  arr_clear(&list->transforms);
+  arr_clear(&list->colors);
+  arr_clear(&list->poses);
+  list->slotCount = 0;
+  list->poseCount = 0;
+  list->drawCount = 0;
+  list->uploaded = false;
+  list->dirty = true;
+}
+
+void lovrDrawListSetColor(DrawList* list, Color color) {
+  list->color.r = lovrMathGammaToLinear(color.r);
+  list->color.g = lovrMathGammaToLinear(color.g);
+  list->color.b = lovrMathGammaToLinear(color.b);
+  list->color.a = color.a;
+}
+
+void lovrDrawListSetShader(DrawList* list, Shader* shader) {
+  lovrAssert(!shader || lovrShaderGetType(shader) == SHADER_GRAPHICS, "Compute shaders can not be used with DrawLists");
+  lovrRetain(shader);
+  lovrRelease(list->shader, lovrShaderDestroy);
+  list->shader = shader;
+}
+
+// Records a draw into the list's own arrays.  This is a smaller version of lovrGraphicsBatch:
+// shapes are instanced from a single copy of their vertices, and the pipeline, canvas, and default
+// material are picked up from the graphics state when the list is submitted.
+static void lovrDrawListAdd(DrawList* list, BatchRequest* req, ShapeTessellator* tessellate) {
+  lovrAssert(!list->uploaded, "DrawList has already been submitted, clear it before recording more draws");
+  DefaultShader defaultShader = list->shader ? MAX_DEFAULT_SHADERS : req->shader;
+  uint32_t align = MAX(lovrGpuGetLimits()->blockAlign / (uint32_t) bufferStride[STREAM_COLOR], 1);
+  uint32_t poseAlign = MAX(lovrGpuGetLimits()->blockAlign / (uint32_t) bufferStride[STREAM_POSE], 1);
+
+  DrawListCommand* command = NULL;
+  if (list->commands.length > 0 && !(req->type == BATCH_MESH && req->params.mesh.instances > 1)) {
+    DrawListCommand* last = &list->commands.data[list->commands.length - 1];
+    Batch* b = &last->batch;
+    if (
+      last->inheritPipeline &&
+      b->drawCount < state.maxDraws &&
+      (b->drawCount + 1) * getBoneCount(b) <= state.maxBones &&
+      b->type == req->type &&
+      b->draw.mesh == req->mesh &&
+      b->draw.shader == list->shader &&
+      b->defaultShader == defaultShader &&
+      b->material == req->material &&
+      !memcmp(&b->params, &req->params, sizeof(BatchParams))
+    ) {
+      command = last;
+    }
+  }
+
+  if (!command) {
+    uint32_t vertexStart = (uint32_t) (list->streams[STREAM_VERTEX].length / bufferStride[STREAM_VERTEX]);
+    bool wideIndices = req->indexCount > 0 && vertexStart + req->vertexCount > MAX_SHORT_VERTICES;
+    StreamType indexStream = wideIndices ? STREAM_INDEX32 : STREAM_INDEX;
+    uint32_t indexStart = (uint32_t) (list->streams[indexStream].length / bufferStride[indexStream]);
+    lovrAssert(vertexStart + req->vertexCount <= MAX_RECORDED_ELEMENTS, "Too many vertices in DrawList");
+
+    uint32_t rangeStart, rangeCount, instances;
+    if (req->type == BATCH_MESH) {
+      rangeStart = req->params.mesh.rangeStart;
+      rangeCount = req->params.mesh.rangeCount;
+      instances = req->instanced ? 0 : req->params.mesh.instances;
+    } else {
+      rangeStart = req->indexCount > 0 ? indexStart : vertexStart;
+      rangeCount = req->indexCount > 0 ? req->indexCount : req->vertexCount;
+      instances = 0;
+    }
+
+    // Shapes only store their vertices once, every draw after the first one is another instance
+    if (req->vertexCount > 0) {
+      arr_expand(&list->streams[STREAM_VERTEX], req->vertexCount * bufferStride[STREAM_VERTEX]);
+      arr_expand(&list->streams[STREAM_DRAWID], req->vertexCount * bufferStride[STREAM_DRAWID]);
+      float* vertices = (float*) (list->streams[STREAM_VERTEX].data + list->streams[STREAM_VERTEX].length);
+      uint16_t* ids = (uint16_t*) (list->streams[STREAM_DRAWID].data + list->streams[STREAM_DRAWID].length);
+      list->streams[STREAM_VERTEX].length += req->vertexCount * bufferStride[STREAM_VERTEX];
+      list->streams[STREAM_DRAWID].length += req->vertexCount * bufferStride[STREAM_DRAWID];
+      memset(ids, 0, req->vertexCount * sizeof(uint16_t));
+
+      void* indices = NULL;
+      if (req->indexCount > 0) {
+        arr_expand(&list->streams[indexStream], req->indexCount * bufferStride[indexStream]);
+        indices = list->streams[indexStream].data + list->streams[indexStream].length;
+        list->streams[indexStream].length += req->indexCount * bufferStride[indexStream];
+      }
+
+      tessellate(&req->params, vertices, indices, wideIndices, vertexStart);
+    }
+
+    arr_expand(&list->commands, 1);
+    command = &list->commands.data[list->commands.length++];
+    *command = (DrawListCommand) {
+      .batch = {
+        .type = req->type,
+        .params = req->params,
+        .draw = {
+          .mesh = req->mesh,
+          .shader = list->shader,
+          .topology = req->topology,
+          .rangeStart = rangeStart,
+          .rangeCount = rangeCount,
+          .instances = instances
+        },
+        .defaultShader = defaultShader,
+        .material = req->material,
+        .drawStart = list->slotCount,
+        .poseStart = req->pose ? (uint32_t) ALIGN(list->poseCount, poseAlign) : 0,
+        .indexed = req->indexCount > 0,
+        .wideIndices = wideIndices
+      },
+      .defaultMaterial = !req->material,
+      .inheritPipeline = true
+    };
+
+    lovrRetain(req->mesh);
+    lovrRetain(list->shader);
+    lovrRetain(req->material);
+  }
+
+  // Slots are handed out in groups so each command's block starts on an aligned offset
+  Batch* batch = &command->batch;
+  if (batch->drawCount % align == 0) {
+    list->slotCount += align;
+    lovrDrawListReserveSlots(list, list->slotCount);
+  }
+
+  uint32_t slot = batch->drawStart + batch->drawCount;
+  if (req->transform) {
+    mat4_init(list->transforms.data + 16 * slot, req->transform);
+  } else {
+    mat4_identity(list->transforms.data + 16 * slot);
+  }
+  list->colors.data[slot] = list->color;
+
+  // Only the last command grows, so its poses stay contiguous
+  if (req->pose) {
+    uint32_t boneCount = req->params.mesh.boneCount;
+    uint32_t poseSlot = batch->poseStart + batch->drawCount * boneCount;
+    list->poseCount = poseSlot + boneCount;
+    lovrDrawListReservePoses(list, list->poseCount);
+    memcpy(list->poses.data + 16 * poseSlot, req->pose, 16 * boneCount * sizeof(float));
+  }
+
+  if (req->instanced) {
+    batch->draw.instances++;
+  }
+
+  batch->drawCount++;
+  list->drawCount++;
+}
+
+void lovrDrawListBox(DrawList* list, DrawStyle style, Material* material, mat4 transform) {
+  lovrDrawListAdd(list, &(BatchRequest) {
+    .type = BATCH_BOX,
+    .params.box.style = style,
+    .topology = style == STYLE_LINE ? DRAW_LINES : DRAW_TRIANGLES,
+    .material = material,
+    .transform = transform,
+    .vertexCount = style == STYLE_LINE ? 8 : 24,
+    .indexCount = style == STYLE_LINE ? 24 : 36,
+    .instanced = true
+  }, tessellateBox);
+}
+
+void lovrDrawListCylinder(DrawList* list, Material* material, mat4 transform, float r1, float r2, bool capped, int segments) {
+  float length = vec3_length((float[4]) { transform[8], transform[9], transform[10] });
+  r1 /= length;
+  r2 /= length;
+
+  lovrDrawListAdd(list, &(BatchRequest) {
+    .type = BATCH_CYLINDER,
+    .params.cylinder.r1 = r1,
+    .params.cylinder.r2 = r2,
+    .params.cylinder.capped = capped,
+    .params.cylinder.segments = segments,
+    .topology = DRAW_TRIANGLES,
+    .material = material,
+    .transform = transform,
+    .vertexCount = ((capped && r1) * (segments + 2) + (capped && r2) * (segments + 2) + 2 * (segments + 1)),
+    .indexCount = 3 * segments * ((capped && r1) + (capped && r2) + 2),
+    .instanced = true
+  }, tessellateCylinder);
+}
+
+void lovrDrawListSphere(DrawList* list, Material* material, mat4 transform, int segments) {
+  lovrDrawListAdd(list, &(BatchRequest) {
+    .type = BATCH_SPHERE,
+    .params.sphere.segments = segments,
+    .topology = DRAW_TRIANGLES,
+    .material = material,
+    .transform = transform,
+    .vertexCount = (segments + 1) * (segments + 1),
+    .indexCount = segments * segments * 6,
+    .instanced = true
+  }, tessellateSphere);
+}
+
+void lovrDrawListDrawMesh(DrawList* list, Mesh* mesh, mat4 transform, uint32_t instances, float* pose, uint32_t boneCount) {
+  lovrAssert(!pose || boneCount <= state.maxBones, "Too many bones (%d, max is %d)", boneCount, state.maxBones);
+  uint32_t vertexCount = lovrMeshGetVertexCount(mesh);
+  uint32_t indexCount = lovrMeshGetIndexCount(mesh);
+  uint32_t defaultCount = indexCount > 0 ? indexCount : vertexCount;
+  uint32_t rangeStart, rangeCount;
+  lovrMeshGetDrawRange(mesh, &rangeStart, &rangeCount);
+  rangeCount = rangeCount > 0 ? rangeCount : defaultCount;
+
+  lovrDrawListAdd(list, &(BatchRequest) {
+    .type = BATCH_MESH,
+    .params.mesh.rangeStart = rangeStart,
+    .params.mesh.rangeCount = rangeCount,
+    .params.mesh.instances = instances,
+    .params.mesh.boneCount = pose ? boneCount : 0,
+    .mesh = mesh,
+    .topology = lovrMeshGetDrawMode(mesh),
+    .transform = transform,
+    .pose = pose,
+    .material = lovrMeshGetMaterial(mesh),
+    .instanced = instances <= 1
+  }, NULL);
+}
+
+// Creates the list's buffers from everything recorded into it.  Geometry and colors never change,
+// so they go in static buffers.  Transforms depend on the transform the list is submitted with, so
+// they're uploaded during the submit.
+static void lovrDrawListUpload(DrawList* list) {
+  lovrDrawListReleaseBuffers(list);
+
+  // Uniform blocks bind a full MAX_DRAWS range, so leave room for that after the last command
+  lovrDrawListReserveSlots(list, list->slotCount + (state.wideDraws ? 0 : MAX_DRAWS));
+
+  for (int i = 0; i < STREAM_MODEL; i++) {
+    if (list->streams[i].length > 0) {
+      list->buffers[i] = lovrBufferCreate(list->streams[i].length, list->streams[i].data, bufferType[i], USAGE_STATIC, false);
+      list->bufferCount[i] = (uint32_t) (list->streams[i].length / bufferStride[i]);
+    }
+    arr_free(&list->streams[i]);
+    arr_init(&list->streams[i], realloc);
+  }
+
+  if (list->slotCount > 0) {
+    BufferType type = state.wideDraws ? BUFFER_SHADER_STORAGE : BUFFER_UNIFORM;
+    size_t count = list->colors.length;
+    list->buffers[STREAM_MODEL] = lovrBufferCreate(count * bufferStride[STREAM_MODEL], NULL, type, USAGE_DYNAMIC, false);
+    list->buffers[STREAM_COLOR] = lovrBufferCreate(count * bufferStride[STREAM_COLOR], list->colors.data, type, USAGE_STATIC, false);
+    list->bufferCount[STREAM_MODEL] = list->bufferCount[STREAM_COLOR] = (uint32_t) count;
+    arr_free(&list->colors);
+    arr_init(&list->colors, realloc);
+  }
+
+  // Poses are relative to the mesh, so they don't depend on the transform either
+  if (list->poseCount > 0) {
+    BufferType type = state.wideDraws ? BUFFER_SHADER_STORAGE : BUFFER_UNIFORM;
+    lovrDrawListReservePoses(list, list->poseCount + (state.wideDraws ? 0 : MAX_BONES));
+    size_t count = list->poses.length / 16;
+    list->buffers[STREAM_POSE] = lovrBufferCreate(count * bufferStride[STREAM_POSE], list->poses.data, type, USAGE_STATIC, false);
+    list->bufferCount[STREAM_POSE] = (uint32_t) count;
+    arr_free(&list->poses);
+    arr_init(&list->poses, realloc);
+  }
+
+  if (list->buffers[STREAM_VERTEX]) {
+    Buffer* vertexBuffer = list->buffers[STREAM_VERTEX];
+    size_t stride = bufferStride[STREAM_VERTEX];
+
+    MeshAttribute position = { .buffer = vertexBuffer, .offset = 0, .stride = stride, .type = F32, .components = 3 };
+    MeshAttribute normal = { .buffer = vertexBuffer, .offset = 12, .stride = stride, .type = F32, .components = 3 };
+    MeshAttribute texCoord = { .buffer = vertexBuffer, .offset = 24, .stride = stride, .type = F32, .components = 2 };
+    MeshAttribute drawId = { .buffer = list->buffers[STREAM_DRAWID], .type = U16, .components = 1 };
+    MeshAttribute identity = { .buffer = state.identityBuffer, .type = U16, .components = 1, .divisor = 1 };
+
+    list->mesh = lovrMeshCreate(DRAW_TRIANGLES, NULL, 0);
+    lovrMeshAttachAttribute(list->mesh, "lovrPosition", &position);
+    lovrMeshAttachAttribute(list->mesh, "lovrNormal", &normal);
+    lovrMeshAttachAttribute(list->mesh, "lovrTexCoord", &texCoord);
+    lovrMeshAttachAttribute(list->mesh, "lovrDrawID", &drawId);
+
+    list->instancedMesh = lovrMeshCreate(DRAW_TRIANGLES, NULL, 0);
+    lovrMeshAttachAttribute(list->instancedMesh, "lovrPosition", &position);
+    lovrMeshAttachAttribute(list->instancedMesh, "lovrNormal", &normal);
+    lovrMeshAttachAttribute(list->instancedMesh, "lovrTexCoord", &texCoord);
+    lovrMeshAttachAttribute(list->instancedMesh, "lovrDrawID", &identity);
+  }
+
+  list->uploaded = true;
+  list->dirty = true;
+}
+
+// Copies the resolved batches of a flush into the DrawList being recorded.  Transforms and colors
+// get the same block layout they'd have in the streams, so they can be bound the same way later.
+// Streamed batches don't keep a mesh, they draw from the list's own meshes once it's uploaded.
+static void lovrGraphicsCapture(DrawList* list, Batch* batches, uint32_t* order, uint32_t batchCount) {
+  uint32_t align = MAX(lovrGpuGetLimits()->blockAlign / (uint32_t) bufferStride[STREAM_COLOR], 1);
+  uint32_t poseAlign = MAX(lovrGpuGetLimits()->blockAlign / (uint32_t) bufferStride[STREAM_POSE], 1);
+
+  for (uint32_t i = 0; i < batchCount; i++) {
+    Batch* batch = &batches[order[i]];
+    uint32_t poseCount = batch->drawCount * getBoneCount(batch);
+    batch->drawStart = list->slotCount;
+    batch->poseStart = poseCount > 0 ? (uint32_t) ALIGN(list->poseCount, poseAlign) : 0;
+    batch->cursor = 0;
+    list->slotCount += (batch->drawCount + align - 1) / align * align;
+    list->poseCount = poseCount > 0 ? batch->poseStart + poseCount : list->poseCount;
+    list->drawCount += batch->drawCount;
+
+    arr_expand(&list->commands, 1);
+    DrawListCommand* command = &list->commands.data[list->commands.length++];
+    command->batch = *batch;
+    command->batch.draw.canvas = NULL;
+    command->defaultMaterial = batch->material == state.defaultMaterial;
+    command->inheritPipeline = false;
+    command->texture = command->defaultMaterial ? lovrMaterialGetTexture(batch->material, TEXTURE_DIFFUSE) : NULL;
+    command->skybox = NULL;
+
+    // Cubemap skyboxes send their texture to the shader instead of the material
+    if (batch->type == BATCH_SKYBOX) {
+      const Uniform* uniform = lovrShaderGetUniform(batch->draw.shader, lovrShaderBuiltinUniforms[BUILTIN_SKYBOX_TEXTURE]);
+      command->skybox = uniform ? uniform->value.textures[0] : NULL;
+    }
+
+    if (batch->draw.mesh == state.mesh || batch->draw.mesh == state.instancedMesh) {
+      command->batch.draw.mesh = NULL;
+    }
+    lovrRetain(command->batch.draw.mesh);
+    lovrRetain(command->batch.draw.shader);
+    lovrRetain(command->batch.material);
+    lovrRetain(command->texture);
+    lovrRetain(command->skybox);
+  }
+
+  lovrDrawListReserveSlots(list, list->slotCount);
+  lovrDrawListReservePoses(list, list->poseCount);
+
+  for (size_t d = 0; d < state.draws.length; d++) {
+    DrawData* draw = &state.draws.data[d];
+    Batch* batch = &batches[draw->batch];
+    uint32_t index = batch->cursor++;
+    uint32_t slot = batch->drawStart + index;
+    memcpy(list->transforms.data + 16 * slot, draw->transform, 16 * sizeof(float));
+    list->colors.data[slot] = draw->color;
+
+    if (draw->pose != ~0u) {
+      uint32_t boneCount = getBoneCount(batch);
+      float* pose = list->poses.data + 16 * (batch->poseStart + index * boneCount);
+      memcpy(pose, state.poses.data + draw->pose, 16 * boneCount * sizeof(float));
+    }
+  }
+}
+
+void lovrGraphicsBeginRecording(DrawList* list) {
+  lovrAssert(!state.drawList, "Only one DrawList can be recorded at a time");
+  lovrGraphicsFlush();
+  lovrDrawListReset(list);
+  lovrRetain(list);
+  state.drawList = list;
+
+  for (int i = 0; i < STREAM_MODEL; i++) {
+    state.savedHead[i] = state.head[i];
+    state.savedCount[i] = state.bufferCount[i];
+    state.head[i] = state.tail[i] = 0;
+    state.bufferCount[i] = MAX_RECORDED_ELEMENTS;
+  }
+
+  lovrGraphicsPush();
+  lovrGraphicsOrigin();
+}
+
+void lovrGraphicsEndRecording() {
+  DrawList* list = state.drawList;
+  lovrAssert(list, "No DrawList is being recorded");
+  lovrGraphicsFlush();
+  lovrGraphicsPop();
+  state.drawList = NULL;
+
+  for (int i = 0; i < STREAM_MODEL; i++) {
+    state.head[i] = state.tail[i] = state.savedHead[i];
+    state.bufferCount[i] = state.savedCount[i];
+  }
+
+  lovrDrawListUpload(list);
+  lovrRelease(list, lovrDrawListDestroy);
+}
+
+void lovrGraphicsSubmit(DrawList* list, mat4 transform) {
+  lovrAssert(!state.drawList, "A DrawList can not be submitted while one is being recorded");
+  if (list->commands.length == 0) {
+    return;
+  }
+
+  lovrGraphicsFlush();
+
+  // Lists filled by lovrDrawListAdd are uploaded the first time they're submitted
+  if (!list->uploaded) {
+    lovrDrawListUpload(list);
+  }
+
+  float model[16];
+  mat4_init(model, state.transforms[state.transform]);
+  if (transform) {
+    mat4_mul(model, transform);
+  }
+
+  // Transforms are only uploaded again when the list is submitted with a different transform
+  if (list->dirty || memcmp(model, list->transform, sizeof(model))) {
+    Buffer* buffer = list->buffers[STREAM_MODEL];
+    lovrBufferDiscard(buffer);
+    float* transforms = lovrBufferMap(buffer, 0, true);
+    for (size_t i = 0; i < list->transforms.length; i += 16) {
+      mat4_mul(mat4_init(transforms + i, model), list->transforms.data + i);
+    }
+    lovrBufferFlush(buffer, 0, list->transforms.length * sizeof(float));
+    lovrBufferUnmap(buffer);
+    memcpy(list->transform, model, sizeof(model));
+    list->dirty = false;
+  }
+
+  lovrGraphicsUpdateFrameData();
+  lovrGraphicsFlushStreams();
+
+  Canvas* canvas = state.canvas ? state.canvas : state.backbuffer;
+  bool stereo = lovrCanvasIsStereo(canvas);
+
+  for (size_t i = 0; i < list->commands.length; i++) {
+    DrawListCommand* command = &list->commands.data[i];
+    Batch batch = command->batch;
+    batch.draw.canvas = canvas;
+
+    if (!batch.draw.mesh) {
+      batch.draw.mesh = batch.draw.instances > 1 ? list->instancedMesh : list->mesh;
+    }
+
+    if (batch.defaultShader != MAX_DEFAULT_SHADERS) {
+      batch.draw.shader = lovrGraphicsGetDefaultShader(batch.defaultShader, stereo);
+    }
+
+    if (command->inheritPipeline) {
+      batch.draw.pipeline = state.pipeline;
+    }
+
+    if (command->defaultMaterial) {
+      batch.material = lovrGraphicsGetDefaultMaterial();
+      lovrMaterialSetTexture(batch.material, TEXTURE_DIFFUSE, command->texture);
+    }
+
+    if (command->skybox) {
+      int id = lovrShaderGetBuiltinUniformId(batch.draw.shader, BUILTIN_SKYBOX_TEXTURE);
+      lovrShaderSetUniformById(batch.draw.shader, id, UNIFORM_SAMPLER, &command->skybox, 0, 1);
+    }
+
+    lovrGraphicsDrawBatch(&batch, list->buffers, list->bufferCount, list->mesh, list->instancedMesh);
+  }
+}
@@ -6,8 +6,13 @@
 
 #pragma once
 
+// Limits for the stream sizes in lovr.conf, vertices take 34 bytes each across their streams
+#define MAX_STREAM_VERTICES (1 << 22)
+#define MAX_STREAM_INDICES (1 << 24)
+
 struct Buffer;
 struct Canvas;
+struct DrawList;
 struct Font;
 struct Material;
 struct Mesh;
@@ -99,7 +104,7 @@ typedef struct {
 } WindowFlags;
 
 // Base
-bool lovrGraphicsInit(bool debug);
+bool lovrGraphicsInit(bool debug, uint32_t vertexCount, uint32_t indexCount);
 void lovrGraphicsDestroy(void);
 void lovrGraphicsPresent(void);
 void lovrGraphicsCreateWindow(WindowFlags* flags);
@@ -134,6 +139,8 @@ void lovrGraphicsGetColorMask(bool* r, bool* g, bool* b, bool* a);
 void lovrGraphicsSetColorMask(bool r, bool g, bool b, bool a);
 bool lovrGraphicsIsCullingEnabled(void);
 void lovrGraphicsSetCullingEnabled(bool culling);
+bool lovrGraphicsIsFrustumCullingEnabled(void);
+void lovrGraphicsSetFrustumCullingEnabled(bool enabled);
 TextureFilter lovrGraphicsGetDefaultFilter(void);
 void lovrGraphicsSetDefaultFilter(TextureFilter filter);
 void lovrGraphicsGetDepthTest(CompareMode* mode, bool* write);
@@ -161,6 +168,8 @@ void lovrGraphicsTranslate(vec3 translation);
 void lovrGraphicsRotate(quat rotation);
 void lovrGraphicsScale(vec3 scale);
 void lovrGraphicsMatrixTransform(mat4 transform);
+float lovrGraphicsGetScreenCoverage(float sphere[4]);
+bool lovrGraphicsCull(float aabb[6], mat4 transform);
 
 // Rendering
 void lovrGraphicsFlush(void);
@@ -181,7 +190,10 @@ void lovrGraphicsSphere(struct Material* material, mat4 transform, int segments)
 void lovrGraphicsSkybox(struct Texture* texture);
 void lovrGraphicsPrint(const char* str, size_t length, mat4 transform, float wrap, HorizontalAlign halign, VerticalAlign valign);
 void lovrGraphicsFill(struct Texture* texture, float u, float v, float w, float h);
-void lovrGraphicsDrawMesh(struct Mesh* mesh, mat4 transform, uint32_t instances, float* pose);
+void lovrGraphicsDrawMesh(struct Mesh* mesh, mat4 transform, uint32_t instances, float* pose, uint32_t boneCount);
+void lovrGraphicsBeginRecording(struct DrawList* list);
+void lovrGraphicsEndRecording(void);
+void lovrGraphicsSubmit(struct DrawList* list, mat4 transform);
 #define lovrGraphicsStencil lovrGpuStencil
 #define lovrGraphicsCompute lovrGpuCompute
 
@@ -194,6 +206,7 @@ typedef struct {
   bool instancedStereo;
   bool multiview;
   bool timers;
+  bool wideDraws;
 } GpuFeatures;
 
 typedef struct {
@@ -210,6 +223,7 @@ typedef struct {
   uint32_t shaderSwitches;
   uint32_t renderPasses;
   uint32_t drawCalls;
+  uint32_t culled;
   uint32_t bufferCount;
   uint32_t textureCount;
   uint64_t bufferMemory;
@@ -236,9 +250,13 @@ void lovrGpuDraw(DrawCommand* draw);
 void lovrGpuStencil(StencilAction action, int replaceValue, StencilCallback callback, void* userdata);
 void lovrGpuPresent(void);
 void lovrGpuDirtyTexture(void);
+void* lovrGpuFence(void);
+void lovrGpuWaitFence(void* fence);
+void lovrGpuDestroyFence(void* fence);
 void lovrGpuResetState(void);
 void lovrGpuTick(const char* label);
 double lovrGpuTock(const char* label);
 const GpuFeatures* lovrGpuGetFeatures(void);
 const GpuLimits* lovrGpuGetLimits(void);
 const GpuStats* lovrGpuGetStats(void);
+void lovrGpuCountCulled(uint32_t count);
@@ -1,10 +1,12 @@
 #include "graphics/material.h"
+#include "graphics/buffer.h"
 #include "graphics/graphics.h"
 #include "graphics/shader.h"
 #include "graphics/texture.h"
-#include "resources/shaders.h"
+#include "math/math.h"
 #include "core/util.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 struct Material {
@@ -13,13 +15,83 @@ struct Material {
   Color colors[MAX_MATERIAL_COLORS];
   struct Texture* textures[MAX_MATERIAL_TEXTURES];
   float transform[9];
+  Buffer* block;
+  bool dirty;
 };
 
+// Byte offsets of the members of lovrMaterialBlock, in declaration order
+static struct {
+  bool initialized;
+  size_t size;
+  int colors[MAX_MATERIAL_COLORS];
+  int transform;
+  int scalars[MAX_MATERIAL_SCALARS];
+} layout;
+
+static void computeLayout() {
+  Uniform uniforms[MAX_MATERIAL_COLORS + 1 + MAX_MATERIAL_SCALARS];
+  arr_uniform_t list = { .data = uniforms, .length = 0 };
+
+  for (int i = 0; i < MAX_MATERIAL_COLORS; i++) {
+    list.data[list.length++] = (Uniform) { .type = UNIFORM_FLOAT, .components = 4, .count = 1 };
+  }
+
+  list.data[list.length++] = (Uniform) { .type = UNIFORM_MATRIX, .components = 3, .count = 1 };
+
+  for (int i = 0; i < MAX_MATERIAL_SCALARS; i++) {
+    list.data[list.length++] = (Uniform) { .type = UNIFORM_FLOAT, .components = 1, .count = 1 };
+  }
+
+  size_t size = lovrShaderComputeUniformLayout(&list);
+  layout.size = ALIGN(size, 16);
+
+  Uniform* uniform = list.data;
+  for (int i = 0; i < MAX_MATERIAL_COLORS; i++) layout.colors[i] = (uniform++)->offset;
+  layout.transform = (uniform++)->offset;
+  for (int i = 0; i < MAX_MATERIAL_SCALARS; i++) layout.scalars[i] = (uniform++)->offset;
+  layout.initialized = true;
+}
+
+// Writes the gamma corrected colors, the transform, and the scalars to the uniform buffer
+static void updateBlock(Material* material) {
+  lovrBufferDiscard(material->block);
+  uint8_t* data = lovrBufferMap(material->block, 0, false);
+
+  for (int i = 0; i < MAX_MATERIAL_COLORS; i++) {
+    Color color = material->colors[i];
+    float* dest = (float*) (data + layout.colors[i]);
+    dest[0] = lovrMathGammaToLinear(color.r);
+    dest[1] = lovrMathGammaToLinear(color.g);
+    dest[2] = lovrMathGammaToLinear(color.b);
+    dest[3] = color.a;
+  }
+
+  // std140 pads each column of a mat3 to a vec4
+  for (int i = 0; i < 3; i++) {
+    memcpy(data + layout.transform + 16 * i, material->transform + 3 * i, 3 * sizeof(float));
+  }
+
+  for (int i = 0; i < MAX_MATERIAL_SCALARS; i++) {
+    memcpy(data + layout.scalars[i], &material->scalars[i], sizeof(float));
+  }
+
+  lovrBufferFlush(material->block, 0, layout.size);
+  lovrBufferUnmap(material->block);
+  material->dirty = false;
+}
+
 Material* lovrMaterialCreate() {
   Material* material = calloc(1, sizeof(Material));
   lovrAssert(material, "Out of memory");
   material->ref = 1;
 
+  if (!layout.initialized) {
+    computeLayout();
+  }
+
+  material->block = lovrBufferCreate(layout.size, NULL, BUFFER_UNIFORM, USAGE_DYNAMIC, false);
+  material->dirty = true;
+
   for (int i = 0; i < MAX_MATERIAL_SCALARS; i++) {
     material->scalars[i] = 1.f;
   }
@@ -42,23 +114,22 @@ void lovrMaterialDestroy(void* ref) {
   for (int i = 0; i < MAX_MATERIAL_TEXTURES; i++) {
     lovrRelease(material->textures[i], lovrTextureDestroy);
   }
+  lovrRelease(material->block, lovrBufferDestroy);
   free(material);
 }
 
 void lovrMaterialBind(Material* material, Shader* shader) {
-  for (int i = 0; i < MAX_MATERIAL_SCALARS; i++) {
-    lovrShaderSetFloats(shader, lovrShaderScalarUniforms[i], &material->scalars[i], 0, 1);
+  if (material->dirty) {
+    updateBlock(material);
   }
 
-  for (int i = 0; i < MAX_MATERIAL_COLORS; i++) {
-    lovrShaderSetColor(shader, lovrShaderColorUniforms[i], material->colors[i]);
-  }
+  int block = lovrShaderGetBuiltinBlockId(shader, BUILTIN_MATERIAL_BLOCK);
+  lovrShaderSetBlockById(shader, block, material->block, 0, layout.size, ACCESS_READ);
 
   for (int i = 0; i < MAX_MATERIAL_TEXTURES; i++) {
-    lovrShaderSetTextures(shader, lovrShaderTextureUniforms[i], &material->textures[i], 0, 1);
+    int id = lovrShaderGetBuiltinUniformId(shader, BUILTIN_DIFFUSE_TEXTURE + i);
+    lovrShaderSetUniformById(shader, id, UNIFORM_SAMPLER, &material->textures[i], 0, 1);
   }
-
-  lovrShaderSetMatrices(shader, "lovrMaterialTransform", material->transform, 0, 9);
 }
 
 float lovrMaterialGetScalar(Material* material, MaterialScalar scalarType) {
@@ -69,6 +140,7 @@ void lovrMaterialSetScalar(Material* material, MaterialScalar scalarType, float
   if (material->scalars[scalarType] != value) {
     lovrGraphicsFlushMaterial(material);
     material->scalars[scalarType] = value;
+    material->dirty = true;
   }
 }
 
@@ -80,6 +152,7 @@ void lovrMaterialSetColor(Material* material, MaterialColor colorType, Color col
   if (memcmp(&material->colors[colorType], &color, 4 * sizeof(float))) {
     lovrGraphicsFlushMaterial(material);
     material->colors[colorType] = color;
+    material->dirty = true;
   }
 }
 
@@ -117,4 +190,5 @@ void lovrMaterialSetTransform(Material* material, float ox, float oy, float sx,
   material->transform[6] = ox;
   material->transform[7] = oy;
   material->transform[8] = 1.f;
+  material->dirty = true;
 }
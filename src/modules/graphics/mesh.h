@@ -43,3 +43,6 @@ void lovrMeshGetDrawRange(Mesh* mesh, uint32_t* start, uint32_t* count);
 void lovrMeshSetDrawRange(Mesh* mesh, uint32_t start, uint32_t count);
 struct Material* lovrMeshGetMaterial(Mesh* mesh);
 void lovrMeshSetMaterial(Mesh* mesh, struct Material* material);
+bool lovrMeshGetBounds(Mesh* mesh, float aabb[6]);
+void lovrMeshSetBounds(Mesh* mesh, float aabb[6]);
+void lovrMeshUpdateBounds(Mesh* mesh, const void* vertices, uint32_t start, uint32_t count);
@@ -4,9 +4,16 @@
 #include "graphics/material.h"
 #include "graphics/mesh.h"
 #include "graphics/texture.h"
+#include "data/blob.h"
 #include "resources/shaders.h"
 #include "core/maf.h"
+#ifndef LOVR_DISABLE_THREAD
+#include "thread/job.h"
+#endif
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <setjmp.h>
 #include <float.h>
 #include <math.h>
 
@@ -14,6 +21,30 @@ typedef struct {
   float properties[3][4];
 } NodeTransform;
 
+// Shared between a Model and the worker parsing its ModelData, so either one can let go first
+typedef struct {
+  uint32_t ref;
+  struct Blob* source;
+  char* path;
+  ModelDataIO* io;
+  ModelData* data;
+  char* error;
+  jmp_buf catch;
+  atomic_uint status; // Only fetch operations are used, the bundled stdatomic shim lacks the rest
+} ModelLoader;
+
+enum {
+  LOAD_PENDING,
+  LOAD_DONE,
+  LOAD_FAILED
+};
+
+typedef struct {
+  uint32_t animation;
+  float time;
+  float alpha;
+} AnimationRequest;
+
 struct Model {
   uint32_t ref;
   struct ModelData* data;
@@ -21,189 +52,579 @@ struct Model {
   struct Mesh** meshes;
   struct Texture** textures;
   struct Material** materials;
-  float* vertices;
-  uint32_t* indices;
+  struct Blob* vertexBlob;
+  struct Blob* indexBlob;
   uint32_t vertexCount;
   uint32_t indexCount;
+  uint32_t* vertexOffsets;
+  float* triangleTransforms;
   NodeTransform* localTransforms;
   float* globalTransforms;
   bool transformsDirty;
+  uint32_t* lodLevels;
+  float* lodSpheres;
+  float* nodeBounds;
+  float* poses;
+  uint32_t* poseOffsets;
+  uint32_t* cursors;
+  float* blendWeights;
+  float* blendProperties;
+  arr_t(AnimationRequest) pendingAnimations;
+  ModelLoader* loader;
+  uint32_t loadedMaterials;
+  uint32_t loadedMeshes;
+  Model* nextLoading;
 };
 
-static void updateGlobalTransform(Model* model, uint32_t nodeIndex, mat4 parent) {
-  mat4 global = model->globalTransforms + 16 * nodeIndex;
-  NodeTransform* local = &model->localTransforms[nodeIndex];
-  vec3 T = local->properties[PROP_TRANSLATION];
-  quat R = local->properties[PROP_ROTATION];
-  vec3 S = local->properties[PROP_SCALE];
+// Bytes of texture and buffer data that loading Models can upload each frame
+#define MODEL_UPLOAD_BUDGET (16 << 20)
 
-  mat4_init(global, parent);
-  mat4_translate(global, T[0], T[1], T[2]);
-  mat4_rotateQuat(global, R);
-  mat4_scale(global, S[0], S[1], S[2]);
+// Queued animations are applied right away past this, so Models that are never drawn don't grow
+#define MAX_PENDING_ANIMATIONS 16
 
-  ModelNode* node = &model->data->nodes[nodeIndex];
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    updateGlobalTransform(model, node->children[i], global);
+static struct {
+  Model* loading;
+} state;
+
+// Fraction of a LOD threshold that the coverage has to move past before switching levels
+#define LOD_HYSTERESIS .1f
+
+static void applyAABB(Model* model, uint32_t start, uint32_t end, float aabb[6]);
+
+static void sampleAnimation(Model* model, uint32_t animationIndex, float time, float alpha) {
+  ModelAnimation* animation = &model->data->animations[animationIndex];
+  time = fmodf(time, animation->duration);
+
+  for (uint32_t i = 0; i < animation->channelCount; i++) {
+    ModelAnimationChannel* channel = &animation->channels[i];
+    NodeTransform* transform = &model->localTransforms[channel->nodeIndex];
+    bool rotate = channel->property == PROP_ROTATION;
+    size_t n = 3 + rotate;
+
+    float property[4];
+    lovrModelDataSampleChannel(channel, time, &model->cursors[channel - model->data->channels], property);
+
+    if (alpha >= 1.f) {
+      memcpy(transform->properties[channel->property], property, n * sizeof(float));
+    } else if (rotate) {
+      quat_slerp(transform->properties[channel->property], property, alpha);
+    } else {
+      vec3_lerp(transform->properties[channel->property], property, alpha);
+    }
   }
 }
 
-static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
-  ModelNode* node = &model->data->nodes[nodeIndex];
-  mat4 globalTransform = model->globalTransforms + 16 * nodeIndex;
-  float poseMatrix[16 * MAX_BONES];
-  float* pose = NULL;
+// Animations are sampled lazily so that lovrModelUpdateMany can do the work on other threads
+static void applyAnimations(Model* model) {
+  for (size_t i = 0; i < model->pendingAnimations.length; i++) {
+    AnimationRequest* request = &model->pendingAnimations.data[i];
+    sampleAnimation(model, request->animation, request->time, request->alpha);
+  }
+
+  arr_clear(&model->pendingAnimations);
+}
+
+static void updateGlobalTransforms(Model* model) {
+  ModelData* data = model->data;
+  for (uint32_t i = 0; i < data->orderedNodeCount; i++) {
+    uint32_t nodeIndex = data->nodeOrder[i];
+    uint32_t parentIndex = data->nodeParents[i];
+    mat4 global = model->globalTransforms + 16 * nodeIndex;
+    NodeTransform* local = &model->localTransforms[nodeIndex];
+    vec3 T = local->properties[PROP_TRANSLATION];
+    quat R = local->properties[PROP_ROTATION];
+    vec3 S = local->properties[PROP_SCALE];
+
+    if (parentIndex == ~0u) {
+      mat4_identity(global);
+    } else {
+      mat4_init(global, model->globalTransforms + 16 * parentIndex);
+    }
+
+    mat4_translate(global, T[0], T[1], T[2]);
+    mat4_rotateQuat(global, R);
+    mat4_scale(global, S[0], S[1], S[2]);
+  }
+}
+
+static void updateTransforms(Model* model) {
+  applyAnimations(model);
+
+  if (!model->transformsDirty) {
+    return;
+  }
+
+  updateGlobalTransforms(model);
+  model->transformsDirty = false;
+
+  // LOD selection uses a bounding sphere around the most detailed level
+  for (uint32_t i = 0; i < model->data->lodCount; i++) {
+    float aabb[6] = { FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX };
+    float* sphere = model->lodSpheres + 4 * i;
+    uint32_t position = model->data->nodePositions[model->data->lods[i].nodes[0]];
+    applyAABB(model, position, model->data->nodeSkips[position], aabb);
+    if (aabb[0] > aabb[1]) {
+      sphere[3] = 0.f;
+    } else {
+      float extent[3] = { (aabb[1] - aabb[0]) / 2.f, (aabb[3] - aabb[2]) / 2.f, (aabb[5] - aabb[4]) / 2.f };
+      sphere[0] = aabb[0] + extent[0];
+      sphere[1] = aabb[2] + extent[1];
+      sphere[2] = aabb[4] + extent[2];
+      sphere[3] = vec3_length(extent);
+    }
+  }
+
+  // Nodes with several primitives are culled as a whole before their primitives are
+  for (uint32_t i = 0; i < model->data->nodeCount; i++) {
+    if (model->data->nodes[i].primitiveCount > 1) {
+      float* aabb = model->nodeBounds + 6 * i;
+      uint32_t position = model->data->nodePositions[i];
+      aabb[0] = aabb[2] = aabb[4] = FLT_MAX;
+      aabb[1] = aabb[3] = aabb[5] = -FLT_MAX;
+      applyAABB(model, position, position + 1, aabb);
+    }
+  }
+
+  // Joint palettes only change with the transforms, so they're computed here instead of per draw
+  for (uint32_t i = 0; i < model->data->nodeCount; i++) {
+    ModelNode* node = &model->data->nodes[i];
+    if (node->skin == ~0u) continue;
 
-  if (node->skin != ~0u) {
     ModelSkin* skin = &model->data->skins[node->skin];
-    pose = poseMatrix;
+    float* pose = model->poses + model->poseOffsets[i];
+    float inverse[16];
+    mat4_init(inverse, model->globalTransforms + 16 * i);
+    mat4_invert(inverse);
 
     for (uint32_t j = 0; j < skin->jointCount; j++) {
       mat4 globalJointTransform = model->globalTransforms + 16 * skin->joints[j];
       mat4 inverseBindMatrix = skin->inverseBindMatrices + 16 * j;
       mat4 jointPose = pose + 16 * j;
 
-      mat4_set(jointPose, globalTransform);
-      mat4_invert(jointPose);
+      mat4_init(jointPose, inverse);
       mat4_mul(jointPose, globalJointTransform);
       mat4_mul(jointPose, inverseBindMatrix);
     }
   }
+}
 
-  for (uint32_t i = 0; i < node->primitiveCount; i++) {
-    lovrGraphicsDrawMesh(model->meshes[node->primitiveIndex + i], globalTransform, instances, pose);
+static uint32_t selectLevel(Model* model, uint32_t lod) {
+  ModelLodGroup* group = &model->data->lods[lod];
+  float* sphere = model->lodSpheres + 4 * lod;
+  uint32_t level = model->lodLevels[lod];
+
+  if (sphere[3] <= 0.f) {
+    return 0;
   }
 
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    renderNode(model, node->children[i], instances);
+  float coverage = lovrGraphicsGetScreenCoverage(sphere);
+
+  while (level > 0 && coverage >= group->coverage[level - 1] * (1.f + LOD_HYSTERESIS)) {
+    level--;
+  }
+
+  while (level < group->levelCount - 1 && coverage < group->coverage[level] * (1.f - LOD_HYSTERESIS)) {
+    level++;
   }
+
+  return model->lodLevels[lod] = level;
 }
 
-Model* lovrModelCreate(ModelData* data) {
-  Model* model = calloc(1, sizeof(Model));
-  lovrAssert(model, "Out of memory");
-  model->ref = 1;
-  model->data = data;
-  lovrRetain(data);
+// Draws the nodes in a range of the node order, skipping over subtrees replaced by a LOD level
+static void renderNodes(Model* model, uint32_t start, uint32_t end, uint32_t instances) {
+  ModelData* data = model->data;
+
+  for (uint32_t i = start; i < end; i++) {
+    uint32_t nodeIndex = data->nodeOrder[i];
+    ModelNode* node = &data->nodes[nodeIndex];
+
+    if (node->lod != ~0u) {
+      uint32_t level = selectLevel(model, node->lod);
+      if (level > 0) {
+        uint32_t position = data->nodePositions[data->lods[node->lod].nodes[level]];
+        renderNodes(model, position, data->nodeSkips[position], instances);
+        i = data->nodeSkips[i] - 1;
+        continue;
+      }
+    }
 
-  // Materials
-  if (data->materialCount > 0) {
-    model->materials = malloc(data->materialCount * sizeof(Material*));
+    mat4 globalTransform = model->globalTransforms + 16 * nodeIndex;
+    float* pose = NULL;
+    uint32_t boneCount = 0;
+
+    if (node->skin != ~0u) {
+      pose = model->poses + model->poseOffsets[nodeIndex];
+      boneCount = data->skins[node->skin].jointCount;
+    } else if (node->primitiveCount > 1 && instances <= 1) {
+      float* aabb = model->nodeBounds + 6 * nodeIndex;
+      if (aabb[0] <= aabb[1] && lovrGraphicsCull(aabb, NULL)) {
+        continue;
+      }
+    }
 
-    if (data->imageCount > 0) {
-      model->textures = calloc(data->imageCount, sizeof(Texture*));
+    for (uint32_t j = 0; j < node->primitiveCount; j++) {
+      lovrGraphicsDrawMesh(model->meshes[node->primitiveIndex + j], globalTransform, instances, pose, boneCount);
     }
+  }
+}
 
-    for (uint32_t i = 0; i < data->materialCount; i++) {
-      Material* material = lovrMaterialCreate();
+// Creates a Material and any Textures it uses for the first time, returning the bytes uploaded
+static size_t createMaterial(Model* model, uint32_t i) {
+  ModelData* data = model->data;
+  size_t size = 0;
+  Material* material = lovrMaterialCreate();
 
-      for (uint32_t j = 0; j < MAX_MATERIAL_SCALARS; j++) {
-        lovrMaterialSetScalar(material, j, data->materials[i].scalars[j]);
-      }
+  for (uint32_t j = 0; j < MAX_MATERIAL_SCALARS; j++) {
+    lovrMaterialSetScalar(material, j, data->materials[i].scalars[j]);
+  }
+
+  for (uint32_t j = 0; j < MAX_MATERIAL_COLORS; j++) {
+    lovrMaterialSetColor(material, j, data->materials[i].colors[j]);
+  }
 
-      for (uint32_t j = 0; j < MAX_MATERIAL_COLORS; j++) {
-        lovrMaterialSetColor(material, j, data->materials[i].colors[j]);
+  for (uint32_t j = 0; j < MAX_MATERIAL_TEXTURES; j++) {
+    uint32_t index = data->materials[i].images[j];
+
+    if (index != ~0u) {
+      if (!model->textures[index]) {
+        Image* image = data->images[index];
+        bool srgb = j == TEXTURE_DIFFUSE || j == TEXTURE_EMISSIVE;
+        model->textures[index] = lovrTextureCreate(TEXTURE_2D, &image, 1, srgb, true, 0);
+        size += image->blob ? image->blob->size : 0;
+        lovrTextureSetFilter(model->textures[index], data->materials[i].filters[j]);
+        lovrTextureSetWrap(model->textures[index], data->materials[i].wraps[j]);
       }
 
-      for (uint32_t j = 0; j < MAX_MATERIAL_TEXTURES; j++) {
-        uint32_t index = data->materials[i].images[j];
+      lovrMaterialSetTexture(material, j, model->textures[index]);
+    }
+  }
 
-        if (index != ~0u) {
-          if (!model->textures[index]) {
-            Image* image = data->images[index];
-            bool srgb = j == TEXTURE_DIFFUSE || j == TEXTURE_EMISSIVE;
-            model->textures[index] = lovrTextureCreate(TEXTURE_2D, &image, 1, srgb, true, 0);
-            lovrTextureSetFilter(model->textures[index], data->materials[i].filters[j]);
-            lovrTextureSetWrap(model->textures[index], data->materials[i].wraps[j]);
-          }
+  model->materials[i] = material;
+  return size;
+}
 
-          lovrMaterialSetTexture(material, j, model->textures[index]);
-        }
+// Creates the Mesh for a primitive and any Buffers it uses for the first time, returning the bytes
+// uploaded
+static size_t createMesh(Model* model, uint32_t i) {
+  ModelData* data = model->data;
+  size_t size = 0;
+  ModelPrimitive* primitive = &data->primitives[i];
+  uint32_t vertexCount = primitive->attributes[ATTR_POSITION] ? primitive->attributes[ATTR_POSITION]->count : 0;
+  model->meshes[i] = lovrMeshCreate(primitive->mode, NULL, vertexCount);
+
+  if (primitive->material != ~0u) {
+    lovrMeshSetMaterial(model->meshes[i], model->materials[primitive->material]);
+  }
+
+  bool setDrawRange = false;
+  for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+    if (primitive->attributes[j]) {
+      ModelAttribute* attribute = primitive->attributes[j];
+
+      if (!model->buffers[attribute->buffer]) {
+        ModelBuffer* buffer = &data->buffers[attribute->buffer];
+        model->buffers[attribute->buffer] = lovrBufferCreate(buffer->size, buffer->data, BUFFER_VERTEX, USAGE_STATIC, false);
+        size += buffer->size;
       }
 
-      model->materials[i] = material;
+      lovrMeshAttachAttribute(model->meshes[i], lovrShaderAttributeNames[j], &(MeshAttribute) {
+        .buffer = model->buffers[attribute->buffer],
+        .offset = attribute->offset,
+        .stride = data->buffers[attribute->buffer].stride,
+        .type = attribute->type,
+        .components = attribute->components,
+        .normalized = attribute->normalized
+      });
+
+      if (!setDrawRange && !primitive->indices) {
+        lovrMeshSetDrawRange(model->meshes[i], 0, attribute->count);
+        setDrawRange = true;
+      }
     }
   }
 
-  // Geometry
-  if (data->primitiveCount > 0) {
-    if (data->bufferCount > 0) {
-      model->buffers = calloc(data->bufferCount, sizeof(Buffer*));
+  lovrMeshAttachAttribute(model->meshes[i], "lovrDrawID", &(MeshAttribute) {
+    .buffer = lovrGraphicsGetIdentityBuffer(),
+    .type = U16,
+    .components = 1,
+    .divisor = 1
+  });
+
+  if (primitive->indices) {
+    ModelAttribute* attribute = primitive->indices;
+
+    if (!model->buffers[attribute->buffer]) {
+      ModelBuffer* buffer = &data->buffers[attribute->buffer];
+      model->buffers[attribute->buffer] = lovrBufferCreate(buffer->size, buffer->data, BUFFER_INDEX, USAGE_STATIC, false);
+      size += buffer->size;
     }
 
-    model->meshes = calloc(data->primitiveCount, sizeof(Mesh*));
-    for (uint32_t i = 0; i < data->primitiveCount; i++) {
-      ModelPrimitive* primitive = &data->primitives[i];
-      uint32_t vertexCount = primitive->attributes[ATTR_POSITION] ? primitive->attributes[ATTR_POSITION]->count : 0;
-      model->meshes[i] = lovrMeshCreate(primitive->mode, NULL, vertexCount);
+    size_t indexSize = attribute->type == U16 ? 2 : 4;
+    lovrMeshSetIndexBuffer(model->meshes[i], model->buffers[attribute->buffer], attribute->count, indexSize, attribute->offset);
+    lovrMeshSetDrawRange(model->meshes[i], 0, attribute->count);
+  }
 
-      if (primitive->material != ~0u) {
-        lovrMeshSetMaterial(model->meshes[i], model->materials[primitive->material]);
-      }
+  ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+  if (position && position->hasMin && position->hasMax) {
+    float* min = position->min;
+    float* max = position->max;
+    lovrMeshSetBounds(model->meshes[i], (float[6]) { min[0], max[0], min[1], max[1], min[2], max[2] });
+  }
 
-      bool setDrawRange = false;
-      for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
-        if (primitive->attributes[j]) {
-          ModelAttribute* attribute = primitive->attributes[j];
-
-          if (!model->buffers[attribute->buffer]) {
-            ModelBuffer* buffer = &data->buffers[attribute->buffer];
-            model->buffers[attribute->buffer] = lovrBufferCreate(buffer->size, buffer->data, BUFFER_VERTEX, USAGE_STATIC, false);
-          }
-
-          lovrMeshAttachAttribute(model->meshes[i], lovrShaderAttributeNames[j], &(MeshAttribute) {
-            .buffer = model->buffers[attribute->buffer],
-            .offset = attribute->offset,
-            .stride = data->buffers[attribute->buffer].stride,
-            .type = attribute->type,
-            .components = attribute->components,
-            .normalized = attribute->normalized
-          });
-
-          if (!setDrawRange && !primitive->indices) {
-            lovrMeshSetDrawRange(model->meshes[i], 0, attribute->count);
-            setDrawRange = true;
-          }
-        }
-      }
+  return size;
+}
 
-      lovrMeshAttachAttribute(model->meshes[i], "lovrDrawID", &(MeshAttribute) {
-        .buffer = lovrGraphicsGetIdentityBuffer(),
-        .type = U8,
-        .components = 1,
-        .divisor = 1
-      });
+static void allocateObjects(Model* model) {
+  ModelData* data = model->data;
 
-      if (primitive->indices) {
-        ModelAttribute* attribute = primitive->indices;
+  if (data->materialCount > 0) {
+    model->materials = calloc(data->materialCount, sizeof(Material*));
+    lovrAssert(model->materials, "Out of memory");
+  }
 
-        if (!model->buffers[attribute->buffer]) {
-          ModelBuffer* buffer = &data->buffers[attribute->buffer];
-          model->buffers[attribute->buffer] = lovrBufferCreate(buffer->size, buffer->data, BUFFER_INDEX, USAGE_STATIC, false);
-        }
+  if (data->imageCount > 0) {
+    model->textures = calloc(data->imageCount, sizeof(Texture*));
+    lovrAssert(model->textures, "Out of memory");
+  }
 
-        size_t indexSize = attribute->type == U16 ? 2 : 4;
-        lovrMeshSetIndexBuffer(model->meshes[i], model->buffers[attribute->buffer], attribute->count, indexSize, attribute->offset);
-        lovrMeshSetDrawRange(model->meshes[i], 0, attribute->count);
-      }
+  if (data->bufferCount > 0) {
+    model->buffers = calloc(data->bufferCount, sizeof(Buffer*));
+    lovrAssert(model->buffers, "Out of memory");
+  }
+
+  if (data->primitiveCount > 0) {
+    model->meshes = calloc(data->primitiveCount, sizeof(Mesh*));
+    lovrAssert(model->meshes, "Out of memory");
+  }
+}
+
+static void finishModel(Model* model) {
+  ModelData* data = model->data;
+
+  // Each skinned node gets its own joint palette, since it depends on the node's transform
+  if (data->skinCount > 0) {
+    uint32_t poseCount = 0;
+    model->poseOffsets = malloc(data->nodeCount * sizeof(uint32_t));
+    lovrAssert(model->poseOffsets, "Out of memory");
+    for (uint32_t i = 0; i < data->nodeCount; i++) {
+      uint32_t skin = data->nodes[i].skin;
+      model->poseOffsets[i] = 16 * poseCount;
+      poseCount += skin == ~0u ? 0 : data->skins[skin].jointCount;
     }
+
+    model->poses = malloc(16 * sizeof(float) * MAX(poseCount, 1));
+    lovrAssert(model->poses, "Out of memory");
   }
 
-  // Ensure skin bone count doesn't exceed the maximum supported limit
-  for (uint32_t i = 0; i < data->skinCount; i++) {
-    uint32_t jointCount = data->skins[i].jointCount;
-    lovrAssert(jointCount < MAX_BONES, "ModelData skin '%d' has too many joints (%d, max is %d)", i, jointCount, MAX_BONES);
+  if (data->channelCount > 0) {
+    model->cursors = calloc(data->channelCount, sizeof(uint32_t));
+    lovrAssert(model->cursors, "Out of memory");
   }
 
   model->localTransforms = malloc(sizeof(NodeTransform) * data->nodeCount);
   model->globalTransforms = malloc(16 * sizeof(float) * data->nodeCount);
+  model->nodeBounds = malloc(6 * sizeof(float) * MAX(data->nodeCount, 1));
+  lovrAssert(model->nodeBounds, "Out of memory");
+
+  if (data->lodCount > 0) {
+    model->lodLevels = calloc(data->lodCount, sizeof(uint32_t));
+    model->lodSpheres = malloc(4 * sizeof(float) * data->lodCount);
+    lovrAssert(model->lodLevels && model->lodSpheres, "Out of memory");
+  }
+
   lovrModelResetPose(model);
+}
+
+static void destroyLoader(void* ref) {
+  ModelLoader* loader = ref;
+  lovrRelease(loader->source, lovrBlobDestroy);
+  lovrRelease(loader->data, lovrModelDataDestroy);
+  free(loader->path);
+  free(loader->error);
+  free(loader);
+}
+
+static void onLoaderError(void* userdata, const char* format, va_list args) {
+  ModelLoader* loader = userdata;
+  char message[1024];
+  vsnprintf(message, sizeof(message), format, args);
+  size_t length = strlen(message);
+  loader->error = malloc(length + 1);
+  if (loader->error) memcpy(loader->error, message, length + 1);
+  longjmp(loader->catch, 1);
+}
+
+static void loadModelData(void* context, uint32_t index) {
+  ModelLoader* loader = context;
+  errorFn* callback = lovrErrorCallback;
+  void* userdata = lovrErrorUserdata;
+  lovrSetErrorCallback(onLoaderError, loader);
+
+  if (setjmp(loader->catch) == 0) {
+    if (!loader->source) {
+      size_t size;
+      void* contents = loader->io(loader->path, &size);
+      lovrAssert(contents, "Could not read Model from '%s'", loader->path);
+      loader->source = lovrBlobCreate(contents, size, loader->path);
+    }
+
+    loader->data = lovrModelDataCreate(loader->source, loader->io);
+    atomic_fetch_add(&loader->status, LOAD_DONE);
+  } else {
+    atomic_fetch_add(&loader->status, LOAD_FAILED);
+  }
+
+  lovrSetErrorCallback(callback, userdata);
+  lovrRelease(loader, destroyLoader);
+}
+
+// Returns true once the Model is done loading, successfully or not
+static bool updateLoader(Model* model, size_t* budget) {
+  ModelLoader* loader = model->loader;
+
+  if (!model->data) {
+    uint32_t status = atomic_fetch_add(&loader->status, 0);
+
+    if (status != LOAD_DONE) {
+      return status == LOAD_FAILED;
+    }
+
+    model->data = loader->data;
+    loader->data = NULL;
+    allocateObjects(model);
+  }
+
+  ModelData* data = model->data;
+
+  // Materials go first since meshes refer to them.  At least one object is created each frame.
+  while (model->loadedMaterials < data->materialCount && *budget > 0) {
+    size_t size = createMaterial(model, model->loadedMaterials++);
+    *budget -= MIN(size, *budget);
+  }
+
+  while (model->loadedMaterials == data->materialCount && model->loadedMeshes < data->primitiveCount && *budget > 0) {
+    size_t size = createMesh(model, model->loadedMeshes++);
+    *budget -= MIN(size, *budget);
+  }
+
+  if (model->loadedMaterials < data->materialCount || model->loadedMeshes < data->primitiveCount) {
+    return false;
+  }
+
+  lovrRelease(model->loader, destroyLoader);
+  model->loader = NULL;
+  finishModel(model);
+  return true;
+}
+
+static void checkLoaded(Model* model) {
+  if (model->loader) {
+    lovrModelIsReady(model);
+    lovrThrow("Model has not finished loading");
+  }
+}
+
+Model* lovrModelCreate(ModelData* data) {
+  Model* model = calloc(1, sizeof(Model));
+  lovrAssert(model, "Out of memory");
+  model->ref = 1;
+  model->data = data;
+  lovrRetain(data);
+  arr_init(&model->pendingAnimations, realloc);
+  allocateObjects(model);
+
+  for (uint32_t i = 0; i < data->materialCount; i++) {
+    createMaterial(model, i);
+  }
+
+  for (uint32_t i = 0; i < data->primitiveCount; i++) {
+    createMesh(model, i);
+  }
+
+  finishModel(model);
+  return model;
+}
+
+// Parses the ModelData on a worker thread, the GPU objects are created over several frames by
+// lovrModelUpdateLoading.  Either a Blob or a path to read with the io callback is required.
+Model* lovrModelCreateAsync(struct Blob* source, const char* path, ModelDataIO* io) {
+  Model* model = calloc(1, sizeof(Model));
+  ModelLoader* loader = calloc(1, sizeof(ModelLoader));
+  lovrAssert(model && loader, "Out of memory");
+  model->ref = 1;
+  arr_init(&model->pendingAnimations, realloc);
+
+  loader->ref = 2;
+  loader->source = source;
+  loader->io = io;
+  lovrRetain(source);
+
+  if (path) {
+    size_t length = strlen(path);
+    loader->path = malloc(length + 1);
+    lovrAssert(loader->path, "Out of memory");
+    memcpy(loader->path, path, length + 1);
+  }
+
+  model->loader = loader;
+  model->nextLoading = state.loading;
+  state.loading = model;
+
+#ifndef LOVR_DISABLE_THREAD
+  lovrJobSubmit(loadModelData, loader);
+#else
+  loadModelData(loader, 0);
+#endif
+
   return model;
 }
 
+void lovrModelUpdateLoading() {
+  size_t budget = MODEL_UPLOAD_BUDGET;
+  Model** link = &state.loading;
+  while (*link && budget > 0) {
+    Model* model = *link;
+    if (updateLoader(model, &budget)) {
+      *link = model->nextLoading;
+      model->nextLoading = NULL;
+    } else {
+      link = &model->nextLoading;
+    }
+  }
+}
+
+bool lovrModelIsReady(Model* model) {
+  if (model->loader && atomic_fetch_add(&model->loader->status, 0) == LOAD_FAILED) {
+    lovrThrow("Could not load Model: %s", model->loader->error ? model->loader->error : "Out of memory");
+  }
+
+  return !model->loader;
+}
+
+float lovrModelGetProgress(Model* model) {
+  if (!lovrModelIsReady(model) && !model->data) {
+    return 0.f;
+  }
+
+  uint32_t total = 1 + model->data->materialCount + model->data->primitiveCount;
+  uint32_t loaded = 1 + model->loadedMaterials + model->loadedMeshes;
+  return model->loader ? (float) loaded / total : 1.f;
+}
+
 void lovrModelDestroy(void* ref) {
   Model* model = ref;
 
+  if (model->loader) {
+    for (Model** link = &state.loading; *link; link = &(*link)->nextLoading) {
+      if (*link == model) {
+        *link = model->nextLoading;
+        break;
+      }
+    }
+
+    lovrRelease(model->loader, destroyLoader);
+  }
+
   if (model->buffers) {
     for (uint32_t i = 0; i < model->data->bufferCount; i++) {
       lovrRelease(model->buffers[i], lovrBufferDestroy);
@@ -233,24 +654,39 @@ void lovrModelDestroy(void* ref) {
   }
 
   lovrRelease(model->data, lovrModelDataDestroy);
+  lovrRelease(model->vertexBlob, lovrBlobDestroy);
+  lovrRelease(model->indexBlob, lovrBlobDestroy);
+  free(model->vertexOffsets);
+  free(model->triangleTransforms);
   free(model->globalTransforms);
   free(model->localTransforms);
+  free(model->lodLevels);
+  free(model->lodSpheres);
+  free(model->nodeBounds);
+  free(model->poses);
+  free(model->poseOffsets);
+  free(model->cursors);
+  free(model->blendWeights);
+  free(model->blendProperties);
+  arr_free(&model->pendingAnimations);
   free(model);
 }
 
 ModelData* lovrModelGetModelData(Model* model) {
+  checkLoaded(model);
   return model->data;
 }
 
 void lovrModelDraw(Model* model, mat4 transform, uint32_t instances) {
-  if (model->transformsDirty) {
-    updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-    model->transformsDirty = false;
+  if (model->loader) {
+    return;
   }
 
+  updateTransforms(model);
+
   lovrGraphicsPush();
   lovrGraphicsMatrixTransform(transform);
-  renderNode(model, model->data->rootNode, instances);
+  renderNodes(model, 0, model->data->sceneNodeCount, instances);
   lovrGraphicsPop();
 }
 
@@ -259,74 +695,106 @@ void lovrModelAnimate(Model* model, uint32_t animationIndex, float time, float a
     return;
   }
 
+  checkLoaded(model);
   lovrAssert(animationIndex < model->data->animationCount, "Invalid animation index '%d' (Model only has %d animations)", animationIndex, model->data->animationCount);
-  ModelAnimation* animation = &model->data->animations[animationIndex];
-  time = fmodf(time, animation->duration);
 
-  for (uint32_t i = 0; i < animation->channelCount; i++) {
-    ModelAnimationChannel* channel = &animation->channels[i];
-    uint32_t nodeIndex = channel->nodeIndex;
-    NodeTransform* transform = &model->localTransforms[nodeIndex];
+  if (model->pendingAnimations.length >= MAX_PENDING_ANIMATIONS) {
+    applyAnimations(model);
+  }
 
-    uint32_t keyframe = 0;
-    while (keyframe < channel->keyframeCount && channel->times[keyframe] < time) {
-      keyframe++;
+  arr_push(&model->pendingAnimations, ((AnimationRequest) { animationIndex, time, alpha }));
+  model->transformsDirty = true;
+}
+
+// Updates the transforms of several models at once, spreading them across worker threads
+static void updateModel(void* context, uint32_t index) {
+  Model* model = ((Model**) context)[index];
+  if (!model->loader) {
+    updateTransforms(model);
+  }
+}
+
+void lovrModelUpdateMany(Model** models, uint32_t count) {
+#ifndef LOVR_DISABLE_THREAD
+  lovrJobRun(updateModel, models, count);
+#else
+  for (uint32_t i = 0; i < count; i++) {
+    updateModel(models, i);
+  }
+#endif
+}
+
+// Samples several animations and blends them by weight, then applies the result to the nodes in
+// one pass.  Like lovrModelAnimate, a total weight below 1 blends with the current pose.
+void lovrModelAnimateMany(Model* model, uint32_t* animations, float* times, float* weights, uint32_t count) {
+  checkLoaded(model);
+  ModelData* data = model->data;
+  applyAnimations(model);
+
+  if (!model->blendWeights) {
+    model->blendWeights = malloc(3 * data->nodeCount * sizeof(float));
+    model->blendProperties = malloc(3 * data->nodeCount * 4 * sizeof(float));
+    lovrAssert(model->blendWeights && model->blendProperties, "Out of memory");
+  }
+
+  memset(model->blendWeights, 0, 3 * data->nodeCount * sizeof(float));
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (weights[i] <= 0.f) {
+      continue;
     }
 
-    float property[4];
-    bool rotate = channel->property == PROP_ROTATION;
-    size_t n = 3 + rotate;
-    float* (*lerp)(float* a, float* b, float t) = rotate ? quat_slerp : vec3_lerp;
+    lovrAssert(animations[i] < data->animationCount, "Invalid animation index '%d' (Model only has %d animations)", animations[i], data->animationCount);
+    ModelAnimation* animation = &data->animations[animations[i]];
+    float time = fmodf(times[i], animation->duration);
 
-    if (keyframe == 0 || keyframe >= channel->keyframeCount) {
-      size_t index = MIN(keyframe, channel->keyframeCount - 1);
+    for (uint32_t j = 0; j < animation->channelCount; j++) {
+      ModelAnimationChannel* channel = &animation->channels[j];
+      uint32_t slot = 3 * channel->nodeIndex + channel->property;
+      float* sum = model->blendProperties + 4 * slot;
+      float weight = weights[i];
 
-      // For cubic interpolation, each keyframe has 3 parts, and the actual data is in the middle (*3, +1)
-      if (channel->smoothing == SMOOTH_CUBIC) {
-        index = 3 * index + 1;
+      float property[4];
+      lovrModelDataSampleChannel(channel, time, &model->cursors[channel - data->channels], property);
+
+      if (model->blendWeights[slot] == 0.f) {
+        memset(sum, 0, 4 * sizeof(float));
       }
 
-      memcpy(property, channel->data + index * n, n * sizeof(float));
-    } else {
-      float t1 = channel->times[keyframe - 1];
-      float t2 = channel->times[keyframe];
-      float z = (time - t1) / (t2 - t1);
-
-      switch (channel->smoothing) {
-        case SMOOTH_STEP:
-          memcpy(property, channel->data + (z >= .5f ? keyframe : keyframe - 1) * n, n * sizeof(float));
-          break;
-        case SMOOTH_LINEAR:
-          memcpy(property, channel->data + (keyframe - 1) * n, n * sizeof(float));
-          lerp(property, channel->data + keyframe * n, z);
-          break;
-        case SMOOTH_CUBIC: {
-          size_t stride = 3 * n;
-          float* p0 = channel->data + (keyframe - 1) * stride + 1 * n;
-          float* m0 = channel->data + (keyframe - 1) * stride + 2 * n;
-          float* p1 = channel->data + (keyframe - 0) * stride + 1 * n;
-          float* m1 = channel->data + (keyframe - 0) * stride + 0 * n;
-          float dt = t2 - t1;
-          float z2 = z * z;
-          float z3 = z2 * z;
-          float a = 2.f * z3 - 3.f * z2 + 1.f;
-          float b = 2.f * z3 - 3.f * z2 + 1.f;
-          float c = (-2.f * z3 + 3.f * z2);
-          float d = (z3 * -z2) * dt;
-          for (size_t j = 0; j < n; j++) {
-            property[j] = a * p0[j] + b * m0[j] + c * p1[j] + d * m1[j];
-          }
-          break;
-        }
-        default:
-          break;
+      // Rotations are summed in the same hemisphere and normalized later
+      if (channel->property == PROP_ROTATION) {
+        float dot = sum[0] * property[0] + sum[1] * property[1] + sum[2] * property[2] + sum[3] * property[3];
+        float sign = dot < 0.f ? -1.f : 1.f;
+        for (int k = 0; k < 4; k++) sum[k] += property[k] * weight * sign;
+      } else {
+        for (int k = 0; k < 3; k++) sum[k] += property[k] * weight;
       }
+
+      model->blendWeights[slot] += weight;
     }
+  }
 
-    if (alpha >= 1.f) {
-      memcpy(transform->properties[channel->property], property, n * sizeof(float));
+  for (uint32_t slot = 0; slot < 3 * data->nodeCount; slot++) {
+    float weight = model->blendWeights[slot];
+    if (weight <= 0.f) continue;
+
+    float* sum = model->blendProperties + 4 * slot;
+    float* target = model->localTransforms[slot / 3].properties[slot % 3];
+
+    if (slot % 3 == PROP_ROTATION) {
+      quat_normalize(sum);
+      if (weight >= 1.f) {
+        quat_init(target, sum);
+      } else {
+        quat_slerp(target, sum, weight);
+      }
     } else {
-      lerp(transform->properties[channel->property], property, alpha);
+      vec3_scale(sum, 1.f / weight);
+      if (weight >= 1.f) {
+        vec3_init(target, sum);
+      } else {
+        vec3_lerp(target, sum, weight);
+      }
     }
   }
 
@@ -334,15 +802,14 @@ void lovrModelAnimate(Model* model, uint32_t animationIndex, float time, float a
 }
 
 void lovrModelGetNodePose(Model* model, uint32_t nodeIndex, float position[4], float rotation[4], CoordinateSpace space) {
+  checkLoaded(model);
   lovrAssert(nodeIndex < model->data->nodeCount, "Invalid node index '%d' (Model only has %d nodes)", nodeIndex, model->data->nodeCount);
   if (space == SPACE_LOCAL) {
+    applyAnimations(model);
     vec3_init(position, model->localTransforms[nodeIndex].properties[PROP_TRANSLATION]);
     quat_init(rotation, model->localTransforms[nodeIndex].properties[PROP_ROTATION]);
   } else {
-    if (model->transformsDirty) {
-      updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-      model->transformsDirty = false;
-    }
+    updateTransforms(model);
 
     mat4_getPosition(model->globalTransforms + 16 * nodeIndex, position);
     mat4_getOrientation(model->globalTransforms + 16 * nodeIndex, rotation);
@@ -354,7 +821,9 @@ void lovrModelPose(Model* model, uint32_t nodeIndex, float position[4], float ro
     return;
   }
 
+  checkLoaded(model);
   lovrAssert(nodeIndex < model->data->nodeCount, "Invalid node index '%d' (Model only has %d node)", nodeIndex + 1, model->data->nodeCount, model->data->nodeCount == 1 ? "" : "s");
+  applyAnimations(model);
   NodeTransform* transform = &model->localTransforms[nodeIndex];
   if (alpha >= 1.f) {
     vec3_init(transform->properties[PROP_TRANSLATION], position);
@@ -367,6 +836,9 @@ void lovrModelPose(Model* model, uint32_t nodeIndex, float position[4], float ro
 }
 
 void lovrModelResetPose(Model* model) {
+  checkLoaded(model);
+  arr_clear(&model->pendingAnimations);
+
   for (uint32_t i = 0; i < model->data->nodeCount; i++) {
     if (model->data->nodes[i].matrix) {
       mat4_getPosition(model->data->nodes[i].transform.matrix, model->localTransforms[i].properties[PROP_TRANSLATION]);
@@ -383,62 +855,60 @@ void lovrModelResetPose(Model* model) {
 }
 
 Material* lovrModelGetMaterial(Model* model, uint32_t material) {
+  checkLoaded(model);
   lovrAssert(material < model->data->materialCount, "Invalid material index '%d' (Model only has %d material%s)", material + 1, model->data->materialCount, model->data->materialCount == 1 ? "" : "s");
   return model->materials[material];
 }
 
-static void applyAABB(Model* model, uint32_t nodeIndex, float aabb[6]) {
-  ModelNode* node = &model->data->nodes[nodeIndex];
-
-  for (uint32_t i = 0; i < node->primitiveCount; i++) {
-    ModelAttribute* position = model->data->primitives[node->primitiveIndex + i].attributes[ATTR_POSITION];
-    if (position && position->hasMin && position->hasMax) {
-      mat4 m = model->globalTransforms + 16 * nodeIndex;
-
-      float xa[3] = { position->min[0] * m[0], position->min[0] * m[1], position->min[0] * m[2] };
-      float xb[3] = { position->max[0] * m[0], position->max[0] * m[1], position->max[0] * m[2] };
-
-      float ya[3] = { position->min[1] * m[4], position->min[1] * m[5], position->min[1] * m[6] };
-      float yb[3] = { position->max[1] * m[4], position->max[1] * m[5], position->max[1] * m[6] };
-
-      float za[3] = { position->min[2] * m[8], position->min[2] * m[9], position->min[2] * m[10] };
-      float zb[3] = { position->max[2] * m[8], position->max[2] * m[9], position->max[2] * m[10] };
-
-      float min[3] = {
-        MIN(xa[0], xb[0]) + MIN(ya[0], yb[0]) + MIN(za[0], zb[0]) + m[12],
-        MIN(xa[1], xb[1]) + MIN(ya[1], yb[1]) + MIN(za[1], zb[1]) + m[13],
-        MIN(xa[2], xb[2]) + MIN(ya[2], yb[2]) + MIN(za[2], zb[2]) + m[14]
-      };
-
-      float max[3] = {
-        MAX(xa[0], xb[0]) + MAX(ya[0], yb[0]) + MAX(za[0], zb[0]) + m[12],
-        MAX(xa[1], xb[1]) + MAX(ya[1], yb[1]) + MAX(za[1], zb[1]) + m[13],
-        MAX(xa[2], xb[2]) + MAX(ya[2], yb[2]) + MAX(za[2], zb[2]) + m[14]
-      };
-
-      aabb[0] = MIN(aabb[0], min[0]);
-      aabb[1] = MAX(aabb[1], max[0]);
-      aabb[2] = MIN(aabb[2], min[1]);
-      aabb[3] = MAX(aabb[3], max[1]);
-      aabb[4] = MIN(aabb[4], min[2]);
-      aabb[5] = MAX(aabb[5], max[2]);
+static void applyAABB(Model* model, uint32_t start, uint32_t end, float aabb[6]) {
+  for (uint32_t n = start; n < end; n++) {
+    uint32_t nodeIndex = model->data->nodeOrder[n];
+    ModelNode* node = &model->data->nodes[nodeIndex];
+
+    for (uint32_t i = 0; i < node->primitiveCount; i++) {
+      ModelAttribute* position = model->data->primitives[node->primitiveIndex + i].attributes[ATTR_POSITION];
+      if (position && position->hasMin && position->hasMax) {
+        mat4 m = model->globalTransforms + 16 * nodeIndex;
+
+        float xa[3] = { position->min[0] * m[0], position->min[0] * m[1], position->min[0] * m[2] };
+        float xb[3] = { position->max[0] * m[0], position->max[0] * m[1], position->max[0] * m[2] };
+
+        float ya[3] = { position->min[1] * m[4], position->min[1] * m[5], position->min[1] * m[6] };
+        float yb[3] = { position->max[1] * m[4], position->max[1] * m[5], position->max[1] * m[6] };
+
+        float za[3] = { position->min[2] * m[8], position->min[2] * m[9], position->min[2] * m[10] };
+        float zb[3] = { position->max[2] * m[8], position->max[2] * m[9], position->max[2] * m[10] };
+
+        float min[3] = {
+          MIN(xa[0], xb[0]) + MIN(ya[0], yb[0]) + MIN(za[0], zb[0]) + m[12],
+          MIN(xa[1], xb[1]) + MIN(ya[1], yb[1]) + MIN(za[1], zb[1]) + m[13],
+          MIN(xa[2], xb[2]) + MIN(ya[2], yb[2]) + MIN(za[2], zb[2]) + m[14]
+        };
+
+        float max[3] = {
+          MAX(xa[0], xb[0]) + MAX(ya[0], yb[0]) + MAX(za[0], zb[0]) + m[12],
+          MAX(xa[1], xb[1]) + MAX(ya[1], yb[1]) + MAX(za[1], zb[1]) + m[13],
+          MAX(xa[2], xb[2]) + MAX(ya[2], yb[2]) + MAX(za[2], zb[2]) + m[14]
+        };
+
+        aabb[0] = MIN(aabb[0], min[0]);
+        aabb[1] = MAX(aabb[1], max[0]);
+        aabb[2] = MIN(aabb[2], min[1]);
+        aabb[3] = MAX(aabb[3], max[1]);
+        aabb[4] = MIN(aabb[4], min[2]);
+        aabb[5] = MAX(aabb[5], max[2]);
+      }
     }
   }
-
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    applyAABB(model, node->children[i], aabb);
-  }
 }
 
 void lovrModelGetAABB(Model* model, float aabb[6]) {
-  if (model->transformsDirty) {
-    updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-    model->transformsDirty = false;
-  }
+  checkLoaded(model);
+  updateTransforms(model);
 
   aabb[0] = aabb[2] = aabb[4] = FLT_MAX;
   aabb[1] = aabb[3] = aabb[5] = -FLT_MAX;
-  applyAABB(model, model->data->rootNode, aabb);
+  applyAABB(model, 0, model->data->sceneNodeCount, aabb);
 }
 
 static void countVertices(Model* model, uint32_t nodeIndex, uint32_t* vertexCount, uint32_t* indexCount) {
@@ -448,19 +918,15 @@ static void countVertices(Model* model, uint32_t nodeIndex, uint32_t* vertexCoun
     ModelPrimitive* primitive = &model->data->primitives[node->primitiveIndex + i];
     ModelAttribute* positions = primitive->attributes[ATTR_POSITION];
     ModelAttribute* indices = primitive->indices;
-    uint32_t count = positions ? positions->count : 0;
-    *vertexCount += count;
-    *indexCount += indices ? indices->count : count;
-  }
-
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    countVertices(model, node->children[i], vertexCount, indexCount);
+    if (!positions) continue;
+    *vertexCount += positions->count;
+    *indexCount += indices ? indices->count : positions->count;
   }
 }
 
-static void collectVertices(Model* model, uint32_t nodeIndex, float** vertices, uint32_t** indices, uint32_t* baseIndex) {
+static void collectIndices(Model* model, uint32_t nodeIndex, uint32_t** indices) {
   ModelNode* node = &model->data->nodes[nodeIndex];
-  mat4 transform = model->globalTransforms + 16 * nodeIndex;
+  uint32_t baseIndex = model->vertexOffsets[nodeIndex];
 
   for (uint32_t i = 0; i < node->primitiveCount; i++) {
     ModelPrimitive* primitive = &model->data->primitives[node->primitiveIndex + i];
@@ -468,67 +934,111 @@ static void collectVertices(Model* model, uint32_t nodeIndex, float** vertices,
     ModelAttribute* positions = primitive->attributes[ATTR_POSITION];
     if (!positions) continue;
 
-    ModelBuffer* buffer = &model->data->buffers[positions->buffer];
-    char* data = (char*) buffer->data + positions->offset;
-    size_t stride = buffer->stride == 0 ? 3 * sizeof(float) : buffer->stride;
-
-    for (uint32_t j = 0; j < positions->count; j++) {
-      float v[4];
-      memcpy(v, data, 3 * sizeof(float));
-      mat4_transform(transform, v);
-      memcpy(*vertices, v, 3 * sizeof(float));
-      *vertices += 3;
-      data += stride;
-    }
-
     ModelAttribute* index = primitive->indices;
     if (index) {
       AttributeType type = index->type;
       lovrAssert(type == U16 || type == U32, "Unreachable");
 
-      buffer = &model->data->buffers[index->buffer];
-      data = (char*) buffer->data + index->offset;
+      ModelBuffer* buffer = &model->data->buffers[index->buffer];
+      char* data = (char*) buffer->data + index->offset;
       size_t stride = buffer->stride == 0 ? (type == U16 ? 2 : 4) : buffer->stride;
 
       for (uint32_t j = 0; j < index->count; j++) {
-        **indices = (type == U16 ? ((uint32_t) *(uint16_t*) data) : *(uint32_t*) data) + *baseIndex;
+        **indices = (type == U16 ? ((uint32_t) *(uint16_t*) data) : *(uint32_t*) data) + baseIndex;
         *indices += 1;
         data += stride;
       }
     } else {
       for (uint32_t j = 0; j < positions->count; j++) {
-        **indices = j + *baseIndex;
+        **indices = j + baseIndex;
         *indices += 1;
       }
     }
 
-    *baseIndex += positions->count;
+    baseIndex += positions->count;
   }
+}
 
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    collectVertices(model, node->children[i], vertices, indices, baseIndex);
+static void collectVertices(Model* model, uint32_t nodeIndex, float* vertices) {
+  ModelNode* node = &model->data->nodes[nodeIndex];
+  mat4 transform = model->globalTransforms + 16 * nodeIndex;
+
+  for (uint32_t i = 0; i < node->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->data->primitives[node->primitiveIndex + i];
+
+    ModelAttribute* positions = primitive->attributes[ATTR_POSITION];
+    if (!positions) continue;
+
+    ModelBuffer* buffer = &model->data->buffers[positions->buffer];
+    char* data = (char*) buffer->data + positions->offset;
+    size_t stride = buffer->stride == 0 ? 3 * sizeof(float) : buffer->stride;
+
+    for (uint32_t j = 0; j < positions->count; j++) {
+      float v[4];
+      memcpy(v, data, 3 * sizeof(float));
+      mat4_transform(transform, v);
+      memcpy(vertices, v, 3 * sizeof(float));
+      vertices += 3;
+      data += stride;
+    }
   }
 }
 
-void lovrModelGetTriangles(Model* model, float** vertices, uint32_t* vertexCount, uint32_t** indices, uint32_t* indexCount) {
-  if (model->transformsDirty) {
-    updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-    model->transformsDirty = false;
+// The triangles are cached, and only the nodes that moved since the last update get transformed
+static void updateTriangles(Model* model) {
+  checkLoaded(model);
+  ModelData* data = model->data;
+  updateTransforms(model);
+
+  if (!model->vertexBlob) {
+    model->vertexOffsets = calloc(data->nodeCount, sizeof(uint32_t));
+    model->triangleTransforms = malloc(16 * sizeof(float) * data->nodeCount);
+    lovrAssert((model->vertexOffsets && model->triangleTransforms) || data->nodeCount == 0, "Out of memory");
+
+    for (uint32_t i = 0; i < data->sceneNodeCount; i++) {
+      model->vertexOffsets[data->nodeOrder[i]] = model->vertexCount;
+      countVertices(model, data->nodeOrder[i], &model->vertexCount, &model->indexCount);
+    }
+
+    float* vertices = malloc(MAX(model->vertexCount, 1) * 3 * sizeof(float));
+    uint32_t* indices = malloc(MAX(model->indexCount, 1) * sizeof(uint32_t));
+    lovrAssert(vertices && indices, "Out of memory");
+    model->vertexBlob = lovrBlobCreate(vertices, model->vertexCount * 3 * sizeof(float), "Model vertices");
+    model->indexBlob = lovrBlobCreate(indices, model->indexCount * sizeof(uint32_t), "Model indices");
+
+    for (uint32_t i = 0; i < data->sceneNodeCount; i++) {
+      collectIndices(model, data->nodeOrder[i], &indices);
+    }
+
+    // NaN never compares equal to a real transform, so every node gets transformed the first time
+    memset(model->triangleTransforms, 0xff, 16 * sizeof(float) * data->nodeCount);
   }
 
-  if (!model->vertices) {
-    countVertices(model, model->data->rootNode, &model->vertexCount, &model->indexCount);
-    model->vertices = malloc(model->vertexCount * 3 * sizeof(float));
-    model->indices = malloc(model->indexCount * sizeof(uint32_t));
-    lovrAssert(model->vertices && model->indices, "Out of memory");
+  float* vertices = model->vertexBlob->data;
+  for (uint32_t i = 0; i < data->sceneNodeCount; i++) {
+    uint32_t nodeIndex = data->nodeOrder[i];
+    float* transform = model->globalTransforms + 16 * nodeIndex;
+    float* cached = model->triangleTransforms + 16 * nodeIndex;
+
+    if (data->nodes[nodeIndex].primitiveCount > 0 && memcmp(transform, cached, 16 * sizeof(float))) {
+      collectVertices(model, nodeIndex, vertices + 3 * model->vertexOffsets[nodeIndex]);
+      memcpy(cached, transform, 16 * sizeof(float));
+    }
   }
+}
 
-  *vertices = model->vertices;
-  *indices = model->indices;
-  uint32_t baseIndex = 0;
-  collectVertices(model, model->data->rootNode, vertices, indices, &baseIndex);
+void lovrModelGetTriangles(Model* model, float** vertices, uint32_t* vertexCount, uint32_t** indices, uint32_t* indexCount) {
+  updateTriangles(model);
+  *vertices = model->vertexBlob->data;
+  *indices = model->indexBlob->data;
   *vertexCount = model->vertexCount;
   *indexCount = model->indexCount;
-  *vertices = model->vertices;
-  *indices = model->indices;
+}
+
+// The Blobs are shared with the Model, their contents are updated the next time the triangles are
+// requested
+void lovrModelGetTriangleBlobs(Model* model, struct Blob** vertices, struct Blob** indices) {
+  updateTriangles(model);
+  *vertices = model->vertexBlob;
+  *indices = model->indexBlob;
 }
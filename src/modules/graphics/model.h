@@ -1,8 +1,10 @@
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 #pragma once
 
+struct Blob;
 struct Material;
 struct ModelData;
 
@@ -13,13 +15,20 @@ typedef enum {
 
 typedef struct Model Model;
 Model* lovrModelCreate(struct ModelData* data);
+Model* lovrModelCreateAsync(struct Blob* source, const char* path, void* io(const char* filename, size_t* bytesRead));
+void lovrModelUpdateLoading(void);
+bool lovrModelIsReady(Model* model);
+float lovrModelGetProgress(Model* model);
 void lovrModelDestroy(void* ref);
 struct ModelData* lovrModelGetModelData(Model* model);
 void lovrModelDraw(Model* model, float* transform, uint32_t instances);
 void lovrModelAnimate(Model* model, uint32_t animationIndex, float time, float alpha);
+void lovrModelAnimateMany(Model* model, uint32_t* animations, float* times, float* weights, uint32_t count);
+void lovrModelUpdateMany(Model** models, uint32_t count);
 void lovrModelGetNodePose(Model* model, uint32_t nodeIndex, float position[4], float rotation[4], CoordinateSpace space);
 void lovrModelPose(Model* model, uint32_t nodeIndex, float position[4], float rotation[4], float alpha);
 void lovrModelResetPose(Model* model);
 struct Material* lovrModelGetMaterial(Model* model, uint32_t material);
 void lovrModelGetAABB(Model* model, float aabb[6]);
 void lovrModelGetTriangles(Model* model, float** vertices, uint32_t* vertexCount, uint32_t** indices, uint32_t* indexCount);
+void lovrModelGetTriangleBlobs(Model* model, struct Blob** vertices, struct Blob** indices);
@@ -11,6 +11,7 @@
 #include "math/math.h"
 #include <math.h>
 #include <limits.h>
+#include <float.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -30,6 +31,13 @@
 #define MAX_IMAGES 8
 #define MAX_BLOCK_BUFFERS 8
 
+// Streamed texture uploads are staged in a persistently mapped ring of pixel buffer regions.  Each
+// frame can stage up to one region of pixels, streamed uploads past that budget are queued for the
+// next frame.  A region fits a full 4K RGBA frame, only uploads bigger than a whole region go
+// directly from client memory.  The ring is allocated by the first streamed upload.
+#define STAGING_REGIONS 3
+#define STAGING_REGION_SIZE (36 << 20)
+
 #define LOVR_SHADER_POSITION 0
 #define LOVR_SHADER_NORMAL 1
 #define LOVR_SHADER_TEX_COORD 2
@@ -50,6 +58,7 @@ struct Buffer {
   BufferUsage usage;
   bool mapped;
   bool readable;
+  bool persistent;
   uint8_t incoherent;
 };
 
@@ -108,6 +117,8 @@ struct Shader {
   map_t attributes;
   map_t uniformMap;
   map_t blockMap;
+  int builtinUniforms[MAX_BUILTIN_UNIFORMS];
+  int builtinBlocks[MAX_BUILTIN_BLOCKS];
   bool multiview;
 };
 
@@ -132,6 +143,8 @@ struct Mesh {
   uint32_t drawStart;
   uint32_t drawCount;
   struct Material* material;
+  float bounds[6];
+  bool hasBounds;
 };
 
 typedef enum {
@@ -162,6 +175,15 @@ typedef struct {
   uint64_t nanoseconds;
 } Timer;
 
+typedef struct {
+  Texture* texture;
+  Image* image;
+  uint32_t x;
+  uint32_t y;
+  uint32_t slice;
+  uint32_t mipmap;
+} Upload;
+
 static struct {
   Texture* defaultTexture;
   enum { NONE, INSTANCED_STEREO, MULTIVIEW } singlepass;
@@ -197,11 +219,22 @@ static struct {
   arr_t(Timer) timers;
   uint32_t activeTimer;
   map_t timerMap;
+  struct {
+    uint32_t buffer;
+    uint8_t* data;
+    uint32_t region;
+    size_t cursor;
+    GLsync fences[STAGING_REGIONS];
+    arr_t(Upload) uploads;
+  } staging;
   GpuFeatures features;
   GpuLimits limits;
   GpuStats stats;
 } state;
 
+static size_t getStagingSize(Image* image);
+static void uploadPixels(Texture* texture, Image* image, uint32_t x, uint32_t y, uint32_t slice, uint32_t mipmap, bool stream);
+
 // Helper functions
 
 static GLenum convertCompareMode(CompareMode mode) {
@@ -1277,6 +1310,15 @@ void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug) {
     glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 2, &state.limits.compute[2]);
   }
 
+#ifdef LOVR_GL
+  // GLES graphics shaders use version 300 es, which doesn't have storage buffers
+  if (state.features.compute) {
+    GLint vertexStorageBlocks;
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexStorageBlocks);
+    state.features.wideDraws = vertexStorageBlocks >= 2;
+  }
+#endif
+
   if (state.features.multiview) {
     state.singlepass = MULTIVIEW;
   } else if (state.features.instancedStereo) {
@@ -1292,6 +1334,13 @@ void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug) {
   glGetIntegerv(GL_MAX_SAMPLES, &state.limits.textureMSAA);
   glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &state.limits.blockSize);
   glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &state.limits.blockAlign);
+#ifndef LOVR_WEBGL
+  if (state.features.compute) {
+    GLint storageAlign;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlign);
+    state.limits.blockAlign = MAX(state.limits.blockAlign, storageAlign);
+  }
+#endif
   glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &state.limits.textureAnisotropy);
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
@@ -1359,6 +1408,7 @@ void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug) {
   map_init(&state.timerMap, 4);
   state.queryPool.next = ~0u;
   state.activeTimer = ~0u;
+  arr_init(&state.staging.uploads, realloc);
 }
 
 void lovrGpuDestroy() {
@@ -1374,6 +1424,22 @@ void lovrGpuDestroy() {
   }
   glDeleteQueries(state.queryPool.count, state.queryPool.queries);
   free(state.queryPool.queries);
+  for (int i = 0; i < STAGING_REGIONS; i++) {
+    if (state.staging.fences[i]) {
+      glDeleteSync(state.staging.fences[i]);
+    }
+  }
+  if (state.staging.buffer) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, state.staging.buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &state.staging.buffer);
+  }
+  for (size_t i = 0; i < state.staging.uploads.length; i++) {
+    lovrRelease(state.staging.uploads.data[i].texture, lovrTextureDestroy);
+    free(state.staging.uploads.data[i].image);
+  }
+  arr_free(&state.staging.uploads);
   arr_free(&state.timers);
   map_free(&state.timerMap);
   memset(&state, 0, sizeof(state));
@@ -1455,7 +1521,7 @@ void lovrGpuDraw(DrawCommand* draw) {
   float w = state.singlepass == MULTIVIEW ? draw->canvas->width : draw->canvas->width / (float) viewportCount;
   float h = draw->canvas->height;
   float viewports[2][4] = { { 0.f, 0.f, w, h }, { w, 0.f, w, h } };
-  lovrShaderSetInts(draw->shader, "lovrViewportCount", &(int) { viewportCount }, 0, 1);
+  lovrShaderSetUniformById(draw->shader, draw->shader->builtinUniforms[BUILTIN_VIEWPORT_COUNT], UNIFORM_INT, &(int) { viewportCount }, 0, 1);
 
   lovrGpuBindCanvas(draw->canvas, true);
   lovrGpuBindPipeline(&draw->pipeline);
@@ -1463,7 +1529,7 @@ void lovrGpuDraw(DrawCommand* draw) {
 
   for (uint32_t i = 0; i < drawCount; i++) {
     lovrGpuSetViewports(&viewports[i][0], viewportsPerDraw);
-    lovrShaderSetInts(draw->shader, "lovrViewID", &(int) { i }, 0, 1);
+    lovrShaderSetUniformById(draw->shader, draw->shader->builtinUniforms[BUILTIN_VIEW_ID], UNIFORM_INT, &(int) { i }, 0, 1);
     lovrGpuBindShader(draw->shader);
 
     Mesh* mesh = draw->mesh;
@@ -1489,9 +1555,37 @@ void lovrGpuDraw(DrawCommand* draw) {
 }
 
 void lovrGpuPresent() {
+  // Move on to the next staging region, waiting for the GPU to finish reading from it if necessary
+  if (state.staging.data && state.staging.cursor > 0) {
+    state.staging.fences[state.staging.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    state.staging.region = (state.staging.region + 1) % STAGING_REGIONS;
+    state.staging.cursor = 0;
+
+    GLsync fence = state.staging.fences[state.staging.region];
+    if (fence) {
+      while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+      glDeleteSync(fence);
+      state.staging.fences[state.staging.region] = NULL;
+    }
+  }
+
+  // Queued uploads happen in order, until they run out of room in the new region
+  while (state.staging.uploads.length > 0) {
+    Upload upload = state.staging.uploads.data[0];
+    if (ALIGN(state.staging.cursor, 16) + getStagingSize(upload.image) > STAGING_REGION_SIZE) {
+      break;
+    }
+
+    arr_splice(&state.staging.uploads, 0, 1);
+    uploadPixels(upload.texture, upload.image, upload.x, upload.y, upload.slice, upload.mipmap, true);
+    lovrRelease(upload.texture, lovrTextureDestroy);
+    free(upload.image);
+  }
+
   state.stats.shaderSwitches = 0;
   state.stats.renderPasses = 0;
   state.stats.drawCalls = 0;
+  state.stats.culled = 0;
 }
 
 void lovrGpuStencil(StencilAction action, int replaceValue, StencilCallback callback, void* userdata) {
@@ -1527,6 +1621,22 @@ void lovrGpuDirtyTexture() {
   state.textures[state.activeTexture] = NULL;
 }
 
+void* lovrGpuFence() {
+  return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void lovrGpuWaitFence(void* fence) {
+  GLsync sync = (GLsync) fence;
+  while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+  glDeleteSync(sync);
+}
+
+void lovrGpuDestroyFence(void* fence) {
+  if (fence) {
+    glDeleteSync((GLsync) fence);
+  }
+}
+
 // This doesn't actually reset all state, just state that is known to be changed externally
 void lovrGpuResetState() {
   if (state.vertexArray) {
@@ -1670,8 +1780,108 @@ const GpuStats* lovrGpuGetStats() {
   return &state.stats;
 }
 
+void lovrGpuCountCulled(uint32_t count) {
+  state.stats.culled += count;
+}
+
 // Texture
 
+static bool createStaging() {
+#ifdef LOVR_GL
+  if (!state.staging.data && GLAD_GL_ARB_buffer_storage) {
+    GLsizeiptr size = STAGING_REGIONS * STAGING_REGION_SIZE;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &state.staging.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, state.staging.buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+    state.staging.data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+#endif
+  return state.staging.data;
+}
+
+// Copies pixels into the staging ring and binds it, returning the offset to pass to GL in place of
+// the pixel pointer.  When staging isn't available or this frame's budget is used up, the pixel
+// pointer is returned and the upload happens from client memory.
+static const void* stagePixels(const void* data, size_t size) {
+  size_t offset = ALIGN(state.staging.cursor, 16);
+  if (!state.staging.data || offset + size > STAGING_REGION_SIZE) {
+    return data;
+  }
+
+  size_t base = state.staging.region * STAGING_REGION_SIZE;
+  memcpy(state.staging.data + base + offset, data, size);
+  state.staging.cursor = offset + size;
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, state.staging.buffer);
+  return (const void*) (base + offset);
+}
+
+// Client memory uploads break if a pixel buffer is left bound
+static void unstagePixels(const void* pixels, const void* data) {
+  if (pixels != data) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+}
+
+// How much of the staging ring an Image takes up, at most
+static size_t getStagingSize(Image* image) {
+  size_t size = image->blob->data ? ALIGN(image->blob->size, 16) : 0;
+  for (uint32_t i = 0; i < image->mipmapCount; i++) {
+    if (image->mipmaps[i].data != image->blob->data) {
+      size += ALIGN(image->mipmaps[i].size, 16);
+    }
+  }
+  return size;
+}
+
+// Queued uploads keep their own copy of the pixels, since the Image could change before they happen.
+// Everything is in a single allocation, so the copy is freed with free.
+static Image* copyImage(Image* image) {
+  size_t size = image->blob->data ? image->blob->size : 0;
+  for (uint32_t i = 0; i < image->mipmapCount; i++) {
+    if (image->mipmaps[i].data != image->blob->data) {
+      size += image->mipmaps[i].size;
+    }
+  }
+
+  size_t header = sizeof(Image) + sizeof(Blob) + image->mipmapCount * sizeof(Mipmap);
+  uint8_t* memory = malloc(ALIGN(header, 16) + size);
+  lovrAssert(memory, "Out of memory");
+  Image* copy = (Image*) memory;
+  Blob* blob = (Blob*) (copy + 1);
+  Mipmap* mipmaps = (Mipmap*) (blob + 1);
+  uint8_t* data = memory + ALIGN(header, 16);
+
+  *copy = *image;
+  copy->ref = 1;
+  copy->blob = blob;
+  copy->source = NULL;
+  copy->mipmaps = mipmaps;
+  copy->mipmapData = NULL;
+  *blob = (Blob) { .ref = 1 };
+
+  if (image->blob->data) {
+    blob->data = data;
+    blob->size = image->blob->size;
+    memcpy(data, image->blob->data, blob->size);
+    data += blob->size;
+  }
+
+  for (uint32_t i = 0; i < image->mipmapCount; i++) {
+    mipmaps[i] = image->mipmaps[i];
+    if (image->mipmaps[i].data == image->blob->data) {
+      mipmaps[i].data = blob->data;
+    } else {
+      memcpy(data, image->mipmaps[i].data, mipmaps[i].size);
+      mipmaps[i].data = data;
+      data += mipmaps[i].size;
+    }
+  }
+
+  return copy;
+}
+
 Texture* lovrTextureCreate(TextureType type, Image** slices, uint32_t sliceCount, bool srgb, bool mipmaps, uint32_t msaa) {
   Texture* texture = calloc(1, sizeof(Texture));
   lovrAssert(texture, "Out of memory");
@@ -1696,7 +1906,7 @@ Texture* lovrTextureCreate(TextureType type, Image** slices, uint32_t sliceCount
   if (sliceCount > 0) {
     lovrTextureAllocate(texture, slices[0]->width, slices[0]->height, sliceCount, slices[0]->format);
     for (uint32_t i = 0; i < sliceCount; i++) {
-      lovrTextureReplacePixels(texture, slices[i], 0, 0, i, 0);
+      lovrTextureReplacePixels(texture, slices[i], 0, 0, i, 0, false);
     }
   }
 
@@ -1769,6 +1979,7 @@ void lovrTextureAllocate(Texture* texture, uint32_t width, uint32_t height, uint
   }
 
   if (isTextureFormatCompressed(format)) {
+    state.stats.textureMemory += getTextureMemorySize(texture);
     return;
   }
 
@@ -1816,10 +2027,7 @@ void lovrTextureAllocate(Texture* texture, uint32_t width, uint32_t height, uint
   state.stats.textureMemory += getTextureMemorySize(texture);
 }
 
-void lovrTextureReplacePixels(Texture* texture, Image* image, uint32_t x, uint32_t y, uint32_t slice, uint32_t mipmap) {
-  lovrGraphicsFlush();
-  lovrAssert(texture->allocated, "Texture is not allocated");
-
+static void uploadPixels(Texture* texture, Image* image, uint32_t x, uint32_t y, uint32_t slice, uint32_t mipmap, bool stream) {
 #ifndef LOVR_WEBGL
   if ((texture->incoherent >> BARRIER_TEXTURE) & 1) {
     lovrGpuSync(1 << BARRIER_TEXTURE);
@@ -1830,46 +2038,67 @@ void lovrTextureReplacePixels(Texture* texture, Image* image, uint32_t x, uint32
   uint32_t maxHeight = lovrTextureGetHeight(texture, mipmap);
   uint32_t width = image->width;
   uint32_t height = image->height;
-  bool overflow = (x + width > maxWidth) || (y + height > maxHeight);
-  lovrAssert(!overflow, "Trying to replace pixels outside the texture's bounds");
-  lovrAssert(mipmap < texture->mipmapCount, "Invalid mipmap level %d", mipmap);
   GLenum glFormat = convertTextureFormat(image->format);
   GLenum glInternalFormat = convertTextureFormatInternal(image->format, texture->srgb);
   GLenum binding = (texture->type == TEXTURE_CUBE) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + slice : texture->target;
 
   lovrGpuBindTexture(texture, 0);
   if (isTextureFormatCompressed(image->format)) {
-    lovrAssert(width == maxWidth && height == maxHeight, "Compressed texture pixels must be fully replaced");
-    lovrAssert(mipmap == 0, "Unable to replace a specific mipmap of a compressed texture");
     for (uint32_t i = 0; i < image->mipmapCount; i++) {
       Mipmap* m = image->mipmaps + i;
+      const void* pixels = stream ? stagePixels(m->data, m->size) : m->data;
       switch (texture->type) {
         case TEXTURE_2D:
         case TEXTURE_CUBE:
-          glCompressedTexImage2D(binding, i, glInternalFormat, m->width, m->height, 0, (GLsizei) m->size, m->data);
+          glCompressedTexImage2D(binding, i, glInternalFormat, m->width, m->height, 0, (GLsizei) m->size, pixels);
           break;
         case TEXTURE_ARRAY:
         case TEXTURE_VOLUME:
-          glCompressedTexSubImage3D(binding, i, x, y, slice, m->width, m->height, 1, glInternalFormat, (GLsizei) m->size, m->data);
+          glCompressedTexSubImage3D(binding, i, x, y, slice, m->width, m->height, 1, glInternalFormat, (GLsizei) m->size, pixels);
           break;
       }
+      unstagePixels(pixels, m->data);
     }
   } else {
-    lovrAssert(image->blob->data, "Trying to replace Texture pixels with empty pixel data");
     GLenum glType = convertTextureFormatType(image->format);
+    const void* pixels = stream ? stagePixels(image->blob->data, image->blob->size) : image->blob->data;
 
     switch (texture->type) {
       case TEXTURE_2D:
       case TEXTURE_CUBE:
-        glTexSubImage2D(binding, mipmap, x, y, width, height, glFormat, glType, image->blob->data);
+        glTexSubImage2D(binding, mipmap, x, y, width, height, glFormat, glType, pixels);
         break;
       case TEXTURE_ARRAY:
       case TEXTURE_VOLUME:
-        glTexSubImage3D(binding, mipmap, x, y, slice, width, height, 1, glFormat, glType, image->blob->data);
+        glTexSubImage3D(binding, mipmap, x, y, slice, width, height, 1, glFormat, glType, pixels);
         break;
     }
 
-    if (texture->mipmaps) {
+    unstagePixels(pixels, image->blob->data);
+
+    // Upload mipmaps that were generated ahead of time.  glGenerateMipmap regenerates every level
+    // above the base, so it's only used when the Image doesn't have the whole chain.
+    uint32_t levels = 1;
+    bool full = width == maxWidth && height == maxHeight;
+    if (texture->mipmaps && mipmap == 0 && full && texture->type != TEXTURE_VOLUME && image->mipmapCount >= texture->mipmapCount) {
+      for (; levels < texture->mipmapCount; levels++) {
+        Mipmap* m = image->mipmaps + levels;
+        pixels = stream ? stagePixels(m->data, m->size) : m->data;
+        switch (texture->type) {
+          case TEXTURE_2D:
+          case TEXTURE_CUBE:
+            glTexSubImage2D(binding, levels, 0, 0, m->width, m->height, glFormat, glType, pixels);
+            break;
+          case TEXTURE_ARRAY:
+            glTexSubImage3D(binding, levels, 0, 0, slice, m->width, m->height, 1, glFormat, glType, pixels);
+            break;
+          default: break;
+        }
+        unstagePixels(pixels, m->data);
+      }
+    }
+
+    if (texture->mipmaps && levels < texture->mipmapCount) {
 #if defined(__APPLE__) || defined(LOVR_WEBGL) // glGenerateMipmap doesn't work on big cubemap textures on macOS
       if (texture->type != TEXTURE_CUBE || width < 2048) {
         glGenerateMipmap(texture->target);
@@ -1883,6 +2112,62 @@ void lovrTextureReplacePixels(Texture* texture, Image* image, uint32_t x, uint32
   }
 }
 
+void lovrTextureReplacePixels(Texture* texture, Image* image, uint32_t x, uint32_t y, uint32_t slice, uint32_t mipmap, bool stream) {
+  lovrGraphicsFlush();
+  lovrAssert(texture->allocated, "Texture is not allocated");
+
+  uint32_t maxWidth = lovrTextureGetWidth(texture, mipmap);
+  uint32_t maxHeight = lovrTextureGetHeight(texture, mipmap);
+  uint32_t width = image->width;
+  uint32_t height = image->height;
+  bool overflow = (x + width > maxWidth) || (y + height > maxHeight);
+  lovrAssert(!overflow, "Trying to replace pixels outside the texture's bounds");
+  lovrAssert(mipmap < texture->mipmapCount, "Invalid mipmap level %d", mipmap);
+
+  if (isTextureFormatCompressed(image->format)) {
+    lovrAssert(width == maxWidth && height == maxHeight, "Compressed texture pixels must be fully replaced");
+    lovrAssert(mipmap == 0, "Unable to replace a specific mipmap of a compressed texture");
+  } else {
+    lovrAssert(image->blob->data, "Trying to replace Texture pixels with empty pixel data");
+  }
+
+  bool pending = false;
+  for (size_t i = 0; i < state.staging.uploads.length && !pending; i++) {
+    pending = state.staging.uploads.data[i].texture == texture;
+  }
+
+  // Streamed uploads to a Texture that already has queued uploads are queued behind them, to keep
+  // them in order.  The pixels are copied, so the caller can reuse the Image right away.
+  size_t size = getStagingSize(image);
+  if (stream && size <= STAGING_REGION_SIZE && createStaging()) {
+    bool full = ALIGN(state.staging.cursor, 16) + size > STAGING_REGION_SIZE;
+    if (pending || full) {
+      lovrRetain(texture);
+      arr_push(&state.staging.uploads, ((Upload) { texture, copyImage(image), x, y, slice, mipmap }));
+    } else {
+      uploadPixels(texture, image, x, y, slice, mipmap, true);
+    }
+    return;
+  }
+
+  // Everything else happens now, so anything queued for this Texture has to happen first
+  if (pending) {
+    for (size_t i = 0; i < state.staging.uploads.length;) {
+      Upload upload = state.staging.uploads.data[i];
+      if (upload.texture == texture) {
+        arr_splice(&state.staging.uploads, i, 1);
+        uploadPixels(upload.texture, upload.image, upload.x, upload.y, upload.slice, upload.mipmap, true);
+        lovrRelease(upload.texture, lovrTextureDestroy);
+        free(upload.image);
+      } else {
+        i++;
+      }
+    }
+  }
+
+  uploadPixels(texture, image, x, y, slice, mipmap, false);
+}
+
 uint64_t lovrTextureGetId(Texture* texture) {
   return texture->id;
 }
@@ -2233,6 +2518,22 @@ Buffer* lovrBufferCreate(size_t size, void* data, BufferType type, BufferUsage u
   lovrGpuBindBuffer(type, buffer->id);
   GLenum glType = convertBufferType(type);
 
+#ifdef LOVR_GL
+  // Persistent buffers stay mapped forever, the caller is responsible for fencing its writes
+  if (usage == USAGE_PERSISTENT && GLAD_GL_ARB_buffer_storage) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(glType, size, data, flags);
+    buffer->data = glMapBufferRange(glType, 0, size, flags);
+    buffer->mapped = true;
+    buffer->persistent = true;
+    return buffer;
+  }
+#endif
+
+  if (usage == USAGE_PERSISTENT) {
+    buffer->usage = usage = USAGE_STREAM;
+  }
+
 #ifdef LOVR_WEBGL
   buffer->data = malloc(size);
   lovrAssert(buffer->data, "Out of memory");
@@ -2251,6 +2552,12 @@ Buffer* lovrBufferCreate(size_t size, void* data, BufferType type, BufferUsage u
 void lovrBufferDestroy(void* ref) {
   Buffer* buffer = ref;
   lovrGpuDestroySyncResource(buffer, buffer->incoherent);
+#ifndef LOVR_WEBGL
+  if (buffer->persistent) {
+    lovrGpuBindBuffer(buffer->type, buffer->id);
+    glUnmapBuffer(convertBufferType(buffer->type));
+  }
+#endif
   glDeleteBuffers(1, &buffer->id);
 #ifdef LOVR_WEBGL
   free(buffer->data);
@@ -2303,7 +2610,7 @@ void lovrBufferUnmap(Buffer* buffer) {
     glBufferSubData(convertBufferType(buffer->type), buffer->flushFrom, buffer->flushTo - buffer->flushFrom, data);
   }
 #else
-  if (buffer->mapped) {
+  if (buffer->mapped && !buffer->persistent) {
     lovrGpuBindBuffer(buffer->type, buffer->id);
 
     if (buffer->flushTo > buffer->flushFrom) {
@@ -2319,6 +2626,10 @@ void lovrBufferUnmap(Buffer* buffer) {
 }
 
 void lovrBufferDiscard(Buffer* buffer) {
+  if (buffer->persistent) {
+    return;
+  }
+
   lovrAssert(!buffer->readable, "Readable Buffers can not be discarded");
   lovrAssert(!buffer->mapped, "Mapped Buffers can not be discarded");
   lovrGpuBindBuffer(buffer->type, buffer->id);
@@ -2576,6 +2887,15 @@ static void lovrShaderSetupUniforms(Shader* shader) {
     textureSlot += uniform.type == UNIFORM_SAMPLER ? uniform.count : 0;
     imageSlot += uniform.type == UNIFORM_IMAGE ? uniform.count : 0;
   }
+
+  // Resolve the built in uniforms up front so the renderer doesn't have to hash their names
+  for (int i = 0; i < MAX_BUILTIN_UNIFORMS; i++) {
+    shader->builtinUniforms[i] = lovrShaderGetUniformId(shader, lovrShaderBuiltinUniforms[i]);
+  }
+
+  for (int i = 0; i < MAX_BUILTIN_BLOCKS; i++) {
+    shader->builtinBlocks[i] = lovrShaderGetBlockId(shader, lovrShaderBuiltinBlocks[i]);
+  }
 }
 
 static char* lovrShaderGetFlagCode(ShaderFlag* flags, uint32_t flagCount) {
@@ -2629,6 +2949,8 @@ Shader* lovrShaderCreateGraphics(const char* vertexSource, int vertexSourceLengt
     "";
 #endif
 
+  const char* drawBlocks = state.features.wideDraws ? "#define WIDE_DRAWS\n" : "";
+
   const char* singlepass[2] = { "", "" };
   if (multiview && state.singlepass == MULTIVIEW) {
     singlepass[0] = singlepass[1] = "#extension GL_OVR_multiview2 : require\n#define MULTIVIEW\n";
@@ -2641,8 +2963,8 @@ Shader* lovrShaderCreateGraphics(const char* vertexSource, int vertexSourceLengt
 
   // Vertex
   vertexSource = vertexSource == NULL ? lovrUnlitVertexShader : vertexSource;
-  const char* vertexSources[] = { version, computeExtensions, singlepass[0], flagSource ? flagSource : "", lovrShaderVertexPrefix, vertexSource, lovrShaderVertexSuffix };
-  int vertexSourceLengths[] = { -1, -1, -1, -1, -1, vertexSourceLength, -1 };
+  const char* vertexSources[] = { version, computeExtensions, drawBlocks, singlepass[0], flagSource ? flagSource : "", lovrShaderVertexPrefix, vertexSource, lovrShaderVertexSuffix };
+  int vertexSourceLengths[] = { -1, -1, -1, -1, -1, -1, vertexSourceLength, -1 };
   int vertexSourceCount = sizeof(vertexSources) / sizeof(vertexSources[0]);
   GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSources, vertexSourceLengths, vertexSourceCount);
 
@@ -2776,66 +3098,111 @@ int lovrShaderGetAttributeLocation(Shader* shader, const char* name, bool* integ
 }
 
 bool lovrShaderHasUniform(Shader* shader, const char* name) {
-  return map_get(&shader->uniformMap, hash64(name, strlen(name))) != MAP_NIL;
+  return lovrShaderGetUniformId(shader, name) >= 0;
 }
 
 bool lovrShaderHasBlock(Shader* shader, const char* name) {
-  return map_get(&shader->blockMap, hash64(name, strlen(name))) != MAP_NIL;
+  return lovrShaderGetBlockId(shader, name) >= 0;
 }
 
 const Uniform* lovrShaderGetUniform(Shader* shader, const char* name) {
-  uint64_t index = map_get(&shader->uniformMap, hash64(name, strlen(name)));
-  return index == MAP_NIL ? NULL : &shader->uniforms.data[index];
+  int id = lovrShaderGetUniformId(shader, name);
+  return id < 0 ? NULL : &shader->uniforms.data[id];
 }
 
-static void lovrShaderSetUniform(Shader* shader, const char* name, UniformType type, void* data, int start, int count, int size, const char* debug) {
-  uint64_t index = map_get(&shader->uniformMap, hash64(name, strlen(name)));
-  if (index == MAP_NIL) {
-    return;
-  }
-
-  Uniform* uniform = &shader->uniforms.data[index];
-  lovrAssert(uniform->type == type, "Unable to send %ss to uniform %s", debug, name);
-  lovrAssert((start + count) * size <= uniform->size, "Too many %ss for uniform %s, maximum is %d", debug, name, uniform->size / size);
-
-  void* dest = uniform->value.bytes + start * size;
-  if (memcmp(dest, data, count * size)) {
-    lovrGraphicsFlushShader(shader);
-    memcpy(dest, data, count * size);
-    uniform->dirty = true;
-  }
+const Uniform* lovrShaderGetUniformById(Shader* shader, int id) {
+  return id < 0 || (size_t) id >= shader->uniforms.length ? NULL : &shader->uniforms.data[id];
 }
 
 void lovrShaderSetFloats(Shader* shader, const char* name, float* data, int start, int count) {
-  lovrShaderSetUniform(shader, name, UNIFORM_FLOAT, data, start, count, sizeof(float), "float");
+  lovrShaderSetUniformById(shader, lovrShaderGetUniformId(shader, name), UNIFORM_FLOAT, data, start, count);
 }
 
 void lovrShaderSetInts(Shader* shader, const char* name, int* data, int start, int count) {
-  lovrShaderSetUniform(shader, name, UNIFORM_INT, data, start, count, sizeof(int), "int");
+  lovrShaderSetUniformById(shader, lovrShaderGetUniformId(shader, name), UNIFORM_INT, data, start, count);
 }
 
 void lovrShaderSetMatrices(Shader* shader, const char* name, float* data, int start, int count) {
-  lovrShaderSetUniform(shader, name, UNIFORM_MATRIX, data, start, count, sizeof(float), "float");
+  lovrShaderSetUniformById(shader, lovrShaderGetUniformId(shader, name), UNIFORM_MATRIX, data, start, count);
 }
 
 void lovrShaderSetTextures(Shader* shader, const char* name, Texture** data, int start, int count) {
-  lovrShaderSetUniform(shader, name, UNIFORM_SAMPLER, data, start, count, sizeof(Texture*), "texture");
+  lovrShaderSetUniformById(shader, lovrShaderGetUniformId(shader, name), UNIFORM_SAMPLER, data, start, count);
 }
 
 void lovrShaderSetImages(Shader* shader, const char* name, StorageImage* data, int start, int count) {
-  lovrShaderSetUniform(shader, name, UNIFORM_IMAGE, data, start, count, sizeof(StorageImage), "image");
+  lovrShaderSetUniformById(shader, lovrShaderGetUniformId(shader, name), UNIFORM_IMAGE, data, start, count);
 }
 
 void lovrShaderSetColor(Shader* shader, const char* name, Color color) {
+  lovrShaderSetColorById(shader, lovrShaderGetUniformId(shader, name), color);
+}
+
+void lovrShaderSetBlock(Shader* shader, const char* name, Buffer* buffer, size_t offset, size_t size, UniformAccess access) {
+  lovrShaderSetBlockById(shader, lovrShaderGetBlockId(shader, name), buffer, offset, size, access);
+}
+
+int lovrShaderGetUniformId(Shader* shader, const char* name) {
+  uint64_t index = map_get(&shader->uniformMap, hash64(name, strlen(name)));
+  return index == MAP_NIL ? -1 : (int) index;
+}
+
+int lovrShaderGetBlockId(Shader* shader, const char* name) {
+  uint64_t id = map_get(&shader->blockMap, hash64(name, strlen(name)));
+  return id == MAP_NIL ? -1 : (int) id;
+}
+
+int lovrShaderGetBuiltinUniformId(Shader* shader, BuiltinUniform uniform) {
+  return shader->builtinUniforms[uniform];
+}
+
+int lovrShaderGetBuiltinBlockId(Shader* shader, BuiltinBlock block) {
+  return shader->builtinBlocks[block];
+}
+
+void lovrShaderSetUniformById(Shader* shader, int id, UniformType type, void* data, int start, int count) {
+  if (id < 0) {
+    return;
+  }
+
+  static const int sizes[] = {
+    [UNIFORM_FLOAT] = sizeof(float),
+    [UNIFORM_MATRIX] = sizeof(float),
+    [UNIFORM_INT] = sizeof(int),
+    [UNIFORM_SAMPLER] = sizeof(Texture*),
+    [UNIFORM_IMAGE] = sizeof(StorageImage)
+  };
+
+  static const char* debug[] = {
+    [UNIFORM_FLOAT] = "float",
+    [UNIFORM_MATRIX] = "float",
+    [UNIFORM_INT] = "int",
+    [UNIFORM_SAMPLER] = "texture",
+    [UNIFORM_IMAGE] = "image"
+  };
+
+  Uniform* uniform = &shader->uniforms.data[id];
+  int size = sizes[type];
+  lovrAssert(uniform->type == type, "Unable to send %ss to uniform %s", debug[type], uniform->name);
+  lovrAssert((start + count) * size <= uniform->size, "Too many %ss for uniform %s, maximum is %d", debug[type], uniform->name, uniform->size / size);
+
+  void* dest = uniform->value.bytes + start * size;
+  if (memcmp(dest, data, count * size)) {
+    lovrGraphicsFlushShader(shader);
+    memcpy(dest, data, count * size);
+    uniform->dirty = true;
+  }
+}
+
+void lovrShaderSetColorById(Shader* shader, int id, Color color) {
   color.r = lovrMathGammaToLinear(color.r);
   color.g = lovrMathGammaToLinear(color.g);
   color.b = lovrMathGammaToLinear(color.b);
-  lovrShaderSetUniform(shader, name, UNIFORM_FLOAT, (float*) &color, 0, 4, sizeof(float), "float");
+  lovrShaderSetUniformById(shader, id, UNIFORM_FLOAT, (float*) &color, 0, 4);
 }
 
-void lovrShaderSetBlock(Shader* shader, const char* name, Buffer* buffer, size_t offset, size_t size, UniformAccess access) {
-  uint64_t id = map_get(&shader->blockMap, hash64(name, strlen(name)));
-  if (id == MAP_NIL) return;
+void lovrShaderSetBlockById(Shader* shader, int id, Buffer* buffer, size_t offset, size_t size, UniformAccess access) {
+  if (id < 0) return;
 
   int type = id & 1;
   int index = id >> 1;
@@ -3038,6 +3405,7 @@ void lovrMeshAttachAttribute(Mesh* mesh, const char* name, MeshAttribute* attrib
   lovrAssert(mesh->attributeCount < MAX_ATTRIBUTES, "Mesh already has the max number of attributes (%d)", MAX_ATTRIBUTES);
   lovrAssert(strlen(name) < MAX_ATTRIBUTE_NAME_LENGTH, "Mesh attribute name '%s' is too long (max is %d)", name, MAX_ATTRIBUTE_NAME_LENGTH);
   lovrGraphicsFlushMesh(mesh);
+  mesh->hasBounds = mesh->hasBounds && strcmp(name, lovrShaderAttributeNames[ATTR_POSITION]);
   uint64_t index = mesh->attributeCount++;
   mesh->attributes[index] = *attribute;
   strcpy(mesh->attributeNames[index], name);
@@ -3051,6 +3419,7 @@ void lovrMeshDetachAttribute(Mesh* mesh, const char* name) {
   lovrAssert(index != MAP_NIL, "No attached attribute named '%s' was found", name);
   MeshAttribute* attribute = &mesh->attributes[index];
   lovrGraphicsFlushMesh(mesh);
+  mesh->hasBounds = mesh->hasBounds && strcmp(name, lovrShaderAttributeNames[ATTR_POSITION]);
   lovrRelease(attribute->buffer, lovrBufferDestroy);
   map_remove(&mesh->attributeMap, hash);
   mesh->attributeNames[index][0] = '\0';
@@ -3127,3 +3496,47 @@ void lovrMeshSetMaterial(Mesh* mesh, Material* material) {
   lovrRelease(mesh->material, lovrMaterialDestroy);
   mesh->material = material;
 }
+
+bool lovrMeshGetBounds(Mesh* mesh, float aabb[6]) {
+  if (mesh->hasBounds) {
+    memcpy(aabb, mesh->bounds, sizeof(mesh->bounds));
+  }
+  return mesh->hasBounds;
+}
+
+void lovrMeshSetBounds(Mesh* mesh, float aabb[6]) {
+  if (aabb) {
+    memcpy(mesh->bounds, aabb, sizeof(mesh->bounds));
+  }
+  mesh->hasBounds = aabb != NULL;
+}
+
+// Vertices are read from the caller's copy, since mapped vertex buffers aren't readable.  Replacing
+// every vertex starts the bounds over, smaller writes can only grow them.
+void lovrMeshUpdateBounds(Mesh* mesh, const void* vertices, uint32_t start, uint32_t count) {
+  uint32_t index = lovrMeshGetAttributeIndex(mesh, lovrShaderAttributeNames[ATTR_POSITION]);
+  MeshAttribute* position = index == ~0u ? NULL : &mesh->attributes[index];
+
+  if (!position || position->buffer != mesh->vertexBuffer || position->type != F32) {
+    mesh->hasBounds = false;
+    return;
+  }
+
+  if (start == 0 && count >= mesh->vertexCount) {
+    mesh->bounds[0] = mesh->bounds[2] = mesh->bounds[4] = FLT_MAX;
+    mesh->bounds[1] = mesh->bounds[3] = mesh->bounds[5] = -FLT_MAX;
+    mesh->hasBounds = count > 0;
+  } else if (!mesh->hasBounds) {
+    return;
+  }
+
+  const uint8_t* vertex = (const uint8_t*) vertices + position->offset;
+  for (uint32_t i = 0; i < count; i++, vertex += position->stride) {
+    const float* p = (const float*) vertex;
+    for (uint32_t j = 0; j < 3; j++) {
+      float x = j < position->components ? p[j] : 0.f;
+      mesh->bounds[2 * j + 0] = MIN(mesh->bounds[2 * j + 0], x);
+      mesh->bounds[2 * j + 1] = MAX(mesh->bounds[2 * j + 1], x);
+    }
+  }
+}
@@ -59,6 +59,33 @@ typedef enum {
   MAX_DEFAULT_SHADERS
 } DefaultShader;
 
+// Uniforms and blocks used by the renderer, resolved to ids when a Shader is created.  The texture
+// uniforms at the start line up with the MaterialTexture enum.
+typedef enum {
+  BUILTIN_DIFFUSE_TEXTURE,
+  BUILTIN_EMISSIVE_TEXTURE,
+  BUILTIN_METALNESS_TEXTURE,
+  BUILTIN_ROUGHNESS_TEXTURE,
+  BUILTIN_OCCLUSION_TEXTURE,
+  BUILTIN_NORMAL_TEXTURE,
+  BUILTIN_SKYBOX_TEXTURE,
+  BUILTIN_POSE_COUNT,
+  BUILTIN_SDF_RANGE,
+  BUILTIN_POINT_SIZE,
+  BUILTIN_VIEWPORT_COUNT,
+  BUILTIN_VIEW_ID,
+  MAX_BUILTIN_UNIFORMS
+} BuiltinUniform;
+
+typedef enum {
+  BUILTIN_MODEL_BLOCK,
+  BUILTIN_COLOR_BLOCK,
+  BUILTIN_FRAME_BLOCK,
+  BUILTIN_MATERIAL_BLOCK,
+  BUILTIN_POSE_BLOCK,
+  MAX_BUILTIN_BLOCKS
+} BuiltinBlock;
+
 typedef struct {
   struct Texture* texture;
   int slice;
@@ -114,6 +141,7 @@ int lovrShaderGetAttributeLocation(Shader* shader, const char* name, bool* integ
 bool lovrShaderHasUniform(Shader* shader, const char* name);
 bool lovrShaderHasBlock(Shader* shader, const char* name);
 const Uniform* lovrShaderGetUniform(Shader* shader, const char* name);
+const Uniform* lovrShaderGetUniformById(Shader* shader, int id);
 void lovrShaderSetFloats(Shader* shader, const char* name, float* data, int start, int count);
 void lovrShaderSetInts(Shader* shader, const char* name, int* data, int start, int count);
 void lovrShaderSetMatrices(Shader* shader, const char* name, float* data, int start, int count);
@@ -121,6 +149,13 @@ void lovrShaderSetTextures(Shader* shader, const char* name, struct Texture** da
 void lovrShaderSetImages(Shader* shader, const char* name, StorageImage* data, int start, int count);
 void lovrShaderSetColor(Shader* shader, const char* name, Color color);
 void lovrShaderSetBlock(Shader* shader, const char* name, struct Buffer* buffer, size_t offset, size_t size, UniformAccess access);
+int lovrShaderGetUniformId(Shader* shader, const char* name);
+int lovrShaderGetBlockId(Shader* shader, const char* name);
+int lovrShaderGetBuiltinUniformId(Shader* shader, BuiltinUniform uniform);
+int lovrShaderGetBuiltinBlockId(Shader* shader, BuiltinBlock block);
+void lovrShaderSetUniformById(Shader* shader, int id, UniformType type, void* data, int start, int count);
+void lovrShaderSetColorById(Shader* shader, int id, Color color);
+void lovrShaderSetBlockById(Shader* shader, int id, struct Buffer* buffer, size_t offset, size_t size, UniformAccess access);
 
 // ShaderBlock
 
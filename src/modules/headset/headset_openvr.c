@@ -725,6 +725,7 @@ static ModelData* openvr_newModelData(Device device, bool animated) {
       .primitiveIndex = i,
       .primitiveCount = 1,
       .skin = ~0u,
+      .lod = ~0u,
       .matrix = true
     };
 
@@ -749,13 +750,16 @@ static ModelData* openvr_newModelData(Device device, bool animated) {
       .matrix = true,
       .childCount = modelCount,
       .children = model->children,
-      .skin = ~0u
+      .skin = ~0u,
+      .lod = ~0u
     };
 
     free(renderModels);
     free(renderModelTextures);
   }
 
+  lovrModelDataFlatten(model);
+
   return model;
 }
 
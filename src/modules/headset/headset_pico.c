@@ -7,6 +7,9 @@
 #include "core/maf.h"
 #include "core/os.h"
 #include "core/util.h"
+#ifndef LOVR_DISABLE_THREAD
+#include "thread/job.h"
+#endif
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
@@ -459,6 +462,10 @@ static Variant cookie;
 static void lovrPicoBoot(void) {
   lovrAssert(os_init(), "Failed to initialize platform");
 
+#ifndef LOVR_DISABLE_THREAD
+  lovrJobInit();
+#endif
+
   L = luaL_newstate();
   luax_setmainthread(L);
   luaL_openlibs(L);
@@ -546,6 +553,9 @@ JNIEXPORT void JNICALL Java_org_lovr_app_Activity_lovrPicoOnFrame(JNIEnv* jni, j
         lua_close(L);
         L = NULL;
         T = NULL;
+#ifndef LOVR_DISABLE_THREAD
+        lovrJobDestroy();
+#endif
 
         // Call 'finish' method on the Activity
         jclass class = (*jni)->GetObjectClass(jni, activity);
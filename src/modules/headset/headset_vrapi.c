@@ -518,7 +518,8 @@ static struct ModelData* vrapi_newModelData(Device device, bool animated) {
       .transform.properties.translation = { position->x, position->y, position->z },
       .transform.properties.rotation = { orientation->x, orientation->y, orientation->z, orientation->w },
       .transform.properties.scale = { 1.f, 1.f, 1.f },
-      .skin = ~0u
+      .skin = ~0u,
+      .lod = ~0u
     };
 
     model->joints[i] = i;
@@ -559,7 +560,8 @@ static struct ModelData* vrapi_newModelData(Device device, bool animated) {
     .transform.properties.scale = { 1.f, 1.f, 1.f },
     .primitiveIndex = 0,
     .primitiveCount = 1,
-    .skin = 0
+    .skin = 0,
+    .lod = ~0u
   };
 
   // The root node has the mesh node and root joint as children
@@ -569,13 +571,16 @@ static struct ModelData* vrapi_newModelData(Device device, bool animated) {
     .transform = { MAT4_IDENTITY },
     .childCount = 2,
     .children = children,
-    .skin = ~0u
+    .skin = ~0u,
+    .lod = ~0u
   };
 
   // Add the children to the root node
   *children++ = 0;
   *children++ = model->jointCount;
 
+  lovrModelDataFlatten(model);
+
   return model;
 }
 
@@ -0,0 +1,202 @@
+#include "thread/job.h"
+#include "core/os.h"
+#include "core/util.h"
+#include "lib/tinycthread/tinycthread.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_WORKERS 16
+
+typedef struct {
+  JobFunction* function;
+  void* context;
+} Task;
+
+static struct {
+  bool initialized;
+  mtx_t runLock;
+  mtx_t lock;
+  cnd_t wake;
+  cnd_t done;
+  cnd_t taskDone;
+  thrd_t workers[MAX_WORKERS];
+  uint32_t workerCount;
+  thrd_t runner;
+  bool running;
+  JobFunction* function;
+  void* context;
+  uint32_t next;
+  uint32_t count;
+  uint32_t finished;
+  arr_t(Task) tasks;
+  bool quit;
+} state;
+
+// Takes the next job and runs it.  The lock is held when this is called and when it returns.
+static void runNextJob() {
+  uint32_t index = state.next++;
+  JobFunction* function = state.function;
+  void* context = state.context;
+  mtx_unlock(&state.lock);
+  function(context, index);
+  mtx_lock(&state.lock);
+  if (++state.finished == state.count) {
+    cnd_broadcast(&state.done);
+  }
+}
+
+// Whether the current thread is already part of the pool, either as a worker or as the thread that
+// is waiting in lovrJobRun
+static bool isPoolThread() {
+  thrd_t self = thrd_current();
+  for (uint32_t i = 0; i < state.workerCount; i++) {
+    if (thrd_equal(self, state.workers[i])) {
+      return true;
+    }
+  }
+
+  mtx_lock(&state.lock);
+  bool runner = state.running && thrd_equal(self, state.runner);
+  mtx_unlock(&state.lock);
+  return runner;
+}
+
+static int workerMain(void* userdata) {
+  mtx_lock(&state.lock);
+  for (;;) {
+    while (!state.quit && state.next >= state.count && state.tasks.length == 0) {
+      cnd_wait(&state.wake, &state.lock);
+    }
+
+    if (state.quit) {
+      break;
+    }
+
+    // Jobs come first, since lovrJobRun is blocking a thread while it waits for them
+    if (state.next < state.count) {
+      runNextJob();
+    } else {
+      Task task = state.tasks.data[0];
+      arr_splice(&state.tasks, 0, 1);
+      mtx_unlock(&state.lock);
+      task.function(task.context, 0);
+      mtx_lock(&state.lock);
+      cnd_broadcast(&state.taskDone);
+    }
+  }
+  mtx_unlock(&state.lock);
+  return 0;
+}
+
+void lovrJobInit() {
+  if (state.initialized) {
+    return;
+  }
+
+  mtx_init(&state.runLock, mtx_plain);
+  mtx_init(&state.lock, mtx_plain);
+  cnd_init(&state.wake);
+  cnd_init(&state.done);
+  cnd_init(&state.taskDone);
+  arr_init(&state.tasks, realloc);
+
+  uint32_t cores = os_get_core_count();
+  uint32_t count = MIN(cores > 1 ? cores - 1 : 0, MAX_WORKERS);
+  for (uint32_t i = 0; i < count; i++) {
+    if (thrd_create(&state.workers[state.workerCount], workerMain, NULL) == thrd_success) {
+      state.workerCount++;
+    }
+  }
+
+  state.initialized = true;
+}
+
+void lovrJobRun(JobFunction* function, void* context, uint32_t count) {
+  // Nested runs happen on the calling thread, waiting on the pool from inside it would deadlock
+  if (state.workerCount == 0 || count <= 1 || isPoolThread()) {
+    for (uint32_t i = 0; i < count; i++) {
+      function(context, i);
+    }
+    return;
+  }
+
+  mtx_lock(&state.runLock);
+  mtx_lock(&state.lock);
+  state.runner = thrd_current();
+  state.running = true;
+  state.function = function;
+  state.context = context;
+  state.next = 0;
+  state.count = count;
+  state.finished = 0;
+  cnd_broadcast(&state.wake);
+
+  while (state.next < state.count) {
+    runNextJob();
+  }
+
+  while (state.finished < state.count) {
+    cnd_wait(&state.done, &state.lock);
+  }
+
+  state.next = state.count = state.finished = 0;
+  state.running = false;
+  mtx_unlock(&state.lock);
+  mtx_unlock(&state.runLock);
+}
+
+void lovrJobSubmit(JobFunction* function, void* context) {
+  if (state.workerCount == 0) {
+    function(context, 0);
+    return;
+  }
+
+  mtx_lock(&state.lock);
+  arr_push(&state.tasks, ((Task) { function, context }));
+  cnd_signal(&state.wake);
+  mtx_unlock(&state.lock);
+}
+
+void lovrJobWait(void* context, atomic_uint* counter) {
+  if (state.workerCount == 0) {
+    return;
+  }
+
+  mtx_lock(&state.lock);
+  while (atomic_fetch_add(counter, 0) > 0) {
+    size_t i = 0;
+    while (i < state.tasks.length && state.tasks.data[i].context != context) {
+      i++;
+    }
+
+    if (i < state.tasks.length) {
+      Task task = state.tasks.data[i];
+      arr_splice(&state.tasks, i, 1);
+      mtx_unlock(&state.lock);
+      task.function(task.context, 0);
+      mtx_lock(&state.lock);
+    } else {
+      cnd_wait(&state.taskDone, &state.lock);
+    }
+  }
+  mtx_unlock(&state.lock);
+}
+
+void lovrJobDestroy() {
+  if (!state.initialized) return;
+  mtx_lock(&state.lock);
+  state.quit = true;
+  cnd_broadcast(&state.wake);
+  mtx_unlock(&state.lock);
+  for (uint32_t i = 0; i < state.workerCount; i++) {
+    thrd_join(state.workers[i], NULL);
+  }
+  arr_free(&state.tasks);
+  cnd_destroy(&state.taskDone);
+  cnd_destroy(&state.done);
+  cnd_destroy(&state.wake);
+  mtx_destroy(&state.lock);
+  mtx_destroy(&state.runLock);
+  memset(&state, 0, sizeof(state));
+}
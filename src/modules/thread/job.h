@@ -0,0 +1,26 @@
+#include <stdint.h>
+#include <stdatomic.h>
+
+#pragma once
+
+// The pool is created before anything can use it and destroyed after everything is done with it,
+// both on the main thread, so the other functions don't need to check whether it exists.  Init does
+// nothing if the pool is already running.
+void lovrJobInit(void);
+void lovrJobDestroy(void);
+
+// Runs a function count times, spread across a pool of worker threads, and waits for all of them
+// to finish.  The calling thread helps out.  Jobs must not throw errors.  Jobs and tasks may run more
+// jobs, but those run one after another on the thread that asked for them.
+typedef void JobFunction(void* context, uint32_t index);
+
+void lovrJobRun(JobFunction* function, void* context, uint32_t count);
+
+// Queues a function to run once on a worker thread in the background, without waiting for it.  The
+// index is always zero.  Without any workers, the function runs immediately.
+void lovrJobSubmit(JobFunction* function, void* context);
+
+// Waits for a counter to reach zero, usually one that tasks submitted with the same context count
+// down.  The waiting thread runs those tasks itself if no worker has taken them yet, so a task can
+// wait for tasks it submitted without tying up the pool.
+void lovrJobWait(void* context, atomic_uint* counter);
@@ -118,7 +118,11 @@ function lovr.boot()
       spatializer = nil
     },
     graphics = {
-      debug = false
+      debug = false,
+      streams = {
+        vertices = 65535,
+        indices = 65536
+      }
     },
     headset = {
       drivers = { 'openxr', 'oculus', 'vrapi', 'pico', 'openvr', 'webxr', 'desktop' },
@@ -2,8 +2,12 @@
 
 const char* lovrShaderVertexPrefix = ""
 "#define VERTEX VERTEX \n"
-"#define MAX_BONES 48 \n"
+"#define MAX_BONES 256 \n"
+"#ifdef WIDE_DRAWS \n"
+"#define MAX_DRAWS 65536 \n"
+"#else \n"
 "#define MAX_DRAWS 256 \n"
+"#endif \n"
 "#define lovrView lovrViews[lovrViewID] \n"
 "#define lovrProjection lovrProjections[lovrViewID] \n"
 "#define lovrModel lovrModels[lovrDrawID] \n"
@@ -13,14 +17,15 @@ const char* lovrShaderVertexPrefix = ""
 "#else \n"
 "#define lovrNormalMatrix mat3(transpose(inverse(lovrModel))) \n"
 "#endif \n"
+"#define lovrPose(i) lovrPoses[int(lovrDrawID) * lovrPoseCount + int(i)] \n"
 "#define lovrPoseMatrix ("
-  "lovrPose[lovrBones[0]] * lovrBoneWeights[0] +"
-  "lovrPose[lovrBones[1]] * lovrBoneWeights[1] +"
-  "lovrPose[lovrBones[2]] * lovrBoneWeights[2] +"
-  "lovrPose[lovrBones[3]] * lovrBoneWeights[3]"
+  "lovrPose(lovrBones[0]) * lovrBoneWeights[0] +"
+  "lovrPose(lovrBones[1]) * lovrBoneWeights[1] +"
+  "lovrPose(lovrBones[2]) * lovrBoneWeights[2] +"
+  "lovrPose(lovrBones[3]) * lovrBoneWeights[3]"
   ") \n"
 "#ifdef FLAG_animated \n"
-"#define lovrVertex (lovrPoseMatrix * vec4(lovrPosition, 1.)) \n"
+"#define lovrVertex (lovrPoseCount > 0 ? lovrPoseMatrix * vec4(lovrPosition, 1.) : vec4(lovrPosition, 1.)) \n"
 "#else \n"
 "#define lovrVertex vec4(lovrPosition, 1.) \n"
 "#endif \n"
@@ -37,12 +42,25 @@ const char* lovrShaderVertexPrefix = ""
 "out vec2 texCoord; \n"
 "out vec4 vertexColor; \n"
 "out vec4 lovrGraphicsColor; \n"
+"#ifdef WIDE_DRAWS \n"
+"layout(std430) readonly buffer lovrModelBlock { mat4 lovrModels[]; }; \n"
+"layout(std430) readonly buffer lovrColorBlock { vec4 lovrColors[]; }; \n"
+"layout(std430) readonly buffer lovrPoseBlock { mat4 lovrPoses[]; }; \n"
+"#else \n"
 "layout(std140) uniform lovrModelBlock { mat4 lovrModels[MAX_DRAWS]; }; \n"
 "layout(std140) uniform lovrColorBlock { vec4 lovrColors[MAX_DRAWS]; }; \n"
+"layout(std140) uniform lovrPoseBlock { mat4 lovrPoses[MAX_BONES]; }; \n"
+"#endif \n"
 "layout(std140) uniform lovrFrameBlock { mat4 lovrViews[2]; mat4 lovrProjections[2]; }; \n"
-"uniform mat3 lovrMaterialTransform; \n"
+"layout(std140) uniform lovrMaterialBlock { \n"
+"  highp vec4 lovrDiffuseColor; \n"
+"  highp vec4 lovrEmissiveColor; \n"
+"  highp mat3 lovrMaterialTransform; \n"
+"  highp float lovrMetalness; \n"
+"  highp float lovrRoughness; \n"
+"}; \n"
 "uniform float lovrPointSize; \n"
-"uniform mat4 lovrPose[MAX_BONES]; \n"
+"uniform int lovrPoseCount; \n"
 "uniform lowp int lovrViewportCount; \n"
 "#if defined MULTIVIEW \n"
 "layout(num_views = 2) in; \n"
@@ -85,10 +103,13 @@ const char* lovrShaderFragmentPrefix = ""
 "in vec4 vertexColor; \n"
 "in vec4 lovrGraphicsColor; \n"
 "out vec4 lovrCanvas[gl_MaxDrawBuffers]; \n"
-"uniform float lovrMetalness; \n"
-"uniform float lovrRoughness; \n"
-"uniform vec4 lovrDiffuseColor; \n"
-"uniform vec4 lovrEmissiveColor; \n"
+"layout(std140) uniform lovrMaterialBlock { \n"
+"  highp vec4 lovrDiffuseColor; \n"
+"  highp vec4 lovrEmissiveColor; \n"
+"  highp mat3 lovrMaterialTransform; \n"
+"  highp float lovrMetalness; \n"
+"  highp float lovrRoughness; \n"
+"}; \n"
 "uniform sampler2D lovrDiffuseTexture; \n"
 "uniform sampler2D lovrEmissiveTexture; \n"
 "uniform sampler2D lovrMetalnessTexture; \n"
@@ -370,23 +391,27 @@ const char* lovrFillVertexShader = ""
 "  return lovrVertex; \n"
 "}";
 
-const char* lovrShaderScalarUniforms[] = {
-  "lovrMetalness",
-  "lovrRoughness"
-};
-
-const char* lovrShaderColorUniforms[] = {
-  "lovrDiffuseColor",
-  "lovrEmissiveColor"
-};
-
-const char* lovrShaderTextureUniforms[] = {
+const char* lovrShaderBuiltinUniforms[] = {
   "lovrDiffuseTexture",
   "lovrEmissiveTexture",
   "lovrMetalnessTexture",
   "lovrRoughnessTexture",
   "lovrOcclusionTexture",
-  "lovrNormalTexture"
+  "lovrNormalTexture",
+  "lovrSkyboxTexture",
+  "lovrPoseCount",
+  "lovrSdfRange",
+  "lovrPointSize",
+  "lovrViewportCount",
+  "lovrViewID"
+};
+
+const char* lovrShaderBuiltinBlocks[] = {
+  "lovrModelBlock",
+  "lovrColorBlock",
+  "lovrFrameBlock",
+  "lovrMaterialBlock",
+  "lovrPoseBlock"
 };
 
 const char* lovrShaderAttributeNames[] = {
@@ -16,7 +16,6 @@ extern const char* lovrPanoFragmentShader;
 extern const char* lovrFontFragmentShader;
 extern const char* lovrFillVertexShader;
 
-extern const char* lovrShaderScalarUniforms[];
-extern const char* lovrShaderColorUniforms[];
-extern const char* lovrShaderTextureUniforms[];
+extern const char* lovrShaderBuiltinUniforms[];
+extern const char* lovrShaderBuiltinBlocks[];
 extern const char* lovrShaderAttributeNames[];